@@ -0,0 +1,101 @@
+// Copyright 2019, Intel Corporation
+
+// Compares the legacy stripe llvm_cpu backend against the MLIR execution path
+// (with and without its optimization pipeline) on the same EDSL programs.
+//
+// Run with: bazel run //networks/oplib:cpu_pipelines
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+#include "base/util/env.h"
+#include "plaidml2/edsl/edsl.h"
+#include "plaidml2/exec/exec.h"
+
+namespace edsl = plaidml::edsl;
+namespace exec = plaidml::exec;
+
+namespace networks::oplib {
+
+namespace {
+
+enum class Pipeline {
+  Stripe = 0,  // legacy stripe llvm_cpu target
+  MlirO0 = 1,  // MLIR llvm_cpu_O0 target
+  MlirO3 = 2,  // MLIR llvm_cpu target
+};
+
+edsl::Tensor MatMul(const edsl::Tensor& A, const edsl::Tensor& B) {
+  edsl::TensorDim I, J, K;
+  edsl::TensorIndex i, j, k;
+  A.bind_dims(I, K);
+  B.bind_dims(K, J);
+  auto C = edsl::TensorOutput(I, J);
+  C(i, j) += A(i, k) * B(k, j);
+  return C;
+}
+
+edsl::Tensor Conv2D(const edsl::Tensor& I, const edsl::Tensor& K) {
+  edsl::TensorDim N, X, Y, KX, KY, CI, CO;
+  edsl::TensorIndex n, x, y, kx, ky, ci, co;
+  I.bind_dims(N, X, Y, CI);
+  K.bind_dims(KX, KY, CI, CO);
+  auto O = edsl::TensorOutput(N, X - KX + 1, Y - KY + 1, CO);
+  O(n, x, y, co) += I(n, x + kx, y + ky, ci) * K(kx, ky, ci, co);
+  return O;
+}
+
+void RunProgram(benchmark::State& state, const edsl::Program& program) {  // NOLINT[runtime/references]
+  auto pipeline = static_cast<Pipeline>(state.range(0));
+  vertexai::env::Set("PLAIDML_EE", pipeline == Pipeline::Stripe ? "0" : "1");
+  std::string target = pipeline == Pipeline::MlirO0 ? "llvm_cpu_O0" : "llvm_cpu";
+  auto executable = exec::Binder(program).set_device("llvm_cpu.0").set_target(target).compile();
+  for (auto _ : state) {
+    executable->run();
+  }
+  switch (pipeline) {
+    case Pipeline::Stripe:
+      state.SetLabel("stripe");
+      break;
+    case Pipeline::MlirO0:
+      state.SetLabel("mlir_O0");
+      break;
+    case Pipeline::MlirO3:
+      state.SetLabel("mlir_O3");
+      break;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+struct cpu_pipelines : public benchmark::Fixture {
+  void SetUp(const benchmark::State& state) {  //
+    plaidml::exec::init();
+  }
+};
+
+BENCHMARK_DEFINE_F(cpu_pipelines, matmul)(benchmark::State& state) {  // NOLINT[runtime/references]
+  auto A = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {256, 256});
+  auto B = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {256, 256});
+  RunProgram(state, edsl::Program("matmul", {MatMul(A, B)}));
+}
+
+BENCHMARK_DEFINE_F(cpu_pipelines, conv)(benchmark::State& state) {  // NOLINT[runtime/references]
+  auto I = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {1, 58, 58, 64});
+  auto K = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {3, 3, 64, 64});
+  RunProgram(state, edsl::Program("conv", {Conv2D(I, K)}));
+}
+
+BENCHMARK_DEFINE_F(cpu_pipelines, eltwise)(benchmark::State& state) {  // NOLINT[runtime/references]
+  auto A = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {1024, 1024});
+  auto B = edsl::Placeholder(PLAIDML_DATA_FLOAT32, {1024, 1024});
+  RunProgram(state, edsl::Program("eltwise", {A * B + A}));
+}
+
+BENCHMARK_REGISTER_F(cpu_pipelines, matmul)->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_REGISTER_F(cpu_pipelines, conv)->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_REGISTER_F(cpu_pipelines, eltwise)->DenseRange(0, 2)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace networks::oplib
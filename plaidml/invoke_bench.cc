@@ -0,0 +1,81 @@
+// Copyright 2020, Intel Corporation
+
+// Measures the host-side cost of invoking a function whose program is
+// already compiled: binding the inputs and outputs, looking the program up in
+// the program cache, and scheduling it. The function and its tensors are kept
+// tiny, so that the time spent on the device is negligible.
+//
+// Run with: bazel run //plaidml:invoke_bench
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "plaidml/plaidml++.h"
+#include "testing/plaidml_config.h"
+
+namespace vertexai {
+namespace plaidml {
+namespace {
+
+struct invoke_bench : public benchmark::Fixture {
+  void SetUp(const benchmark::State& state) {
+    vai_clear_status();
+    ctx = std::make_shared<vertexai::ctx>();
+    std::vector<device_config> configs = enumerate_devices(ctx, vertexai::testing::PlaidMLConfig());
+    dev = configs.at(0).open();
+    func = function("function (A, B) -> (C) { C = A + B; }");
+    A = dev.allocate(shape<float>(ctx, {4}));
+    B = dev.allocate(shape<float>(ctx, {4}));
+    C = dev.allocate(shape<float>(ctx, {4}));
+  }
+
+  void TearDown(const benchmark::State& state) {
+    func = function();
+    A = tensor<float>();
+    B = tensor<float>();
+    C = tensor<float>();
+    dev = device();
+    ctx.reset();
+  }
+
+  // Waits for the pending invocation, so that work does not queue up.
+  void Sync() { benchmark::DoNotOptimize(C.map(map_for_read)); }
+
+  std::shared_ptr<vertexai::ctx> ctx;
+  device dev;
+  function func;
+  tensor<float> A;
+  tensor<float> B;
+  tensor<float> C;
+};
+
+// Invokes the same invoker repeatedly, as a training loop does.
+BENCHMARK_DEFINE_F(invoke_bench, reuse)(benchmark::State& state) {  // NOLINT[runtime/references]
+  invoker inv(ctx, func);
+  inv.set_input("A", A).set_input("B", B).set_output("C", C);
+  inv.invoke();
+  Sync();
+  for (auto _ : state) {
+    inv.invoke();
+    Sync();
+  }
+}
+
+// Binds a fresh invoker for each invocation, as some frontends do.
+BENCHMARK_DEFINE_F(invoke_bench, fresh)(benchmark::State& state) {  // NOLINT[runtime/references]
+  invoker(ctx, func).set_input("A", A).set_input("B", B).set_output("C", C).invoke();
+  Sync();
+  for (auto _ : state) {
+    invoker(ctx, func).set_input("A", A).set_input("B", B).set_output("C", C).invoke();
+    Sync();
+  }
+}
+
+BENCHMARK_REGISTER_F(invoke_bench, reuse)->Unit(benchmark::kMicrosecond);
+BENCHMARK_REGISTER_F(invoke_bench, fresh)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace plaidml
+}  // namespace vertexai
@@ -17,6 +17,7 @@
 #include <cstring>
 #include <exception>
 #include <fstream>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
@@ -164,6 +165,14 @@ class Evaluator final {
     return compiled;
   }
 
+  std::shared_ptr<tile::Program> MakeProgram(const context::Context& ctx, const tile::ProgramKey& key,
+                                             const std::function<tile::proto::Program()>& make_program,
+                                             tile::ConstBufferManager* const_bufs) {
+    std::shared_ptr<tile::Program> compiled;
+    std::tie(std::ignore, compiled) = program_cache_->GetProgram(ctx, "sdk", key, make_program, const_bufs);
+    return compiled;
+  }
+
  private:
   std::shared_ptr<tile::Platform> platform_;
   std::string id_;
@@ -1353,6 +1362,14 @@ struct plaidml_invoker {
       runinfo_cache{kRuninfoCacheSize};
 
   std::shared_ptr<RunInfo> runinfo;
+
+  // The program cache key of runinfo on the device keyed_dev_id with the
+  // keyed_consumed inputs overwritten by outputs, so that repeated invocations
+  // need not build the program to look it up.
+  std::shared_ptr<RunInfo> keyed_runinfo;
+  std::string keyed_dev_id;
+  std::set<std::string> keyed_consumed;
+  tile::ProgramKey program_key;
 };
 
 namespace {
@@ -1617,41 +1634,62 @@ extern "C" plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml
       throw vertexai::error::FailedPrecondition{"Function has neither inputs nor outputs"};
     }
 
-    tile::proto::Program prog;
-    prog.set_dev_id(evaluator->get_id());
-    prog.set_code(invoker->runinfo->code);
+    std::set<std::string> consumed;
     for (const auto& kv : invoker->runinfo->input_shapes) {
-      auto& input = (*prog.mutable_inputs())[kv.first];
-      *input.mutable_shape() = tile::IntoProto(kv.second);
       if (output_set.count(in_buffers[kv.first].get())) {
-        input.set_consumed(true);
+        consumed.insert(kv.first);
       }
     }
-    for (const auto& kv : invoker->runinfo->output_shapes) {
-      *(*prog.mutable_outputs())[kv.first].mutable_shape() = tile::IntoProto(kv.second);
+
+    if (invoker->keyed_runinfo != invoker->runinfo || invoker->keyed_dev_id != evaluator->get_id() ||
+        invoker->keyed_consumed != consumed) {
+      invoker->program_key = tile::ProgramCache::MakeKey(evaluator->get_id(), invoker->runinfo->code,
+                                                         invoker->runinfo->input_shapes,
+                                                         invoker->runinfo->output_shapes, consumed);
+      invoker->keyed_runinfo = invoker->runinfo;
+      invoker->keyed_dev_id = evaluator->get_id();
+      invoker->keyed_consumed = consumed;
     }
 
-    size_t max_trials = 1;
-    auto env_trials = vertexai::env::Get("PLAIDML_KERNEL_TRIALS");
-    if (env_trials.length()) {
-      auto env_value = std::atoi(env_trials.c_str());
-      if (env_value) {
-        max_trials = env_value;
+    // Only called when the program is not already in the cache.
+    auto make_program = [&]() {
+      tile::proto::Program prog;
+      prog.set_dev_id(evaluator->get_id());
+      prog.set_code(invoker->runinfo->code);
+      for (const auto& kv : invoker->runinfo->input_shapes) {
+        auto& input = (*prog.mutable_inputs())[kv.first];
+        *input.mutable_shape() = tile::IntoProto(kv.second);
+        if (consumed.count(kv.first)) {
+          input.set_consumed(true);
+        }
+      }
+      for (const auto& kv : invoker->runinfo->output_shapes) {
+        *(*prog.mutable_outputs())[kv.first].mutable_shape() = tile::IntoProto(kv.second);
       }
-    }
 
-    size_t max_trial_runs = 1;
-    auto env_runs = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_RUNS");
-    if (env_runs.length()) {
-      auto env_value = std::atoi(env_runs.c_str());
-      if (env_value) {
-        max_trial_runs = env_value;
+      size_t max_trials = 1;
+      auto env_trials = vertexai::env::Get("PLAIDML_KERNEL_TRIALS");
+      if (env_trials.length()) {
+        auto env_value = std::atoi(env_trials.c_str());
+        if (env_value) {
+          max_trials = env_value;
+        }
+      }
+
+      size_t max_trial_runs = 1;
+      auto env_runs = vertexai::env::Get("PLAIDML_KERNEL_TRIAL_RUNS");
+      if (env_runs.length()) {
+        auto env_value = std::atoi(env_runs.c_str());
+        if (env_value) {
+          max_trial_runs = env_value;
+        }
       }
-    }
 
-    auto* params = prog.mutable_tile_scanning_params();
-    params->set_max_trials(max_trials);
-    params->set_max_trial_runs(max_trial_runs);
+      auto* params = prog.mutable_tile_scanning_params();
+      params->set_max_trials(max_trials);
+      params->set_max_trial_runs(max_trial_runs);
+      return prog;
+    };
 
     tile::ConstBufferManager const_bufs;
     const_bufs.allocator = std::make_shared<PlatformAllocator>(*evaluator);
@@ -1660,7 +1698,7 @@ extern "C" plaidml_invocation* plaidml_schedule_invocation(vai_ctx* ctx, plaidml
         const_bufs.buffers[kvp.first] = in_buffers[kvp.first];
       }
     }
-    auto program = evaluator->MakeProgram(activity.ctx(), prog, &const_bufs);
+    auto program = evaluator->MakeProgram(activity.ctx(), invoker->program_key, make_program, &const_bufs);
 
     // Run the program
     auto result = program->Run(activity.ctx(), in_buffers, out_buffers);
@@ -2,7 +2,10 @@
 
 #include "plaidml2/bridge/pytorch/compiler.h"
 
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <unordered_map>
 
 #include "plaidml2/bridge/pytorch/logging.h"
 #include "plaidml2/op/op.h"
@@ -470,10 +473,27 @@ std::map<Symbol, OpFunction> kSupportedOps = {
 
 const at::Symbol Compiler::symbol = Symbol::fromQualString("plaidml::CompilationGroup");
 
-Compiler::Compiler(const std::string& device_id, const std::string& target_id, const Node* node)
+Compiler::Compiler(const std::string& device_id,  //
+                   const std::string& target_id,  //
+                   const CacheOptions& options,   //
+                   const Node* node)
     : device_id_(device_id),                //
       target_id_(target_id),                //
+      options_(options),                    //
       subgraph_(node->g(attr::Subgraph)) {  //
+  std::sort(options_.buckets.begin(), options_.buckets.end());
+  options_.buckets.erase(std::unique(options_.buckets.begin(), options_.buckets.end()), options_.buckets.end());
+}
+
+Compiler::~Compiler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
 }
 
 bool Compiler::is_supported(Node* node) {
@@ -500,39 +520,245 @@ bool Compiler::is_supported(Node* node) {
 void Compiler::run(Stack* stack) {
   IVLOG(1, "Compiler::run>");
   size_t num_inputs = subgraph_->inputs().size();
-  at::ArrayRef<IValue> inputs = last(*stack, num_inputs);
+  at::ArrayRef<IValue> ivalues = last(*stack, num_inputs);
 
-  CompleteArgumentSpec spec{false, inputs};
-  auto it = cache_.find(spec);
-  if (it == cache_.end()) {
-    std::tie(it, std::ignore) = cache_.emplace(spec, compile(inputs));
+  std::vector<at::Tensor> inputs;
+  Shapes shapes;
+  for (const auto& ival : ivalues) {
+    if (!ival.isTensor()) {
+      throw std::runtime_error("Unexpected non-tensor input");
+    }
+    inputs.push_back(ival.toTensor());
+    shapes.emplace_back(inputs.back().sizes().vec());
+  }
+
+  // Pad the bucketed inputs out to their bucket with zeros.
+  auto padded_shapes = bucket(shapes);
+  std::map<size_t, std::pair<int64_t, int64_t>> padded_dims;  // dim -> (original, padded)
+  bool exact = false;
+  for (size_t i = 0; i < shapes.size() && !exact; i++) {
+    for (size_t dim = 0; dim < shapes[i].size(); dim++) {
+      if (padded_shapes[i][dim] == shapes[i][dim]) {
+        continue;
+      }
+      auto sizes = std::make_pair(shapes[i][dim], padded_shapes[i][dim]);
+      auto inserted = padded_dims.emplace(dim, sizes);
+      if (!inserted.second && inserted.first->second != sizes) {
+        exact = true;
+        break;
+      }
+    }
+  }
+  for (size_t i = 0; i < shapes.size() && !exact; i++) {
+    for (const auto& kvp : padded_dims) {
+      if (kvp.first < shapes[i].size() && shapes[i][kvp.first] == kvp.second.second) {
+        exact = true;
+        break;
+      }
+    }
+  }
+  if (exact) {
+    IVLOG(1, "Compiler::run> ambiguous padding, compiling exact shapes");
+    padded_shapes = shapes;
+    padded_dims.clear();
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (padded_shapes[i] == shapes[i]) {
+      continue;
+    }
+    auto padded = at::zeros(padded_shapes[i], inputs[i].options());
+    auto region = padded;
+    for (size_t dim = 0; dim < shapes[i].size(); dim++) {
+      if (padded_shapes[i][dim] != shapes[i][dim]) {
+        region = region.narrow(dim, 0, shapes[i][dim]);
+      }
+    }
+    region.copy_(inputs[i]);
+    inputs[i] = padded;
   }
 
-  auto outputs = it->second->run(inputs);
+  auto outputs = lookup(padded_shapes)->run(inputs);
 
   drop(*stack, num_inputs);
-  for (const auto& output : outputs) {
-    auto var = torch::autograd::make_variable(output.toTensor());
+  for (auto& output : outputs) {
+    // Slice off the padding of the outputs which grew along with the inputs.
+    bool sliced = false;
+    for (const auto& kvp : padded_dims) {
+      auto dim = kvp.first;
+      if (dim < static_cast<size_t>(output.dim()) && output.size(dim) == kvp.second.second) {
+        output = output.narrow(dim, 0, kvp.second.first);
+        sliced = true;
+      }
+    }
+    if (sliced) {
+      output = output.contiguous();
+    }
+    auto var = torch::autograd::make_variable(output);
     stack->push_back(IValue(var));
   }
 }
 
-std::shared_ptr<Executable> Compiler::compile(at::ArrayRef<IValue> inputs) {
+Compiler::Shapes Compiler::bucket(const Shapes& shapes) const {
+  if (options_.buckets.empty()) {
+    return shapes;
+  }
+  auto result = shapes;
+  for (auto input : options_.inputs) {
+    if (input >= result.size()) {
+      continue;
+    }
+    auto& sizes = result[input];
+    for (auto dim : options_.dims) {
+      if (dim >= sizes.size()) {
+        continue;
+      }
+      auto it = std::lower_bound(options_.buckets.begin(), options_.buckets.end(), sizes[dim]);
+      if (it != options_.buckets.end()) {
+        sizes[dim] = *it;
+      }
+      // Sizes beyond the largest bucket are compiled exactly.
+    }
+  }
+  return result;
+}
+
+std::shared_ptr<Executable> Compiler::lookup(const Shapes& shapes) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !in_flight_.count(shapes); });
+    auto it = cache_.find(shapes);
+    if (it != cache_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru);
+      return it->second.executable;
+    }
+    in_flight_.insert(shapes);
+  }
+
+  std::shared_ptr<Executable> executable;
+  try {
+    executable = compile(shapes);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      in_flight_.erase(shapes);
+    }
+    cv_.notify_all();
+    throw;
+  }
+  insert(shapes, executable);
+  schedule_neighbours(shapes);
+  return executable;
+}
+
+void Compiler::insert(const Shapes& shapes, std::shared_ptr<Executable> executable) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_.erase(shapes);
+    lru_.push_front(shapes);
+    bytes_ += executable->bytes();
+    cache_[shapes] = Entry{std::move(executable), lru_.begin()};
+    // Evict the least recently used entries, but never the one just added.
+    auto over = [this] {
+      return (options_.max_entries && cache_.size() > options_.max_entries) ||
+             (options_.max_bytes && bytes_ > options_.max_bytes);
+    };
+    while (lru_.size() > 1 && over()) {
+      auto it = cache_.find(lru_.back());
+      IVLOG(1, "Compiler::insert> evicting entry of " << it->second.executable->bytes() << " bytes");
+      bytes_ -= it->second.executable->bytes();
+      cache_.erase(it);
+      lru_.pop_back();
+    }
+  }
+  cv_.notify_all();
+}
+
+void Compiler::schedule_neighbours(const Shapes& shapes) {
+  if (!options_.precompile || options_.buckets.empty()) {
+    return;
+  }
+  // Each bucketed dimension moves to the next smaller or larger bucket.
+  auto step = [&](bool up) {
+    auto result = shapes;
+    bool changed = false;
+    for (auto input : options_.inputs) {
+      if (input >= result.size()) {
+        continue;
+      }
+      auto& sizes = result[input];
+      for (auto dim : options_.dims) {
+        if (dim >= sizes.size()) {
+          continue;
+        }
+        auto it = std::find(options_.buckets.begin(), options_.buckets.end(), sizes[dim]);
+        if (it == options_.buckets.end()) {
+          continue;
+        }
+        if (up && std::next(it) != options_.buckets.end()) {
+          sizes[dim] = *std::next(it);
+          changed = true;
+        } else if (!up && it != options_.buckets.begin()) {
+          sizes[dim] = *std::prev(it);
+          changed = true;
+        }
+      }
+    }
+    return changed ? result : Shapes{};
+  };
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto up : {true, false}) {
+      auto neighbour = step(up);
+      if (neighbour.empty() || cache_.count(neighbour) || in_flight_.count(neighbour)) {
+        continue;
+      }
+      in_flight_.insert(neighbour);
+      queue_.push_back(neighbour);
+    }
+    if (queue_.empty()) {
+      return;
+    }
+    if (!worker_.joinable()) {
+      worker_ = std::thread([this] { precompile_loop(); });
+    }
+  }
+  cv_.notify_all();
+}
+
+void Compiler::precompile_loop() {
+  while (true) {
+    Shapes shapes;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      shapes = queue_.front();
+      queue_.pop_front();
+    }
+    try {
+      IVLOG(1, "Compiler::precompile_loop> compiling a neighbouring bucket");
+      insert(shapes, compile(shapes));
+    } catch (const std::exception& ex) {
+      IVLOG(1, "Compiler::precompile_loop> failed: " << ex.what());
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(shapes);
+      }
+      cv_.notify_all();
+    }
+  }
+}
+
+std::shared_ptr<Executable> Compiler::compile(const Shapes& shapes) {
   IVLOG(1, "Compiler::compile>");
+  std::lock_guard<std::mutex> lock(compile_mutex_);
   std::vector<edsl::Tensor> input_tensors;
   std::unordered_map<const Value*, edsl::Value> value_map;
-  for (size_t i = 0; i < inputs.size(); i++) {
-    const auto& ival = inputs.at(i);
-    if (!ival.isTensor()) {
-      throw std::runtime_error("Unexpected non-tensor input");
-    }
-    const auto& tensor = ival.toTensor();
-    std::vector<int64_t> sizes;
-    for (const auto& size : tensor.sizes()) {
-      sizes.emplace_back(size);
-    }
+  for (size_t i = 0; i < shapes.size(); i++) {
     // TODO: convert dtype
-    auto input_tensor = edsl::Placeholder(PLAIDML_DATA_FLOAT32, sizes);
+    auto input_tensor = edsl::Placeholder(PLAIDML_DATA_FLOAT32, shapes[i]);
     input_tensors.push_back(input_tensor);
     const auto& input = subgraph_->inputs()[i];
     value_map.emplace(input, input_tensor);
@@ -598,9 +824,36 @@ std::shared_ptr<Executable> Compiler::compile(at::ArrayRef<IValue> inputs) {
   return std::make_shared<Executable>(device_id_, target_id_, input_tensors, output_tensors);
 }
 
-static size_t g_program_id = 1;
+static std::atomic<size_t> g_program_id{1};
+
+namespace {
+
+at::ScalarType ScalarTypeOf(plaidml_datatype dtype) {
+  switch (dtype) {
+    case PLAIDML_DATA_BOOLEAN:
+      return at::kBool;
+    case PLAIDML_DATA_INT8:
+      return at::kChar;
+    case PLAIDML_DATA_UINT8:
+      return at::kByte;
+    case PLAIDML_DATA_INT16:
+      return at::kShort;
+    case PLAIDML_DATA_INT32:
+      return at::kInt;
+    case PLAIDML_DATA_INT64:
+      return at::kLong;
+    case PLAIDML_DATA_FLOAT16:
+      return at::kHalf;
+    case PLAIDML_DATA_FLOAT32:
+      return at::kFloat;
+    case PLAIDML_DATA_FLOAT64:
+      return at::kDouble;
+    default:
+      throw std::runtime_error("Unsupported output data type");
+  }
+}
 
-// TODO: FIXME sometime
+}  // namespace
 
 Executable::Executable(                       //
     const std::string& device_id,             //
@@ -608,55 +861,73 @@ Executable::Executable(                       //
     const std::vector<edsl::Tensor>& inputs,  //
     const std::vector<edsl::Tensor>& outputs)
     : device_id_(device_id),  //
-      target_id_(target_id),
-      // input_bindings_(inputs.size()),
-      output_ivalues_(outputs.size()) {
-  // for (size_t i = 0; i < inputs.size(); i++) {
-  //   auto shape = inputs[i].shape();
-  //   plaidml::TensorShape tensor_shape(shape.dtype(), shape.int_dims());
-  //   plaidml::Buffer buffer(device_id, tensor_shape);
-  //   input_bindings_[i] = plaidml::exec::Binding{inputs[i], buffer};
-  // }
+      target_id_(target_id),  //
+      zero_copy_(device_id.compare(0, 8, "llvm_cpu") == 0) {
   std::stringstream ss;
   ss << "pytorch_" << g_program_id++;
   name_ = ss.str();
   edsl::Program program(name_, outputs);
-  // program_ = std::make_unique<edsl::Program>(name_, outputs);
   IVLOG(1, "Executable::Executable>");
   IVLOG(2, program.str());
+  // Inputs the program does not read are skipped.
+  for (const auto& arg : program.inputs()) {
+    auto it = std::find_if(inputs.begin(), inputs.end(),
+                           [&](const edsl::Tensor& tensor) { return edsl::TensorRef(tensor) == arg.tensor; });
+    if (it == inputs.end()) {
+      continue;
+    }
+    auto sizes = arg.shape.int_dims();
+    inputs_.emplace_back(Argument{arg.tensor.tensor, plaidml::TensorShape(arg.shape.dtype(), sizes), sizes,
+                                  static_cast<size_t>(it - inputs.begin())});
+  }
+  for (const auto& arg : program.outputs()) {
+    auto sizes = arg.shape.int_dims();
+    outputs_.emplace_back(Argument{arg.tensor.tensor, plaidml::TensorShape(arg.shape.dtype(), sizes), sizes, 0});
+  }
+  for (const auto& args : {&inputs_, &outputs_}) {
+    for (const auto& arg : *args) {
+      bytes_ += arg.shape.nbytes();
+    }
+  }
   binder_ = std::make_unique<plaidml::exec::Binder>(program);
-  // for (size_t i = 0; i < outputs.size(); i++) {
-  //   // auto shape = outputs[i].shape();
-  //   // plaidml::TensorShape tensor_shape(shape.dtype(), shape.int_dims());
-  //   // output_bindings_.emplace_back(plaidml::exec::Binding{
-  //   //     program_->outputs().at(i),                // tensor
-  //   //     plaidml::Buffer{device_id, tensor_shape}  // buffer
-  //   // });
-  //   std::vector<int64_t> sizes;
-  //   auto dims = shape.int_dims();
-  //   for (size_t j = 0; j < dims.size(); j++) {
-  //     sizes.push_back(dims[j]);
-  //   }
-  //   output_ivalues_[i] = at::empty(at::IntArrayRef(sizes));
-  // }
-  // exec_ =
-  //     std::make_shared<plaidml::exec::Executable>(*program_, device_id_, target_id_, input_bindings_,
-  //     output_bindings_);
+  binder_->set_device(device_id_).set_target(target_id_);
   exec_ = binder_->compile();
   IVLOG(1, "Executable::Executable> done");
 }
 
-at::ArrayRef<torch::jit::IValue> Executable::run(at::ArrayRef<torch::jit::IValue> inputs) {
+std::vector<at::Tensor> Executable::run(const std::vector<at::Tensor>& inputs) {
   IVLOG(1, "Executable::run> " << name_);
-  // for (size_t i = 0; i < input_bindings_.size(); i++) {
-  //   input_bindings_[i].buffer.copy_from(inputs[i].toTensor().data_ptr());
-  // }
-  exec_->run();
-  // for (size_t i = 0, j = 0; i < output_bindings_.size(); i++) {
-  //   if (output_ivalues_[i].isTensor()) {
-  //     output_bindings_[j++].buffer.copy_into(output_ivalues_[i].toTensor().data_ptr());
-  //   }
-  // }
+  std::vector<at::Tensor> results;
+  for (const auto& arg : outputs_) {
+    results.push_back(at::empty(arg.sizes, at::TensorOptions().dtype(ScalarTypeOf(arg.shape.dtype()))));
+  }
+  if (zero_copy_) {
+    // The CPU device reads and writes the framework's memory in place; each
+    // run binds its own tensors, so runs need not be serialized.
+    std::vector<at::Tensor> keep_alive;
+    std::vector<plaidml::exec::Binding> input_bindings;
+    for (const auto& arg : inputs_) {
+      keep_alive.push_back(inputs[arg.index].to(at::kFloat).contiguous());
+      plaidml::Buffer buffer(device_id_, arg.shape, keep_alive.back().data_ptr());
+      input_bindings.emplace_back(plaidml::exec::Binding{arg.tensor, buffer});
+    }
+    std::vector<plaidml::exec::Binding> output_bindings;
+    for (size_t i = 0; i < outputs_.size(); i++) {
+      plaidml::Buffer buffer(device_id_, outputs_[i].shape, results[i].data_ptr());
+      output_bindings.emplace_back(plaidml::exec::Binding{outputs_[i].tensor, buffer});
+    }
+    exec_->run(input_bindings, output_bindings);
+  } else {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& arg : inputs_) {
+      auto tensor = inputs[arg.index].to(at::kFloat).contiguous();
+      binder_->input(arg.tensor).copy_from(tensor.data_ptr());
+    }
+    exec_->run();
+    for (size_t i = 0; i < outputs_.size(); i++) {
+      binder_->output(outputs_[i].tensor).copy_into(results[i].data_ptr());
+    }
+  }
   IVLOG(1, "Executable::run> done");
-  return output_ivalues_;
+  return results;
 }
@@ -5,14 +5,48 @@
 #include <torch/csrc/jit/argument_spec.h>
 #include <torch/csrc/jit/ir.h>
 
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 #include "plaidml2/edsl/edsl.h"
 #include "plaidml2/exec/exec.h"
 
+// Options for the cache of compiled executables which each fused subgraph
+// keeps, keyed by the shapes of its inputs.
+struct CacheOptions {
+  // The sizes to which bucketed input dimensions are padded, in ascending
+  // order.  When empty, every distinct set of input shapes is compiled
+  // exactly.  Inputs are padded with zeros and outputs are sliced back, so
+  // bucketed dimensions must be ones along which the subgraph's results are
+  // independent, such as the batch dimension.
+  std::vector<int64_t> buckets;
+  // The subgraph inputs which are bucketed, such as its activations; other
+  // inputs, such as weights, are always compiled at their exact shapes.
+  std::vector<size_t> inputs{0};
+  // The dimensions of those inputs which are bucketed.  A padded dimension of
+  // an output is sliced back to the original size of the inputs'.  When the
+  // inputs were padded from different sizes along a dimension, or another
+  // input already had the padded size, which outputs grew is ambiguous, and
+  // the shapes are compiled exactly instead.
+  std::vector<size_t> dims{0};
+  // The maximum number of cached executables, or 0 for no limit.
+  size_t max_entries = 64;
+  // The maximum total size of the tensors the cached executables read and
+  // write, or 0 for no limit.
+  size_t max_bytes = 0;
+  // Whether to compile the neighbouring buckets of each new entry in the
+  // background, so that growing or shrinking traffic finds them ready.
+  bool precompile = false;
+};
+
 class Executable {
  public:
   Executable(const std::string& device_id,                      //
@@ -20,25 +54,44 @@ class Executable {
              const std::vector<plaidml::edsl::Tensor>& inputs,  //
              const std::vector<plaidml::edsl::Tensor>& outputs);
 
-  at::ArrayRef<torch::jit::IValue> run(at::ArrayRef<torch::jit::IValue> inputs);
+  // Runs the program on tensors of the shapes it was compiled for.
+  std::vector<at::Tensor> run(const std::vector<at::Tensor>& inputs);
+
+  // The total size of the tensors the program reads and writes.
+  size_t bytes() const { return bytes_; }
 
  private:
+  struct Argument {
+    plaidml::edsl::Tensor tensor;
+    plaidml::TensorShape shape;
+    std::vector<int64_t> sizes;
+    // For inputs, the position of the tensor among the subgraph's inputs
+    size_t index;
+  };
+
   std::string device_id_;
   std::string target_id_;
-  std::unique_ptr<plaidml::edsl::Program> program_;
   std::unique_ptr<plaidml::exec::Binder> binder_;
   std::shared_ptr<plaidml::exec::Executable> exec_;
-  // std::vector<plaidml::exec::Binding> input_bindings_;
-  // std::vector<plaidml::exec::Binding> output_bindings_;
-  std::vector<torch::jit::IValue> output_ivalues_;
+  std::vector<Argument> inputs_;
+  std::vector<Argument> outputs_;
+  // Whether framework tensors can be bound to the program in place
+  bool zero_copy_;
+  // Serializes runs which go through the binder's buffers
+  std::mutex mutex_;
+  size_t bytes_ = 0;
   std::string name_;
 };
 
 class Compiler {
  public:
+  using Shapes = std::vector<std::vector<int64_t>>;
+
   explicit Compiler(const std::string& device_id,  //
                     const std::string& target_id,  //
+                    const CacheOptions& options,   //
                     const torch::jit::Node* node);
+  ~Compiler();
 
   void run(torch::jit::Stack* stack);
 
@@ -46,11 +99,36 @@ class Compiler {
   static bool is_supported(torch::jit::Node* node);
 
  private:
-  std::shared_ptr<Executable> compile(at::ArrayRef<torch::jit::IValue> inputs);
+  struct Entry {
+    std::shared_ptr<Executable> executable;
+    std::list<Shapes>::iterator lru;
+  };
+
+  std::shared_ptr<Executable> compile(const Shapes& shapes);
+  Shapes bucket(const Shapes& shapes) const;
+  std::shared_ptr<Executable> lookup(const Shapes& shapes);
+  void insert(const Shapes& shapes, std::shared_ptr<Executable> executable);
+  void schedule_neighbours(const Shapes& shapes);
+  void precompile_loop();
 
  private:
   std::string device_id_;
   std::string target_id_;
+  CacheOptions options_;
   std::shared_ptr<torch::jit::Graph> subgraph_;
-  std::unordered_map<torch::jit::CompleteArgumentSpec, std::shared_ptr<Executable>> cache_;
+
+  // Guards the cache and the precompilation queue
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<Shapes, Entry> cache_;
+  // Cached shapes, most recently used first
+  std::list<Shapes> lru_;
+  size_t bytes_ = 0;
+  // Shapes being compiled, and shapes waiting to be compiled in the background
+  std::set<Shapes> in_flight_;
+  std::deque<Shapes> queue_;
+  std::thread worker_;
+  bool stop_ = false;
+  // Serializes the construction of programs
+  std::mutex compile_mutex_;
 };
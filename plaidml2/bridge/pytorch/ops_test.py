@@ -40,6 +40,67 @@ class TestOps(TestBase):
         jit_out, pml_out = self._run_both(mul, [x, y, z])
         assert torch.allclose(jit_out, pml_out)
 
+    def test_bucketed_batch(self):
+        W = torch.randn(32, 16)
+        b = torch.randn(32)
+
+        def fc(x):
+            return F.relu(F.linear(x, W, b))
+
+        plaidml_pytorch.set_cache_options(buckets=[8, 16])
+        try:
+            with torch.no_grad():
+                with plaidml_pytorch.toggle():
+                    trace_pml = torch.jit.trace(fc, [torch.randn(5, 16)])
+                    for batch in (5, 11, 3, 16, 20):
+                        x = torch.randn(batch, 16)
+                        pml_out = trace_pml(x)
+                        self.assertEqual(pml_out.shape, (batch, 32))
+                        assert torch.allclose(fc(x), pml_out, rtol=0.01, atol=0.01)
+        finally:
+            plaidml_pytorch.set_cache_options()
+
+    def test_bucketed_batch_with_weight_input(self):
+        W = torch.randn(12, 16)
+
+        def linear(x, w):
+            return F.linear(x, w)
+
+        # Only the activations are bucketed; the weights keep their shape.
+        plaidml_pytorch.set_cache_options(buckets=[8, 16])
+        try:
+            with torch.no_grad():
+                with plaidml_pytorch.toggle():
+                    trace_pml = torch.jit.trace(linear, [torch.randn(5, 16), W])
+                    for batch in (5, 3):
+                        x = torch.randn(batch, 16)
+                        pml_out = trace_pml(x, W)
+                        self.assertEqual(pml_out.shape, (batch, 12))
+                        assert torch.allclose(linear(x, W), pml_out, rtol=0.01, atol=0.01)
+        finally:
+            plaidml_pytorch.set_cache_options()
+
+    def test_bucketed_conflicting_inputs(self):
+
+        def total(a, b):
+            return a.sum(0) + b.sum(0)
+
+        # The inputs pad their batches from different sizes, so the shapes are
+        # compiled exactly.
+        plaidml_pytorch.set_cache_options(buckets=[8, 16], inputs=[0, 1])
+        try:
+            with torch.no_grad():
+                with plaidml_pytorch.toggle():
+                    trace_pml = torch.jit.trace(total, [torch.randn(5, 4), torch.randn(11, 4)])
+                    for batches in ((5, 11), (3, 3)):
+                        a = torch.randn(batches[0], 4)
+                        b = torch.randn(batches[1], 4)
+                        pml_out = trace_pml(a, b)
+                        self.assertEqual(pml_out.shape, (4,))
+                        assert torch.allclose(total(a, b), pml_out, rtol=0.01, atol=0.01)
+        finally:
+            plaidml_pytorch.set_cache_options()
+
     def test_conv_simple(self):
         shape = (1, 3, 224, 224)
         kernel_size = 7
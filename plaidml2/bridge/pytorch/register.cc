@@ -1,6 +1,7 @@
 // Copyright 2019, Intel Corporation.
 
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <torch/csrc/autograd/record_function.h>
 #include <torch/csrc/jit/custom_operator.h>
 #include <torch/csrc/jit/pass_manager.h>
@@ -28,6 +29,7 @@ using namespace torch::jit;  // NOLINT
 static bool g_fusion_enabled = false;
 static std::string g_device_id;  // NOLINT
 static std::string g_target_id;  // NOLINT
+static CacheOptions g_cache_options;
 
 size_t g_verbosity = 0;
 
@@ -47,7 +49,7 @@ PYBIND11_MODULE(plaidml_pytorch, module) {
   RegisterOperators op({Operator(
       Compiler::symbol,
       [](const Node* node) {
-        auto compiler = std::make_shared<Compiler>(g_device_id, g_target_id, node);
+        auto compiler = std::make_shared<Compiler>(g_device_id, g_target_id, g_cache_options, node);
         return [compiler](Stack& stack) {
           RECORD_FUNCTION("PlaidML", std::vector<c10::IValue>());
           compiler->run(&stack);
@@ -66,5 +68,27 @@ PYBIND11_MODULE(plaidml_pytorch, module) {
       pybind11::arg("device_id"),  //
       pybind11::arg("target_id"));
   module.def("disable", []() { g_fusion_enabled = false; });
+  // Applies to subgraphs compiled after the call.
+  module.def(
+      "set_cache_options",
+      [](const std::vector<int64_t>& buckets,  //
+         const std::vector<size_t>& inputs,    //
+         const std::vector<size_t>& dims,      //
+         size_t max_entries,                   //
+         size_t max_bytes,                     //
+         bool precompile) {
+        g_cache_options.buckets = buckets;
+        g_cache_options.inputs = inputs;
+        g_cache_options.dims = dims;
+        g_cache_options.max_entries = max_entries;
+        g_cache_options.max_bytes = max_bytes;
+        g_cache_options.precompile = precompile;
+      },
+      pybind11::arg("buckets") = std::vector<int64_t>{},  //
+      pybind11::arg("inputs") = std::vector<size_t>{0},   //
+      pybind11::arg("dims") = std::vector<size_t>{0},     //
+      pybind11::arg("max_entries") = 64,                  //
+      pybind11::arg("max_bytes") = 0,                     //
+      pybind11::arg("precompile") = false);
   module.def("set_vlog", [](size_t verbosity) { g_verbosity = verbosity; });
 }
@@ -7,6 +7,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "plaidml2/core/ffi.h"
@@ -58,6 +59,22 @@ inline std::shared_ptr<plaidml_buffer> make_plaidml_buffer(plaidml_buffer* ptr)
   return std::shared_ptr<plaidml_buffer>(ptr, Deleter<plaidml_buffer>{plaidml_buffer_free});
 }
 
+inline void release_host_memory(void* arg) {
+  std::unique_ptr<std::function<void()>> release{static_cast<std::function<void()>*>(arg)};
+  if (*release) {
+    (*release)();
+  }
+}
+
+inline plaidml_buffer* wrap_host_memory(const std::string& device, void* data, size_t size,
+                                        std::function<void()> release) {
+  auto holder = std::make_unique<std::function<void()>>(std::move(release));
+  auto ptr = ffi::call<plaidml_buffer*>(plaidml_buffer_wrap, device.c_str(), data, size, release_host_memory,
+                                        static_cast<void*>(holder.get()));
+  holder.release();
+  return ptr;
+}
+
 inline std::shared_ptr<plaidml_view> make_plaidml_view(plaidml_view* ptr) {
   return std::shared_ptr<plaidml_view>(ptr, Deleter<plaidml_view>{plaidml_view_free});
 }
@@ -140,6 +157,13 @@ class Buffer {
             ffi::call<plaidml_buffer*>(plaidml_buffer_alloc, device.c_str(), shape.nbytes()))),
         shape_(shape) {}
 
+  // Wraps caller-owned host memory holding a tensor of the given shape, which
+  // programs then read and write in place; see plaidml_buffer_wrap().
+  Buffer(const std::string& device, const TensorShape& shape, void* data, std::function<void()> release = nullptr)
+      : ptr_(details::make_plaidml_buffer(
+            details::wrap_host_memory(device, data, shape.nbytes(), std::move(release)))),
+        shape_(shape) {}
+
   explicit Buffer(plaidml_buffer* ptr, const TensorShape& shape)
       : ptr_(details::make_plaidml_buffer(ptr)), shape_(shape) {}
 
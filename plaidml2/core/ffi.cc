@@ -3,6 +3,7 @@
 #include "plaidml2/core/ffi.h"
 
 #include <cstdlib>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <utility>
@@ -327,6 +328,24 @@ plaidml_buffer* plaidml_buffer_alloc(  //
   });
 }
 
+plaidml_buffer* plaidml_buffer_wrap(     //
+    plaidml_error* err,                  //
+    const char* device_id,               //
+    void* data,                          //
+    size_t size,                         //
+    void (*release)(void* release_arg),  //
+    void* release_arg) {
+  return ffi_wrap<plaidml_buffer*>(err, nullptr, [&] {
+    auto ctx = GlobalContext::getContext();
+    std::function<void()> on_release;
+    if (release) {
+      on_release = [release, release_arg] { release(release_arg); };
+    }
+    auto buffer = GetPlatform()->WrapBuffer(*ctx, device_id, data, size, std::move(on_release));
+    return new plaidml_buffer{buffer};
+  });
+}
+
 plaidml_view* plaidml_buffer_mmap_current(  //
     plaidml_error* err,                     //
     plaidml_buffer* buffer) {
@@ -199,6 +199,20 @@ plaidml_buffer* plaidml_buffer_alloc(  //
     const char* device_id,             //
     size_t size);
 
+// Wraps `size` bytes of caller-owned host memory at `data` as a buffer, which
+// programs read and write in place.  The memory must stay valid, and be
+// aligned to at least the element size of the tensors it holds, until
+// `release` is called; that happens once the buffer has been freed and is no
+// longer used by any program.  `release` may be NULL; it is not called if
+// wrapping fails.  Only the CPU device supports host memory.
+plaidml_buffer* plaidml_buffer_wrap(     //
+    plaidml_error* err,                  //
+    const char* device_id,               //
+    void* data,                          //
+    size_t size,                         //
+    void (*release)(void* release_arg),  //
+    void* release_arg);
+
 plaidml_view* plaidml_buffer_mmap_current(  //
     plaidml_error* err,                     //
     plaidml_buffer* buffer);
@@ -0,0 +1,68 @@
+// Copyright 2020, Intel Corporation
+
+// Measures how long it takes to build an EDSL graph op by op, asking for the
+// shape of each layer as it is added, as a frontend does. The time per layer
+// should not grow with the depth of the network.
+//
+// Run with: bazel run //plaidml2/edsl:bench_mlir
+
+#include "benchmark/benchmark.h"
+
+#include "plaidml2/edsl/edsl.h"
+
+namespace plaidml::edsl {
+
+namespace {
+
+Tensor Dense(const Tensor& X, const Tensor& W, const Tensor& B) {
+  TensorDim N, I, O;
+  TensorIndex n, i, o;
+  X.bind_dims(N, I);
+  W.bind_dims(I, O);
+  auto R = TensorOutput(N, O);
+  R(n, o) += X(n, i) * W(i, o);
+  return select(R + B < 0.0, Tensor{0.0}, R + B);
+}
+
+Tensor Pad(const Tensor& X) {
+  TensorDim N, I;
+  TensorIndex n, i;
+  X.bind_dims(N, I);
+  auto R = TensorOutput(N, I + 2);
+  R(n, i + 1) = X(n, i);
+  return R;
+}
+
+}  // namespace
+
+struct edsl_bench : public benchmark::Fixture {
+  void SetUp(const benchmark::State& state) {  //
+    init();
+  }
+};
+
+BENCHMARK_DEFINE_F(edsl_bench, build)(benchmark::State& state) {  // NOLINT[runtime/references]
+  auto layers = state.range(0);
+  for (auto _ : state) {
+    auto X = Placeholder(PLAIDML_DATA_FLOAT32, {1, 64});
+    for (int64_t i = 0; i < layers; i++) {
+      // Each layer's weights are sized from the shape of the layer before it
+      auto P = Pad(X);
+      auto width = P.shape().int_dims()[1];
+      X = Dense(P, Placeholder(PLAIDML_DATA_FLOAT32, {width, 64}), Placeholder(PLAIDML_DATA_FLOAT32, {64}));
+    }
+    benchmark::DoNotOptimize(X.shape());
+  }
+  state.SetComplexityN(layers);
+  state.SetItemsProcessed(state.iterations() * layers);
+}
+
+BENCHMARK_REGISTER_F(edsl_bench, build)
+    ->Arg(50)
+    ->Arg(100)
+    ->Arg(250)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity(benchmark::oN);
+
+}  // namespace plaidml::edsl
@@ -255,6 +255,81 @@ TEST(CppEdsl, Add) {
   }
 }
 
+TEST(CppEdsl, Rebind) {
+  auto A = Placeholder(PLAIDML_DATA_FLOAT32, {4});
+  auto B = Placeholder(PLAIDML_DATA_FLOAT32, {4});
+  auto C = A + B;
+  Program program("rebind", {C});
+  auto binder = exec::Binder(program);
+  auto executable = binder.compile();
+
+  auto device = Settings::get("PLAIDML_DEVICE");
+  TensorShape shape(PLAIDML_DATA_FLOAT32, {4});
+  std::vector<float> input_a = {1, 2, 3, 4};
+  std::vector<float> input_b = {10, 20, 30, 40};
+  binder.input(A).copy_from(input_a.data());
+  binder.input(B).copy_from(input_b.data());
+
+  // Run twice more, each time with fresh buffers for A and C.
+  for (float scale : {100.0f, 1000.0f}) {
+    std::vector<float> input(4);
+    std::vector<float> expected(4);
+    for (size_t i = 0; i < input.size(); i++) {
+      input[i] = scale * (i + 1);
+      expected[i] = input[i] + input_b[i];
+    }
+    Buffer buffer_a(device, shape);
+    buffer_a.copy_from(input.data());
+    Buffer buffer_c(device, shape);
+    executable->run({{A, buffer_a}}, {{C, buffer_c}});
+    std::vector<float> actual(4);
+    buffer_c.copy_into(actual.data());
+    EXPECT_THAT(actual, ContainerEq(expected));
+  }
+
+  // The buffers bound at compile time are still in place.
+  executable->run();
+  std::vector<float> actual(4);
+  binder.output(C).copy_into(actual.data());
+  EXPECT_THAT(actual, ContainerEq(std::vector<float>{11, 22, 33, 44}));
+
+  // Rebinding requires a buffer of the same size.
+  Buffer small(device, TensorShape(PLAIDML_DATA_FLOAT32, {2}));
+  EXPECT_THROW(executable->run({{A, small}}, {}), std::runtime_error);
+}
+
+TEST(CppEdsl, HostBuffers) {
+  auto device = Settings::get("PLAIDML_DEVICE");
+  if (device != "llvm_cpu.0") {
+    // Only the CPU device can wrap host memory.
+    return;
+  }
+  std::vector<float> input_a = {1, 2, 3, 4};
+  std::vector<float> input_b = {5, 6, 7, 8};
+  std::vector<float> output(4);
+  int released = 0;
+  {
+    auto A = Placeholder(PLAIDML_DATA_FLOAT32, {4});
+    auto B = Placeholder(PLAIDML_DATA_FLOAT32, {4});
+    auto C = A * B;
+    Program program("host_buffers", {C});
+    TensorShape shape(PLAIDML_DATA_FLOAT32, {4});
+    auto executable = exec::Binder(program)
+                          .set_input(A, Buffer(device, shape, input_a.data(), [&] { released++; }))
+                          .set_input(B, Buffer(device, shape, input_b.data(), [&] { released++; }))
+                          .set_output(C, Buffer(device, shape, output.data(), [&] { released++; }))
+                          .compile();
+    executable->run();
+    // The program reads and writes the caller's memory directly.
+    EXPECT_THAT(output, ContainerEq(std::vector<float>{5, 12, 21, 32}));
+    input_a[0] = 10;
+    executable->run();
+    EXPECT_THAT(output[0], Eq(50));
+  }
+  // Each buffer hands its memory back once nothing refers to it.
+  EXPECT_THAT(released, Eq(3));
+}
+
 TEST(CppEdsl, Dot) {
   auto A = Placeholder(PLAIDML_DATA_FLOAT32, {3, 3});
   auto B = Placeholder(PLAIDML_DATA_FLOAT32, {3, 3});
@@ -304,6 +379,43 @@ module {
   }
 }
 
+// Reductions large enough to be split across threads: one over an index
+// which may be partitioned, and one over every index, which may not.
+TEST(CppEdsl, ParallelReduction) {
+  const int64_t kRows = 64;
+  const int64_t kCols = 256;
+  auto A = Placeholder(PLAIDML_DATA_FLOAT32, {kRows, kCols});
+  TensorIndex i, j;
+  auto ColSums = TensorOutput(kCols);
+  ColSums(j) += A(i, j);
+  auto Total = TensorOutput();
+  Total() += A(i, j);
+  Program program("parallel_reduction", {ColSums, Total});
+
+  std::vector<float> input(kRows * kCols);
+  std::vector<float> expected_col_sums(kCols);
+  float expected_total = 0;
+  for (int64_t r = 0; r < kRows; r++) {
+    for (int64_t c = 0; c < kCols; c++) {
+      float value = (r * kCols + c) % 7;
+      input[r * kCols + c] = value;
+      expected_col_sums[c] += value;
+      expected_total += value;
+    }
+  }
+
+  auto binder = exec::Binder(program);
+  auto executable = binder.compile();
+  binder.input(A).copy_from(input.data());
+  executable->run();
+  std::vector<float> col_sums(kCols);
+  binder.output(ColSums).copy_into(col_sums.data());
+  EXPECT_THAT(col_sums, ContainerEq(expected_col_sums));
+  float total = 0;
+  binder.output(Total).copy_into(&total);
+  EXPECT_THAT(total, Eq(expected_total));
+}
+
 TEST(CppEdsl, DoubleDot) {
   auto A = Placeholder(PLAIDML_DATA_FLOAT32, {10, 20});
   auto B = Placeholder(PLAIDML_DATA_FLOAT32, {20, 30});
@@ -1356,6 +1468,41 @@ module {
   EXPECT_THAT(data[1], 20);
 }
 
+TEST(CppEdsl, InferShape) {
+  auto A = Placeholder(PLAIDML_DATA_FLOAT32, {4, 10});
+  auto B = Placeholder(PLAIDML_DATA_FLOAT32, {10, 3});
+  TensorDim N, I;
+  TensorIndex n, i;
+  A.bind_dims(N, I);
+  auto P = TensorOutput(N, 2 * I - 1);
+  P(n, 2 * i) = A(n, i);
+  EXPECT_THAT(P.shape().int_dims(), ContainerEq(std::vector<int64_t>{4, 19}));
+  auto C = Dot(Relu(A), B);
+  EXPECT_THAT(C.shape().int_dims(), ContainerEq(std::vector<int64_t>{4, 3}));
+  auto D = exp(C) + Dot(P, Placeholder(PLAIDML_DATA_FLOAT32, {19, 3}));
+  EXPECT_THAT(D.shape().int_dims(), ContainerEq(std::vector<int64_t>{4, 3}));
+}
+
+#ifdef PLAIDML_MLIR
+TEST(CppEdsl, InferShapeAfterBind) {
+  // Frontends may bind a placeholder to a new shape after building on it.
+  auto A = Placeholder(PLAIDML_DATA_FLOAT32, {4, 10});
+  auto B = Placeholder(PLAIDML_DATA_FLOAT32, {10, 3});
+  TensorDim N, I;
+  TensorIndex n, i;
+  A.bind_dims(N, I);
+  auto P = TensorOutput(N, 2 * I - 1);
+  P(n, 2 * i) = A(n, i);
+  auto C = exp(Dot(Relu(A), B));
+  EXPECT_THAT(P.shape().int_dims(), ContainerEq(std::vector<int64_t>{4, 19}));
+  EXPECT_THAT(C.shape().int_dims(), ContainerEq(std::vector<int64_t>{4, 3}));
+  LogicalShape shape(PLAIDML_DATA_FLOAT32, {8, 10});
+  ffi::call_void(plaidml_expr_bind_shape, A.as_ptr(), shape.as_ptr());
+  EXPECT_THAT(P.shape().int_dims(), ContainerEq(std::vector<int64_t>{8, 19}));
+  EXPECT_THAT(C.shape().int_dims(), ContainerEq(std::vector<int64_t>{8, 3}));
+}
+#endif  // PLAIDML_MLIR
+
 TEST(CppEdsl, Prng) {
   auto S = Placeholder(PLAIDML_DATA_UINT32, {3, 2048});
   auto O = prng(S, {2, 3, 4, 5});
@@ -61,8 +61,24 @@ class Executable(ForeignObject):
         )
         super(Executable, self).__init__(ffi_obj)
 
-    def run(self):
-        ffi_call(lib.plaidml_executable_run, self.as_ptr())
+    def run(self, inputs=None, outputs=None):
+        if inputs is None and outputs is None:
+            ffi_call(lib.plaidml_executable_run, self.as_ptr())
+            return
+
+        def wrap(x, y):
+            return ffi.new('plaidml_binding*', [x.as_ptr(), y.as_ptr()])
+
+        inputs = [wrap(x, y) for x, y in inputs or []]
+        outputs = [wrap(x, y) for x, y in outputs or []]
+        ffi_call(
+            lib.plaidml_executable_run_with,
+            self.as_ptr(),
+            len(inputs),
+            inputs,
+            len(outputs),
+            outputs,
+        )
 
 
 class Binder:
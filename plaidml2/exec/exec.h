@@ -104,6 +104,32 @@ class Executable {
     ffi::call_void(plaidml_executable_run, ptr_.get());
   }
 
+  // Runs the executable once with new buffers for some of its tensors; see
+  // plaidml_executable_run_with().
+  void run(const std::vector<Binding>& inputs, const std::vector<Binding>& outputs) {
+    std::vector<plaidml_binding> inputs_storage(inputs.size());
+    std::vector<plaidml_binding*> raw_inputs(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+      inputs_storage[i].expr = inputs[i].tensor.as_ptr();
+      inputs_storage[i].buffer = inputs[i].buffer.as_ptr();
+      raw_inputs[i] = &inputs_storage[i];
+    }
+    std::vector<plaidml_binding> outputs_storage(outputs.size());
+    std::vector<plaidml_binding*> raw_outputs(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+      outputs_storage[i].expr = outputs[i].tensor.as_ptr();
+      outputs_storage[i].buffer = outputs[i].buffer.as_ptr();
+      raw_outputs[i] = &outputs_storage[i];
+    }
+    ffi::call_void(                   //
+        plaidml_executable_run_with,  //
+        ptr_.get(),                   //
+        raw_inputs.size(),            //
+        raw_inputs.data(),            //
+        raw_outputs.size(),           //
+        raw_outputs.data());
+  }
+
  private:
   std::shared_ptr<plaidml_executable> ptr_;
 };
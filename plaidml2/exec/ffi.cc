@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -56,6 +57,14 @@ using namespace mlir;  // NOLINT[build/namespaces]
 
 namespace {
 
+// A rebound buffer must be the same size as the one the program was compiled
+// with; executables are compiled for fixed shapes.
+void CheckRebinding(size_t expected, size_t actual) {
+  if (expected != actual) {
+    throw std::runtime_error(llvm::formatv("Rebound buffer has {0} bytes, expected {1}", actual, expected));
+  }
+}
+
 class PlatformAllocator : public Allocator {
  public:
   explicit PlatformAllocator(const std::string& device_id) : device_id_(device_id) {}
@@ -112,6 +121,14 @@ std::vector<ProgramArgument> BindProgramArguments(  //
   return args;
 }
 
+std::vector<void*> ViewPointers(const std::vector<std::shared_ptr<View>>& views) {
+  std::vector<void*> ptrs(views.size());
+  for (unsigned i = 0; i < views.size(); i++) {
+    ptrs[i] = views[i]->data();
+  }
+  return ptrs;
+}
+
 #endif  // PLAIDML_MLIR
 
 }  // namespace
@@ -123,8 +140,21 @@ struct plaidml_executable {
   BufferMap input_bufs;
   BufferMap output_bufs;
   std::shared_ptr<Program> program;
+#ifdef PLAIDML_AST
+  // The parameter names of the expressions whose buffers may be rebound.
+  std::unordered_map<ExprPtr, std::string> arg_names;
+#endif  // PLAIDML_AST
 #ifdef PLAIDML_MLIR
+  llvm::DenseMap<Value, std::string> arg_names;
   std::unique_ptr<Executable> exec;
+  // The mappings of the buffers the executable reads and writes in place;
+  // these keep the buffers (and any host memory they wrap) alive.
+  std::vector<std::shared_ptr<View>> views;
+  // The position of each program argument among the executable's buffers.
+  llvm::DenseMap<Value, unsigned> arg_indexes;
+  // The executable binds its arguments into descriptors shared by every run,
+  // so runs take turns.
+  std::mutex mu;
 #endif  // PLAIDML_MLIR
 };
 
@@ -216,6 +246,7 @@ plaidml_executable* plaidml_compile(  //
       output_bindings[outputs[i]->expr->expr] = outputs[i]->buffer->buffer;
     }
     for (const auto& arg : program->eval.args) {
+      exec->arg_names[arg.expr] = arg.name;
       if (arg.is_input) {
         auto it = input_bindings.find(arg.expr);
         auto param_expr = std::dynamic_pointer_cast<ParamExpr>(arg.expr);
@@ -241,8 +272,10 @@ plaidml_executable* plaidml_compile(  //
       auto exec = std::make_unique<plaidml_executable>();
       std::vector<void*> bufptrs(args.size());
       for (unsigned i = 0; i < args.size(); i++) {
-        auto view = args[i].buffer->MapCurrent(*ctx).get();
+        std::shared_ptr<View> view = args[i].buffer->MapCurrent(*ctx).get();
         bufptrs[i] = view->data();
+        exec->views.emplace_back(std::move(view));
+        exec->arg_indexes[args[i].value] = i;
       }
       exec->exec = std::make_unique<Executable>(program->program->entry, target, *program->program->module, bufptrs);
       return exec.release();
@@ -267,6 +300,7 @@ plaidml_executable* plaidml_compile(  //
         throw std::runtime_error("Missing expected argument attribute");
       }
       auto name = attr.getValue().str();
+      exec->arg_names[arg.value] = name;
       if (arg.isInput) {
         exec->input_bufs[name] = arg.buffer;
       } else {
@@ -287,13 +321,66 @@ void plaidml_executable_free(  //
   });
 }
 
+void plaidml_executable_run_with(  //
+    plaidml_error* err,            //
+    plaidml_executable* exec,      //
+    size_t ninputs,                //
+    plaidml_binding** inputs,      //
+    size_t noutputs,               //
+    plaidml_binding** outputs) {
+  ffi_wrap_void(err, [&] {
+    std::vector<plaidml_binding*> bindings(inputs, inputs + ninputs);
+    bindings.insert(bindings.end(), outputs, outputs + noutputs);
+    auto ctx = GlobalContext::getContext();
+#ifdef PLAIDML_MLIR
+    if (exec->exec) {
+      std::vector<std::shared_ptr<View>> views = exec->views;
+      for (auto binding : bindings) {
+        auto it = exec->arg_indexes.find(binding->expr->value);
+        if (it == exec->arg_indexes.end()) {
+          throw std::runtime_error("Binding does not refer to a program argument");
+        }
+        std::shared_ptr<View> view = binding->buffer->buffer->MapCurrent(*ctx).get();
+        CheckRebinding(views[it->second]->size(), view->size());
+        views[it->second] = std::move(view);
+      }
+      std::lock_guard<std::mutex> lock{exec->mu};
+      exec->exec->invoke(ViewPointers(views));
+      return;
+    }
+#endif  // PLAIDML_MLIR
+    auto input_bufs = exec->input_bufs;
+    auto output_bufs = exec->output_bufs;
+    for (size_t i = 0; i < bindings.size(); i++) {
+#ifdef PLAIDML_AST
+      auto it = exec->arg_names.find(bindings[i]->expr->expr);
+#endif  // PLAIDML_AST
+#ifdef PLAIDML_MLIR
+      auto it = exec->arg_names.find(bindings[i]->expr->value);
+#endif  // PLAIDML_MLIR
+      auto& bufs = (i < ninputs) ? input_bufs : output_bufs;
+      auto it_buf = (it == exec->arg_names.end()) ? bufs.end() : bufs.find(it->second);
+      if (it_buf == bufs.end()) {
+        throw std::runtime_error(i < ninputs ? "Binding does not refer to a program input"
+                                             : "Binding does not refer to a program output");
+      }
+      CheckRebinding(it_buf->second->size(), bindings[i]->buffer->buffer->size());
+      it_buf->second = bindings[i]->buffer->buffer;
+    }
+    exec->program->Run(*ctx, input_bufs, output_bufs).get();
+  });
+}
+
 void plaidml_executable_run(  //
     plaidml_error* err,       //
     plaidml_executable* exec) {
   ffi_wrap_void(err, [&] {
 #ifdef PLAIDML_MLIR
     if (exec->exec) {
-      exec->exec->invoke();
+      // Restore the buffers bound at compile time, in case a previous run
+      // rebound them.
+      std::lock_guard<std::mutex> lock{exec->mu};
+      exec->exec->invoke(ViewPointers(exec->views));
     } else {
 #endif  // PLAIDML_MLIR
       auto ctx = GlobalContext::getContext();
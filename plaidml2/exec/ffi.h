@@ -43,10 +43,31 @@ void plaidml_executable_free(  //
     plaidml_error* err,        //
     plaidml_executable* exec);
 
+// Runs a compiled executable with the buffers bound when it was compiled.
+//
+// An executable may be run from several threads at once, by either
+// plaidml_executable_run or plaidml_executable_run_with; each call returns once
+// its run has completed.  Runs which share a buffer are not ordered with
+// respect to each other, so callers must order runs writing a buffer that
+// another run reads or writes.  An executable must not be freed while it is
+// running.
 void plaidml_executable_run(  //
     plaidml_error* err,       //
     plaidml_executable* exec);
 
+// Runs a compiled executable once with new buffers for some of its inputs
+// and outputs.  Each binding must name a tensor bound when the executable was
+// compiled, and its buffer must be the same size as the one bound then; other
+// tensors use the buffers bound at compile time.  The compiled code and
+// constant buffers are shared by every run.
+void plaidml_executable_run_with(  //
+    plaidml_error* err,            //
+    plaidml_executable* exec,      //
+    size_t ninputs,                //
+    plaidml_binding** inputs,      //
+    size_t noutputs,               //
+    plaidml_binding** outputs);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
@@ -5,8 +5,12 @@
 #include <unordered_map>
 #include <utility>
 
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Host.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "tbb/tbb.h"
 
 #include "mlir/Dialect/StandardOps/Ops.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
@@ -18,9 +22,12 @@
 
 #include "base/util/logging.h"
 #include "pmlc/compiler/registry.h"
+#include "pmlc/conversion/pxa_to_affine/outline_parallel.h"
 #include "pmlc/conversion/tile_to_pxa/tile_to_pxa.h"
 
 using namespace mlir;  // NOLINT[build/namespaces]
+using pmlc::conversion::pxa_to_affine::createOutlineParallelForPass;
+using pmlc::conversion::pxa_to_affine::ParallelPlan;
 using pmlc::conversion::tile_to_pxa::createLowerTileToPXAPass;
 
 namespace pmlc::compiler {
@@ -103,6 +110,37 @@ class InjectTracingPass : public FunctionPass<InjectTracingPass> {
 
 using MemRefTypes = std::vector<MemRefType>;
 
+llvm::CodeGenOpt::Level getCodeGenOptLevel(unsigned optLevel) {
+  switch (optLevel) {
+    case 0:
+      return llvm::CodeGenOpt::None;
+    case 1:
+      return llvm::CodeGenOpt::Less;
+    case 2:
+      return llvm::CodeGenOpt::Default;
+    default:
+      return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+// Builds a TargetMachine describing the host, so that the LLVM optimization
+// pipeline (e.g. the loop and SLP vectorizers) can make use of its features.
+std::unique_ptr<llvm::TargetMachine> makeHostTargetMachine(unsigned optLevel) {
+  auto maybeBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!maybeBuilder) {
+    llvm::consumeError(maybeBuilder.takeError());
+    throw std::runtime_error("Failed to detect the host target");
+  }
+  maybeBuilder->setCPU(llvm::sys::getHostCPUName());
+  maybeBuilder->setCodeGenOptLevel(getCodeGenOptLevel(optLevel));
+  auto maybeMachine = maybeBuilder->createTargetMachine();
+  if (!maybeMachine) {
+    llvm::consumeError(maybeMachine.takeError());
+    throw std::runtime_error("Failed to create a TargetMachine for the host");
+  }
+  return std::move(*maybeMachine);
+}
+
 class ArgumentCollectorPass : public FunctionPass<ArgumentCollectorPass> {
  public:
   explicit ArgumentCollectorPass(MemRefTypes* into) : into(into) {}
@@ -157,6 +195,12 @@ class MemRefDescriptor {
 
   void* ptr() { return memory.data(); }
 
+  void setData(void* data) {
+    auto base = reinterpret_cast<Base*>(memory.data());
+    base->basePtr = data;
+    base->data = data;
+  }
+
  private:
   static unsigned computeSize(MemRefType type) {
     return sizeof(void*) +                     // allocatedPtr
@@ -198,6 +242,12 @@ Executable::Executable(StringRef entry, StringRef target, ModuleOp programModule
     manager.addPass(InjectTracingPass::create());
   }
 
+  auto options = resolveTargetOptions(target);
+  ParallelPlan plan;
+  if (options.parallel) {
+    manager.addPass(createOutlineParallelForPass(entry.str(), &plan));
+  }
+
   auto pipelineBuilder = resolveTarget(target);
   pipelineBuilder(&manager);
 
@@ -207,9 +257,13 @@ Executable::Executable(StringRef entry, StringRef target, ModuleOp programModule
 
   assert(memRefTypes.size() == bufptrs.size() && "memRefTypes and bufptrs size mismatch");
 
+  std::unique_ptr<llvm::TargetMachine> targetMachine;
+  if (options.hostFeatures) {
+    targetMachine = makeHostTargetMachine(options.optLevel);
+  }
   auto optPipeline = makeOptimizingTransformer(
-      /*optLevel=*/0, /*sizeLevel=*/0,
-      /*targetMachine=*/nullptr);
+      /*optLevel=*/options.optLevel, /*sizeLevel=*/0,
+      /*targetMachine=*/targetMachine.get());
 
   if (VLOG_IS_ON(6)) {
     auto llvmModule = translateModuleToLLVMIR(*module);
@@ -219,28 +273,84 @@ Executable::Executable(StringRef entry, StringRef target, ModuleOp programModule
     llvmModule->print(llvm::errs(), nullptr);
   }
 
-  auto maybeEngine = ExecutionEngine::create(*module, optPipeline);
+  auto maybeEngine = ExecutionEngine::create(*module, optPipeline, getCodeGenOptLevel(options.optLevel));
   llvm::handleAllErrors(maybeEngine.takeError(), [](const llvm::ErrorInfoBase& b) {
     b.log(llvm::errs());
     throw std::runtime_error("Failed to create ExecutionEngine");
   });
   engine = std::move(*maybeEngine);
 
-  descriptors.reserve(args.size());
+  // Reserve room for the temporaries so that the addresses taken below remain stable.
+  descriptors.reserve(args.size() + plan.temporaries.size());
+  ptrs.reserve(args.size() + plan.temporaries.size());
   for (unsigned i = 0; i < args.size(); i++) {
     descriptors.emplace_back(bufptrs[i], memRefTypes[i]);
     ptrs[i] = descriptors[i].ptr();
     args[i] = &ptrs[i];
   }
+
+  if (plan.valid) {
+    // Tasks are passed the program's buffers followed by its temporaries,
+    // which are allocated once here rather than on each invocation.
+    for (auto type : plan.temporaries) {
+      auto elementSize = (type.getElementTypeBitWidth() + 7) / 8;
+      temporaries.emplace_back(type.getNumElements() * elementSize);
+      descriptors.emplace_back(temporaries.back().data(), type);
+      ptrs.push_back(descriptors.back().ptr());
+    }
+    for (const auto& task : plan.tasks) {
+      auto maybeFunction = engine->lookup(task.name);
+      if (!maybeFunction) {
+        llvm::consumeError(maybeFunction.takeError());
+        throw std::runtime_error(llvm::formatv("Could not find parallel task: {0}", task.name));
+      }
+      tasks.emplace_back(Task{*maybeFunction, task.range});
+    }
+  }
 }
 
 Executable::~Executable() = default;
 
 void Executable::invoke() {
+  if (tasks.size()) {
+    invokeTasks();
+    return;
+  }
   auto result = engine->invoke(entry, llvm::MutableArrayRef<void*>(args));
   if (result) {
     throw std::runtime_error("JIT invocation failed");
   }
 }
 
+void Executable::invoke(ArrayRef<void*> bufptrs) {
+  if (bufptrs.size() != args.size()) {
+    throw std::runtime_error(llvm::formatv("Expected {0} buffers, got {1}", args.size(), bufptrs.size()));
+  }
+  for (unsigned i = 0; i < bufptrs.size(); i++) {
+    descriptors[i].setData(bufptrs[i]);
+  }
+  invoke();
+}
+
+void Executable::invokeTasks() {
+  for (const auto& task : tasks) {
+    auto runChunk = [&](int64_t lo, int64_t hi) {
+      std::vector<void*> packed;
+      packed.reserve(ptrs.size() + 2);
+      packed.push_back(&lo);
+      packed.push_back(&hi);
+      for (auto& ptr : ptrs) {
+        packed.push_back(&ptr);
+      }
+      task.function(packed.data());
+    };
+    if (task.range > 1) {
+      tbb::parallel_for(tbb::blocked_range<int64_t>(0, task.range),
+                        [&](const tbb::blocked_range<int64_t>& r) { runChunk(r.begin(), r.end()); });
+    } else {
+      runChunk(0, 1);
+    }
+  }
+}
+
 }  // namespace pmlc::compiler
@@ -23,14 +23,30 @@ class Executable {
 
   void invoke();
 
+  // Invokes the program with a new set of buffers, one for each of the
+  // buffers it was constructed with and of the same type.  The new buffers
+  // remain bound for later invocations.  Invocations must not overlap, since
+  // they share the program's temporaries.
+  void invoke(mlir::ArrayRef<void*> bufptrs);
+
   static void initialize();
 
  private:
+  // An outlined parallel loop, invoked over chunks of [0, range).
+  struct Task {
+    void (*function)(void**);
+    int64_t range;
+  };
+
+  void invokeTasks();
+
   std::string entry;
   std::unique_ptr<mlir::ExecutionEngine> engine;
   std::vector<MemRefDescriptor> descriptors;
   std::vector<void*> args;
   std::vector<void*> ptrs;
+  std::vector<Task> tasks;
+  std::vector<std::vector<char>> temporaries;
 };
 
 }  // namespace pmlc::compiler
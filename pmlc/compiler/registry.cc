@@ -22,19 +22,19 @@ class TargetRegistry {
     return &registry;
   }
 
-  void registerTarget(StringRef name, const TargetRegistryFunction& function) {  //
+  void registerTarget(StringRef name, const TargetRegistryFunction& function, const TargetOptions& options) {
     if (registry.count(name)) {
       throw std::runtime_error(formatv("Target is already registered: {0}", name));
     }
-    registry[name] = function;
+    registry[name] = Entry{function, options};
   }
 
-  TargetRegistryFunction resolve(StringRef name) {
-    auto it = registry.find(name);
-    if (it == registry.end()) {
-      throw std::runtime_error(formatv("Could not find target: {0}", name));
-    }
-    return it->second;
+  TargetRegistryFunction resolve(StringRef name) {  //
+    return lookup(name).function;
+  }
+
+  TargetOptions resolveOptions(StringRef name) {  //
+    return lookup(name).options;
   }
 
   std::vector<StringRef> list() {
@@ -47,19 +47,36 @@ class TargetRegistry {
   }
 
  private:
-  std::unordered_map<std::string, TargetRegistryFunction> registry;
+  struct Entry {
+    TargetRegistryFunction function;
+    TargetOptions options;
+  };
+
+  const Entry& lookup(StringRef name) {
+    auto it = registry.find(name);
+    if (it == registry.end()) {
+      throw std::runtime_error(formatv("Could not find target: {0}", name));
+    }
+    return it->second;
+  }
+
+  std::unordered_map<std::string, Entry> registry;
 };
 
 }  // namespace
 
-void registerTarget(mlir::StringRef name, const TargetRegistryFunction& function) {
-  TargetRegistry::Instance()->registerTarget(name, function);
+void registerTarget(mlir::StringRef name, const TargetRegistryFunction& function, const TargetOptions& options) {
+  TargetRegistry::Instance()->registerTarget(name, function, options);
 }
 
 TargetRegistryFunction resolveTarget(mlir::StringRef name) {  //
   return TargetRegistry::Instance()->resolve(name);
 }
 
+TargetOptions resolveTargetOptions(mlir::StringRef name) {  //
+  return TargetRegistry::Instance()->resolveOptions(name);
+}
+
 std::vector<mlir::StringRef> listTargets() {  //
   return TargetRegistry::Instance()->list();
 }
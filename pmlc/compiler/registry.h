@@ -15,13 +15,26 @@ namespace pmlc::compiler {
 
 using TargetRegistryFunction = std::function<void(mlir::OpPassManager*)>;
 
-void registerTarget(llvm::StringRef name, const TargetRegistryFunction& function);
+// Controls how the LLVM IR produced by a target's pipeline is compiled.
+struct TargetOptions {
+  // The LLVM optimization level (0-3) applied before code generation.
+  unsigned optLevel = 0;
+  // Generate code for the host processor's features rather than a baseline.
+  bool hostFeatures = false;
+  // Run the top-level parallel loops of a program across multiple threads.
+  bool parallel = false;
+};
+
+void registerTarget(llvm::StringRef name, const TargetRegistryFunction& function,
+                    const TargetOptions& options = TargetOptions{});
 TargetRegistryFunction resolveTarget(llvm::StringRef name);
+TargetOptions resolveTargetOptions(llvm::StringRef name);
 std::vector<llvm::StringRef> listTargets();
 
 struct TargetRegistration {
-  TargetRegistration(llvm::StringRef name, TargetRegistryFunction builder) {  //
-    registerTarget(name, builder);
+  TargetRegistration(llvm::StringRef name, TargetRegistryFunction builder,
+                     const TargetOptions& options = TargetOptions{}) {
+    registerTarget(name, builder, options);
   }
 };
 
@@ -0,0 +1,261 @@
+// Copyright 2020, Intel Corporation
+
+#include "pmlc/conversion/pxa_to_affine/outline_parallel.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "mlir/Dialect/AffineOps/AffineOps.h"
+#include "mlir/Dialect/StandardOps/Ops.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Pass/Pass.h"
+
+#include "base/util/logging.h"
+#include "pmlc/dialect/pxa/ir/ops.h"
+
+namespace pmlc::conversion::pxa_to_affine {
+
+namespace pxa = dialect::pxa;
+
+using mlir::AffineDimExpr;
+using mlir::AffineForOp;
+using mlir::AffineMap;
+using mlir::AffineStoreOp;
+using mlir::AffineTerminatorOp;
+using mlir::AllocOp;
+using mlir::ArrayRef;
+using mlir::BlockAndValueMapping;
+using mlir::ConstantOp;
+using mlir::DeallocOp;
+using mlir::FuncOp;
+using mlir::IntegerAttr;
+using mlir::MemRefType;
+using mlir::ModuleOp;
+using mlir::OpBuilder;
+using mlir::Operation;
+using mlir::ReturnOp;
+using mlir::Type;
+using mlir::Value;
+
+namespace {
+
+// Returns true if the access map addresses memory directly by idx in one of
+// its dimensions, so that distinct values of idx touch distinct elements.
+bool isIndexedBy(AffineMap map, mlir::ValueRange operands, Value idx) {
+  for (auto expr : map.getResults()) {
+    auto dimExpr = expr.dyn_cast<AffineDimExpr>();
+    if (dimExpr && dimExpr.getPosition() < map.getNumDims() && operands[dimExpr.getPosition()] == idx) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if the iterations of the given index of a parallel_for may run
+// concurrently: every write to memory defined outside the loop must be
+// addressed by the index. Reductions over other indexes then stay within a
+// single chunk.
+bool isPartitionable(pxa::AffineParallelForOp op, unsigned i) {
+  auto& region = op.inner();
+  auto idx = region.front().getArgument(i);
+  auto isPrivate = [&](Value memref) { return region.isAncestor(memref.getParentRegion()); };
+  bool safe = true;
+  op.getOperation()->walk([&](Operation* inner) {
+    if (auto reduce = llvm::dyn_cast<pxa::AffineReduceOp>(inner)) {
+      if (!isPrivate(reduce.out()) && !isIndexedBy(reduce.map(), reduce.idxs(), idx)) {
+        safe = false;
+      }
+    } else if (auto store = llvm::dyn_cast<AffineStoreOp>(inner)) {
+      if (!isPrivate(store.getMemRef()) && !isIndexedBy(store.getAffineMap(), store.getMapOperands(), idx)) {
+        safe = false;
+      }
+    } else if (llvm::isa<mlir::StoreOp>(inner)) {
+      safe = false;
+    }
+  });
+  return safe;
+}
+
+void outlineParallelFor(ModuleOp module, const std::string& entry, ParallelPlan* plan) {
+  *plan = ParallelPlan{};
+  auto func = module.lookupSymbol<FuncOp>(entry);
+  if (!func) {
+    return;
+  }
+
+  // The entry function must be a sequence of parallel loops over buffers
+  // with static shapes; anything else runs serially.
+  auto& body = func.getBody().front();
+  std::vector<Value> buffers(func.getArguments().begin(), func.getArguments().end());
+  std::vector<ConstantOp> constants;
+  std::vector<pxa::AffineParallelForOp> loops;
+  for (auto& op : body) {
+    if (auto alloc = llvm::dyn_cast<AllocOp>(op)) {
+      if (!alloc.getType().hasStaticShape()) {
+        return;
+      }
+      buffers.push_back(alloc.getResult());
+      plan->temporaries.push_back(alloc.getType());
+    } else if (auto constant = llvm::dyn_cast<ConstantOp>(op)) {
+      constants.push_back(constant);
+    } else if (auto loop = llvm::dyn_cast<pxa::AffineParallelForOp>(op)) {
+      if (loop.dynamic_ranges().size()) {
+        return;
+      }
+      loops.push_back(loop);
+    } else if (!llvm::isa<DeallocOp>(op) && !llvm::isa<ReturnOp>(op)) {
+      IVLOG(3, "OutlineParallelForPass: not outlining due to " << op.getName().getStringRef().str());
+      return;
+    }
+  }
+  for (auto loop : loops) {
+    bool captured = false;
+    loop.getOperation()->walk([&](Operation* inner) {
+      for (auto operand : inner->getOperands()) {
+        if (loop.inner().isAncestor(operand.getParentRegion())) {
+          continue;
+        }
+        auto defOp = operand.getDefiningOp();
+        bool isConstant = defOp && llvm::isa<ConstantOp>(defOp);
+        bool isBuffer = std::find(buffers.begin(), buffers.end(), operand) != buffers.end();
+        if (!isConstant && !isBuffer) {
+          captured = true;
+        }
+      }
+    });
+    if (captured) {
+      return;
+    }
+  }
+
+  OpBuilder builder(module.getContext());
+  auto indexType = builder.getIndexType();
+  std::vector<Type> argTypes{indexType, indexType};
+  for (auto buffer : buffers) {
+    argTypes.push_back(buffer.getType());
+  }
+  auto funcType = builder.getFunctionType(argTypes, {});
+
+  for (unsigned k = 0; k < loops.size(); k++) {
+    auto loop = loops[k];
+    auto loc = loop.getLoc();
+    ParallelTask task;
+    task.name = entry + "_task" + std::to_string(k);
+
+    auto taskFunc = FuncOp::create(loc, task.name, funcType);
+    module.push_back(taskFunc);
+    auto taskBlock = taskFunc.addEntryBlock();
+    builder.setInsertionPointToStart(taskBlock);
+
+    BlockAndValueMapping mapping;
+    for (unsigned i = 0; i < buffers.size(); i++) {
+      mapping.map(buffers[i], taskBlock->getArgument(i + 2));
+    }
+    for (auto constant : constants) {
+      builder.clone(*constant.getOperation(), mapping);
+    }
+
+    // Choose the outermost index which is safe to partition.
+    auto ranges = loop.ranges().getValue();
+    int partition = -1;
+    for (unsigned i = 0; i < ranges.size(); i++) {
+      if (ranges[i].cast<IntegerAttr>().getInt() > 1 && isPartitionable(loop, i)) {
+        partition = i;
+        break;
+      }
+    }
+
+    if (partition < 0) {
+      builder.clone(*loop.getOperation(), mapping);
+    } else {
+      task.range = ranges[partition].cast<IntegerAttr>().getInt();
+      auto boundMap = AffineMap::get(0, 1, {builder.getAffineSymbolExpr(0)});
+      auto forOp = builder.create<AffineForOp>(loc, ArrayRef<Value>{taskBlock->getArgument(0)}, boundMap,
+                                               ArrayRef<Value>{taskBlock->getArgument(1)}, boundMap);
+      auto& oldBody = loop.inner().front();
+      mapping.map(oldBody.getArgument(partition), forOp.getInductionVar());
+      builder.setInsertionPoint(forOp.getBody()->getTerminator());
+
+      // The remaining indexes form a nested parallel loop.
+      if (ranges.size() > 1) {
+        std::vector<int64_t> innerRanges;
+        for (unsigned i = 0; i < ranges.size(); i++) {
+          if (static_cast<int>(i) != partition) {
+            innerRanges.push_back(ranges[i].cast<IntegerAttr>().getInt());
+          }
+        }
+        auto innerOp = builder.create<pxa::AffineParallelForOp>(loc, builder.getI64ArrayAttr(innerRanges),
+                                                                ArrayRef<Value>{});
+        auto innerBody = builder.createBlock(&innerOp.inner());
+        for (unsigned i = 0; i < ranges.size(); i++) {
+          if (static_cast<int>(i) != partition) {
+            mapping.map(oldBody.getArgument(i), innerBody->addArgument(indexType));
+          }
+        }
+        builder.create<AffineTerminatorOp>(loc);
+        builder.setInsertionPoint(innerBody->getTerminator());
+      }
+      for (auto& op : oldBody.without_terminator()) {
+        builder.clone(op, mapping);
+      }
+    }
+
+    builder.setInsertionPointToEnd(taskBlock);
+    builder.create<ReturnOp>(loc);
+    plan->tasks.emplace_back(std::move(task));
+  }
+  plan->valid = true;
+}
+
+class OutlineParallelForPass : public mlir::ModulePass<OutlineParallelForPass> {
+ public:
+  OutlineParallelForPass(std::string entry, ParallelPlan* plan) : entry(std::move(entry)), plan(plan) {}
+
+  void runOnModule() override { outlineParallelFor(getModule(), entry, plan); }
+
+ private:
+  std::string entry;
+  ParallelPlan* plan;
+};
+
+// Outlines the parallel loops of every function in the module, recording the
+// range of each of its tasks on the function as `parallel_ranges`.
+class TestOutlineParallelForPass : public mlir::ModulePass<TestOutlineParallelForPass> {
+ public:
+  void runOnModule() override {
+    auto module = getModule();
+    std::vector<std::string> entries;
+    for (auto func : module.getOps<FuncOp>()) {
+      entries.push_back(func.getName().str());
+    }
+    OpBuilder builder(&getContext());
+    for (const auto& entry : entries) {
+      ParallelPlan plan;
+      outlineParallelFor(module, entry, &plan);
+      if (!plan.valid) {
+        continue;
+      }
+      std::vector<int64_t> ranges;
+      for (const auto& task : plan.tasks) {
+        ranges.push_back(task.range);
+      }
+      module.lookupSymbol<FuncOp>(entry).setAttr("parallel_ranges", builder.getI64ArrayAttr(ranges));
+    }
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<mlir::Pass> createOutlineParallelForPass(const std::string& entry, ParallelPlan* plan) {
+  return std::make_unique<OutlineParallelForPass>(entry, plan);
+}
+
+static mlir::PassRegistration<TestOutlineParallelForPass> test_outline_pass(  //
+    "pxa-test-outline-parallel",                                          //
+    "Outline the parallel loops of every function, for testing");
+
+}  // namespace pmlc::conversion::pxa_to_affine
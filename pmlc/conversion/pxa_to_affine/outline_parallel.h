@@ -0,0 +1,48 @@
+// Copyright 2020, Intel Corporation
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mlir/IR/StandardTypes.h"
+
+namespace mlir {
+class Pass;
+}  // namespace mlir
+
+namespace pmlc::conversion::pxa_to_affine {
+
+// A top-level pxa.parallel_for which has been outlined into its own function.
+struct ParallelTask {
+  // The name of the outlined function.
+  std::string name;
+  // The number of iterations of the partitioned index; the task may be split
+  // into any number of chunks over [0, range). A range of 1 means that no
+  // index could be partitioned safely, and the task must run as a single
+  // chunk.
+  int64_t range = 1;
+};
+
+// Describes how to run a function as a sequence of outlined parallel tasks.
+struct ParallelPlan {
+  // Whether the entry function could be outlined; if not, the entry function
+  // must be invoked directly.
+  bool valid = false;
+  // The tasks, in program order.
+  std::vector<ParallelTask> tasks;
+  // The buffers allocated within the entry function. These are passed to each
+  // task following the entry function's own arguments.
+  std::vector<mlir::MemRefType> temporaries;
+};
+
+// Outlines each top-level pxa.parallel_for of the entry function into a
+// function with the signature (index lo, index hi, memrefs...). Each task runs
+// iterations [lo, hi) of one of the loop's indexes; an index is only chosen if
+// every write within the loop addresses memory directly by it, so that
+// concurrent chunks never reduce into the same element. The entry function is
+// left intact, as a serial fallback.
+std::unique_ptr<mlir::Pass> createOutlineParallelForPass(const std::string& entry, ParallelPlan* plan);
+
+}  // namespace pmlc::conversion::pxa_to_affine
@@ -0,0 +1,82 @@
+// RUN: pmlc-opt -pxa-test-outline-parallel %s | FileCheck %s
+
+#col = (d0, d1) -> (d1)
+#all = (d0, d1) -> (0)
+
+func @main(%arg0: memref<4x8xf32>, %arg1: memref<8xf32>, %arg2: memref<1xf32>) {
+  %cst = constant 2.0 : f32
+  %0 = alloc() : memref<4x8xf32>
+  // Every write is addressed by the first index.
+  "pxa.parallel_for"() ( {
+  ^bb0(%i: index, %j: index):
+    %1 = affine.load %arg0[%i, %j] : memref<4x8xf32>
+    %2 = mulf %1, %cst : f32
+    affine.store %2, %0[%i, %j] : memref<4x8xf32>
+    "affine.terminator"() : () -> ()
+  }) {ranges = [4, 8]} : () -> ()
+  // Reduces over the first index, so only the second may be partitioned.
+  "pxa.parallel_for"() ( {
+  ^bb0(%i: index, %j: index):
+    %1 = affine.load %0[%i, %j] : memref<4x8xf32>
+    "pxa.reduce"(%1, %arg1, %i, %j) {agg = 1 : i64, map = #col} : (f32, memref<8xf32>, index, index) -> ()
+    "affine.terminator"() : () -> ()
+  }) {ranges = [4, 8]} : () -> ()
+  // Reduces over every index, so the loop runs as a single chunk.
+  "pxa.parallel_for"() ( {
+  ^bb0(%i: index, %j: index):
+    %1 = affine.load %0[%i, %j] : memref<4x8xf32>
+    "pxa.reduce"(%1, %arg2, %i, %j) {agg = 1 : i64, map = #all} : (f32, memref<1xf32>, index, index) -> ()
+    "affine.terminator"() : () -> ()
+  }) {ranges = [4, 8]} : () -> ()
+  dealloc %0 : memref<4x8xf32>
+  return
+}
+
+// A loop using a value computed outside of it is not outlined.
+func @captured(%arg0: memref<4xf32>, %arg1: f32) {
+  "pxa.parallel_for"() ( {
+  ^bb0(%i: index):
+    affine.store %arg1, %arg0[%i] : memref<4xf32>
+    "affine.terminator"() : () -> ()
+  }) {ranges = [4]} : () -> ()
+  return
+}
+
+// CHECK-LABEL: func @main
+// CHECK-SAME: attributes {parallel_ranges = [4, 8, 1]}
+
+// CHECK-LABEL: func @captured
+// CHECK-NOT: parallel_ranges
+// CHECK: return
+
+// The tasks take the chunk bounds, then the entry's arguments and temporaries.
+// CHECK-LABEL: func @main_task0
+// CHECK-SAME: (%[[LO:[a-z0-9]+]]: index, %[[HI:[a-z0-9]+]]: index, %[[IN:[a-z0-9]+]]: memref<4x8xf32>, %{{[a-z0-9]+}}: memref<8xf32>, %{{[a-z0-9]+}}: memref<1xf32>, %[[TMP:[a-z0-9]+]]: memref<4x8xf32>)
+// CHECK-NEXT: %[[CST:[a-z0-9]+]] = constant 2.000000e+00 : f32
+// CHECK-NEXT: affine.for %[[I:[a-z0-9]+]] = %[[LO]] to %[[HI]] {
+// CHECK: ^bb0(%[[J:[a-z0-9]+]]: index):
+// CHECK-NEXT: %[[X:[a-z0-9]+]] = affine.load %[[IN]][%[[I]], %[[J]]]
+// CHECK-NEXT: %[[Y:[a-z0-9]+]] = mulf %[[X]], %[[CST]]
+// CHECK-NEXT: affine.store %[[Y]], %[[TMP]][%[[I]], %[[J]]]
+// CHECK: {ranges = [8]}
+// CHECK: return
+
+// CHECK-LABEL: func @main_task1
+// CHECK-SAME: (%[[LO:[a-z0-9]+]]: index, %[[HI:[a-z0-9]+]]: index, %{{[a-z0-9]+}}: memref<4x8xf32>, %[[OUT:[a-z0-9]+]]: memref<8xf32>, %{{[a-z0-9]+}}: memref<1xf32>, %[[TMP:[a-z0-9]+]]: memref<4x8xf32>)
+// CHECK: affine.for %[[J:[a-z0-9]+]] = %[[LO]] to %[[HI]] {
+// CHECK: ^bb0(%[[I:[a-z0-9]+]]: index):
+// CHECK-NEXT: %[[X:[a-z0-9]+]] = affine.load %[[TMP]][%[[I]], %[[J]]]
+// CHECK-NEXT: "pxa.reduce"(%[[X]], %[[OUT]], %[[I]], %[[J]])
+// CHECK: {ranges = [4]}
+// CHECK: return
+
+// CHECK-LABEL: func @main_task2
+// CHECK-SAME: (%{{[a-z0-9]+}}: index, %{{[a-z0-9]+}}: index, %{{[a-z0-9]+}}: memref<4x8xf32>, %{{[a-z0-9]+}}: memref<8xf32>, %[[OUT:[a-z0-9]+]]: memref<1xf32>, %[[TMP:[a-z0-9]+]]: memref<4x8xf32>)
+// CHECK-NOT: affine.for
+// CHECK: ^bb0(%[[I:[a-z0-9]+]]: index, %[[J:[a-z0-9]+]]: index):
+// CHECK-NEXT: %[[X:[a-z0-9]+]] = affine.load %[[TMP]][%[[I]], %[[J]]]
+// CHECK-NEXT: "pxa.reduce"(%[[X]], %[[OUT]], %[[I]], %[[J]])
+// CHECK: {ranges = [4, 8]}
+// CHECK: return
+
+// CHECK-NOT: func @captured_task
@@ -2,6 +2,7 @@
 
 #include "pmlc/dialect/tile/builder.h"
 
+#include <algorithm>
 #include <map>
 #include <queue>
 #include <set>
@@ -10,6 +11,8 @@
 #include <utility>
 #include <vector>
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Support/FormatVariadic.h"
 
@@ -134,7 +137,8 @@ struct TileBuilder::Impl {
     }
     auto state = args.front();
     auto dims = args.drop_front();
-    auto resultType = PrngOp::getResultType(args);
+    auto resultType = PrngOp::getResultType(args).cast<RankedTensorType>();
+    resultType = RankedTensorType::get(computeShape(dims), resultType.getElementType());
     auto elementType = builder.getType<ScalarType>(DataType::UINT32);
     auto stateType = RankedTensorType::get({3, 2048}, elementType);
     auto op = builder.create<PrngOp>(loc, resultType, stateType, state, dims);
@@ -146,6 +150,141 @@ struct TileBuilder::Impl {
     auto type = builder.getType<ScalarType>(DataType::FLOAT32);
     return builder.create<ScalarConstantOp>(loc, type, value).result();
   }
+
+  // Returns the type of a tensor, or its shape as found by an earlier
+  // ComputeShape if the type is not static.
+  RankedTensorType lookupShape(Value tensor) {
+    auto type = tensor->getType().dyn_cast<RankedTensorType>();
+    if (!type || !type.hasStaticShape()) {
+      auto it = shapeCache.find(tensor);
+      if (it != shapeCache.end()) {
+        return it->second;
+      }
+    }
+    return type;
+  }
+
+  // Folds a size to a constant, as canonicalization would, so that the shape
+  // of each new op is known as soon as it is built.
+  llvm::Optional<int64_t> evaluateSize(Value value) {
+    auto op = value->getDefiningOp();
+    if (!op) {
+      return llvm::None;
+    }
+    IntegerAttr attr;
+    if (m_Constant(&attr).match(op)) {
+      return attr.getInt();
+    }
+    if (auto dimOp = llvm::dyn_cast<DimOp>(op)) {
+      auto type = lookupShape(dimOp.tensor());
+      if (!type) {
+        return llvm::None;
+      }
+      auto size = type.getDimSize(dimOp.dim().getSExtValue());
+      if (mlir::ShapedType::isDynamic(size)) {
+        return llvm::None;
+      }
+      return size;
+    }
+    if (auto negOp = llvm::dyn_cast<AffineNegOp>(op)) {
+      if (auto input = evaluateSize(negOp.input())) {
+        return -*input;
+      }
+      return llvm::None;
+    }
+    if (!llvm::isa<AffineAddOp>(op) && !llvm::isa<AffineSubOp>(op) && !llvm::isa<AffineMulOp>(op) &&
+        !llvm::isa<AffineDivOp>(op) && !llvm::isa<AffineMaxOp>(op) && !llvm::isa<AffineMinOp>(op)) {
+      return llvm::None;
+    }
+    auto lhs = evaluateSize(op->getOperand(0));
+    auto rhs = evaluateSize(op->getOperand(1));
+    if (!lhs || !rhs) {
+      return llvm::None;
+    }
+    if (llvm::isa<AffineAddOp>(op)) {
+      return *lhs + *rhs;
+    }
+    if (llvm::isa<AffineSubOp>(op)) {
+      return *lhs - *rhs;
+    }
+    if (llvm::isa<AffineMulOp>(op)) {
+      return *lhs * *rhs;
+    }
+    if (llvm::isa<AffineDivOp>(op)) {
+      if (*rhs == 0) {
+        return llvm::None;
+      }
+      return *lhs / *rhs;
+    }
+    if (llvm::isa<AffineMaxOp>(op)) {
+      return std::max(*lhs, *rhs);
+    }
+    return std::min(*lhs, *rhs);
+  }
+
+  // Like eltwise::ComputeShape, but folds each size first.
+  SmallVector<int64_t, 4> computeShape(ArrayRef<Value> sizes) {
+    SmallVector<int64_t, 4> shape;
+    for (auto size : sizes) {
+      auto value = evaluateSize(size);
+      shape.push_back(value ? *value : -1);
+    }
+    return shape;
+  }
+
+  // Infers the result types of the ops which depend on tensor again, after
+  // its type has changed, so that shapes folded when they were built follow
+  // the new type. Ops are built in order, so one pass over the module visits
+  // each op after its operands.
+  void reinferTypes(Value tensor) {
+    llvm::DenseSet<Value> changed;
+    changed.insert(tensor);
+    auto block = module.getBody();
+    auto it = block->begin();
+    if (auto op = tensor->getDefiningOp()) {
+      it = std::next(Block::iterator(op));
+    }
+    for (auto& op : llvm::make_range(it, block->end())) {
+      if (llvm::none_of(op.getOperands(), [&](Value operand) { return changed.count(operand); })) {
+        continue;
+      }
+      for (auto result : op.getResults()) {
+        changed.insert(result);
+      }
+      if (!op.getNumResults()) {
+        continue;
+      }
+      auto oldType = op.getResult(0)->getType().dyn_cast<RankedTensorType>();
+      if (!oldType) {
+        continue;
+      }
+      auto elementType = oldType.getElementType();
+      Type newType;
+      if (auto cionOp = llvm::dyn_cast<SymbolicContractionOp>(&op)) {
+        auto sizeMapOp = llvm::cast<AffineMapOp>(cionOp.size()->getDefiningOp());
+        SmallVector<Value, 4> dims(sizeMapOp.dims());
+        newType = RankedTensorType::get(computeShape(dims), elementType);
+      } else if (auto reshapeOp = llvm::dyn_cast<ReshapeOp>(&op)) {
+        SmallVector<Value, 4> dims(reshapeOp.dims());
+        newType = RankedTensorType::get(computeShape(dims), elementType);
+      } else if (auto prngOp = llvm::dyn_cast<PrngOp>(&op)) {
+        SmallVector<Value, 4> dims(prngOp.dims());
+        newType = RankedTensorType::get(computeShape(dims), elementType);
+      } else if (auto castOp = llvm::dyn_cast<eltwise::CastOp>(&op)) {
+        auto shape = eltwise::getRankedTensorType(castOp.tensor()->getType()).getShape();
+        newType = RankedTensorType::get(shape, elementType);
+      } else if (auto abstractOp = op.getAbstractOperation()) {
+        if (auto genericBuilder = abstractOp->getInterface<util::GenericBuilder>()) {
+          SmallVector<Value, 4> operands(op.getOperands());
+          newType = genericBuilder->getResultType(operands);
+        }
+      }
+      if (newType && newType != oldType) {
+        IVLOG(6, "Re-inferred type: " << mlir::debugString(newType));
+        op.getResult(0)->setType(newType);
+      }
+    }
+  }
 };
 
 TileBuilder::TileBuilder() : impl(new Impl) {}
@@ -193,6 +332,10 @@ stripe::TensorType TileBuilder::IntoTensorType(RankedTensorType type) {
 void TileBuilder::BindShape(Value tensor, RankedTensorType type) {
   IVLOG(5, "TileBuilder::BindShape>");
   tensor->setType(type);
+  // Shapes computed before the binding may depend on it, and so may the
+  // types of the ops built on the tensor.
+  impl->shapeCache.clear();
+  impl->reinferTypes(tensor);
 }
 
 void TileBuilder::BindBuffer(Value tensor, BufferPtr buffer) {
@@ -251,6 +394,8 @@ RankedTensorType TileBuilder::ComputeShape(Value tensor) {
   if (it != impl->shapeCache.end()) {
     return it->second;
   }
+  // Shapes are inferred as ops are built, so this is only reached when some
+  // size was unknown at the time, e.g. a placeholder bound later by BindShape.
   ProgramMutations mutations;
   mutations.outputs.emplace_back(tensor);
   auto program = MakeProgram("compute_shape", mutations);
@@ -289,6 +434,11 @@ Value TileBuilder::MakePrimitiveOp(StringRef fn, ArrayRef<Value> args) {
   }
   auto type = impl->builder.getType<ScalarType>(DataType::FLOAT32);  // TODO
   auto op = genericBuilder->create(&impl->builder, impl->loc, type, args);
+  if (auto reshapeOp = llvm::dyn_cast<ReshapeOp>(op)) {
+    SmallVector<Value, 4> dims(reshapeOp.dims());
+    auto resultType = reshapeOp.result()->getType().cast<RankedTensorType>();
+    reshapeOp.result()->setType(RankedTensorType::get(impl->computeShape(dims), resultType.getElementType()));
+  }
   return op->getResult(0);
 }
 
@@ -521,7 +671,7 @@ Value TileBuilder::MakeContractionOp(  //
   }
   auto sizeMapOp = llvm::cast<AffineMapOp>(sizes->getDefiningOp());
   SmallVector<Value, 4> sizeDims(sizeMapOp.dims());
-  auto shape = eltwise::ComputeShape(sizeDims);
+  auto shape = impl->computeShape(sizeDims);
 
   StringAttr nameAttr;
   if (name.size()) {
@@ -14,18 +14,57 @@ using pmlc::conversion::pxa_to_affine::createLowerPXAToAffinePass;
 
 namespace pmlc::target::x86 {
 
-static compiler::TargetRegistration pipeline("llvm_cpu", [](OpPassManager* pm) {
-  // TODO: do optimizations here
+namespace {
 
-  pm->addPass(createLowerPXAToAffinePass());
+// Tiles are sized to fit in a typical per-core L2 cache.
+constexpr uint64_t kTileCacheSizeBytes = 512 * 1024;
+
+void addCleanupPasses(OpPassManager* pm) {
   pm->addNestedPass<FuncOp>(createCanonicalizerPass());
   pm->addNestedPass<FuncOp>(createCSEPass());
+}
 
+void addLoweringPasses(OpPassManager* pm) {
   pm->addPass(createLowerAffinePass());
-  pm->addNestedPass<FuncOp>(createCanonicalizerPass());
-  pm->addNestedPass<FuncOp>(createCSEPass());
+  addCleanupPasses(pm);
 
   pm->addPass(createLowerToLLVMPass(true));
-});
+}
+
+}  // namespace
+
+static compiler::TargetRegistration pipeline(
+    "llvm_cpu",
+    [](OpPassManager* pm) {
+      pm->addPass(createLowerPXAToAffinePass());
+      addCleanupPasses(pm);
+
+      // Fuse producer/consumer loop nests, then tile the result for locality.
+      pm->addNestedPass<FuncOp>(createLoopFusionPass());
+      addCleanupPasses(pm);
+      pm->addNestedPass<FuncOp>(createLoopTilingPass(kTileCacheSizeBytes));
+      addCleanupPasses(pm);
+
+      // Forward stores to loads and hoist invariant code so that reductions
+      // accumulate in registers rather than through memory.
+      pm->addNestedPass<FuncOp>(createMemRefDataFlowOptPass());
+      pm->addNestedPass<FuncOp>(createAffineLoopInvariantCodeMotionPass());
+      addCleanupPasses(pm);
+
+      // Innermost loops are vectorized by LLVM, using the host's features.
+      addLoweringPasses(pm);
+    },
+    compiler::TargetOptions{/*optLevel=*/3, /*hostFeatures=*/true, /*parallel=*/true});
+
+// The unoptimized pipeline, useful as a baseline and for debugging.
+static compiler::TargetRegistration baseline(
+    "llvm_cpu_O0",
+    [](OpPassManager* pm) {
+      pm->addPass(createLowerPXAToAffinePass());
+      addCleanupPasses(pm);
+
+      addLoweringPasses(pm);
+    },
+    compiler::TargetOptions{/*optLevel=*/0, /*hostFeatures=*/false, /*parallel=*/false});
 
 }  // namespace pmlc::target::x86
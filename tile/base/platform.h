@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
@@ -51,6 +52,16 @@ class Platform {
   // List devices
   virtual std::vector<std::string> ListDevices() = 0;
 
+  // Wraps caller-owned host memory as a buffer on the target device, so that
+  // programs read and write the memory in place.  Once the buffer is no longer
+  // in use, `release` (if set) is called to hand the memory back.
+  virtual std::shared_ptr<Buffer> WrapBuffer(  //
+      const context::Context& ctx,             //
+      const std::string& device,               //
+      void* data,                              //
+      std::uint64_t size,                      //
+      std::function<void()> release) = 0;
+
   // Builds a program for executing the supplied stripe::Program
   virtual std::shared_ptr<Program> MakeProgram(         //
       const context::Context& ctx,                      //
@@ -2,80 +2,251 @@
 
 #include "tile/base/program_cache.h"
 
+#include <algorithm>
 #include <map>
-#include <sstream>
 
 #include "base/util/logging.h"
 
 namespace vertexai {
 namespace tile {
 
+namespace {
+
+// Accumulates a 128-bit hash, mixing 16 bytes at a time as MurmurHash3 does.
+class KeyBuilder {
+ public:
+  void Add(std::uint64_t value) { Mix(value, 0); }
+
+  void Add(const std::string& str) {
+    Add(str.size());
+    std::size_t pos = 0;
+    for (; pos + 16 <= str.size(); pos += 16) {
+      Mix(Load(str.data() + pos, 8), Load(str.data() + pos + 8, 8));
+    }
+    if (pos < str.size()) {
+      auto rest = str.size() - pos;
+      Mix(Load(str.data() + pos, std::min<std::size_t>(rest, 8)),
+          rest > 8 ? Load(str.data() + pos + 8, rest - 8) : 0);
+    }
+  }
+
+  // Adds the shapes in name order, as proto maps have no defined order.
+  template <typename M, typename F>
+  void AddShapes(const M& shapes, const F& get_shape) {
+    std::map<std::string, decltype(&get_shape(*shapes.begin()))> sorted;
+    for (const auto& kvp : shapes) {
+      sorted.emplace(kvp.first, &get_shape(kvp));
+    }
+    Add(sorted.size());
+    for (const auto& kvp : sorted) {
+      Add(kvp.first);
+      AddShape(*kvp.second);
+    }
+  }
+
+  void AddNames(const std::set<std::string>& names) {
+    Add(names.size());
+    for (const auto& name : names) {
+      Add(name);
+    }
+  }
+
+  ProgramKey Finish() {
+    h1_ ^= length_;
+    h2_ ^= length_;
+    h1_ += h2_;
+    h2_ += h1_;
+    h1_ = Finalize(h1_);
+    h2_ = Finalize(h2_);
+    h1_ += h2_;
+    h2_ += h1_;
+    return ProgramKey{h1_, h2_};
+  }
+
+ private:
+  static constexpr std::uint64_t kC1 = 0x87c37b91114253d5ull;
+  static constexpr std::uint64_t kC2 = 0x4cf5ad432745937full;
+
+  static std::uint64_t Rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+  static std::uint64_t Load(const char* data, std::size_t size) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+  }
+
+  static std::uint64_t Finalize(std::uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+  }
+
+  void AddShape(const proto::TensorShape& shape) {
+    Add(shape.type());
+    Add(shape.dims_size());
+    for (const auto& dim : shape.dims()) {
+      Add(dim.size());
+      Add(dim.stride());
+    }
+  }
+
+  void AddShape(const TensorShape& shape) {
+    Add(IntoProto(shape.type));
+    Add(shape.dims.size());
+    for (const auto& dim : shape.dims) {
+      Add(dim.size);
+      Add(dim.stride);
+    }
+  }
+
+  void Mix(std::uint64_t k1, std::uint64_t k2) {
+    k1 *= kC1;
+    k1 = Rotl(k1, 31);
+    k1 *= kC2;
+    h1_ ^= k1;
+    h1_ = Rotl(h1_, 27);
+    h1_ += h2_;
+    h1_ = h1_ * 5 + 0x52dce729;
+    k2 *= kC2;
+    k2 = Rotl(k2, 33);
+    k2 *= kC1;
+    h2_ ^= k2;
+    h2_ = Rotl(h2_, 31);
+    h2_ += h1_;
+    h2_ = h2_ * 5 + 0x38495ab5;
+    length_ += 16;
+  }
+
+  std::uint64_t h1_ = 0;
+  std::uint64_t h2_ = 0;
+  std::uint64_t length_ = 0;
+};
+
+}  // namespace
+
 ProgramCache::ProgramCache(std::shared_ptr<Platform> platform, std::size_t size_max)
-    : platform_{platform}, cache_{size_max} {}
+    : platform_{platform}, size_max_{size_max} {}
+
+ProgramKey ProgramCache::MakeKey(const tile::proto::Program& program) {
+  // N.B. The key covers only the parts of the program that matter to the
+  // actual code generation and scheduling.
+  KeyBuilder builder;
+  builder.Add(program.dev_id());
+  builder.Add(program.code());
+  builder.AddShapes(program.inputs(), [](const auto& kvp) -> const proto::TensorShape& { return kvp.second.shape(); });
+  builder.AddShapes(program.outputs(), [](const auto& kvp) -> const proto::TensorShape& { return kvp.second.shape(); });
+  std::set<std::string> consumed;
+  for (const auto& kvp : program.inputs()) {
+    if (kvp.second.consumed()) {
+      consumed.insert(kvp.first);
+    }
+  }
+  builder.AddNames(consumed);
+  return builder.Finish();
+}
+
+ProgramKey ProgramCache::MakeKey(const std::string& dev_id, const std::string& code, const ShapeMap& inputs,
+                                 const ShapeMap& outputs, const std::set<std::string>& consumed) {
+  KeyBuilder builder;
+  builder.Add(dev_id);
+  builder.Add(code);
+  builder.AddShapes(inputs, [](const auto& kvp) -> const TensorShape& { return kvp.second; });
+  builder.AddShapes(outputs, [](const auto& kvp) -> const TensorShape& { return kvp.second; });
+  builder.AddNames(consumed);
+  return builder.Finish();
+}
 
 std::tuple<std::string, std::shared_ptr<Program>> ProgramCache::GetProgram(const context::Context& ctx,
                                                                            const std::string& fallback_id,
                                                                            const tile::proto::Program& program,
                                                                            ConstBufferManager* const_bufs) {
-  auto entry = GetEntry(fallback_id, program);
-  VLOG(3) << "Using compiled program " << entry->id() << " for user program " << program.id();
+  return GetProgram(ctx, fallback_id, MakeKey(program), [&program] { return program; }, const_bufs);
+}
+
+std::tuple<std::string, std::shared_ptr<Program>> ProgramCache::GetProgram(
+    const context::Context& ctx, const std::string& fallback_id, const ProgramKey& key,
+    const std::function<tile::proto::Program()>& make_program, ConstBufferManager* const_bufs) {
+  auto entry = GetEntry(fallback_id, key, make_program);
+  VLOG(3) << "Using compiled program " << entry->id();
   return std::make_tuple(entry->id(), entry->GetProgram(ctx, platform_.get(), const_bufs));
 }
 
 std::shared_ptr<lang::Program> ProgramCache::GetParsedProgram(const context::Context& ctx,
                                                               const std::string& fallback_id,
                                                               const tile::proto::Program& program) {
-  return GetEntry(fallback_id, program)->GetParsedProgram();
+  return GetEntry(fallback_id, MakeKey(program), [&program] { return program; })->GetParsedProgram();
 }
 
-namespace {
+std::shared_ptr<ProgramCache::Entry> ProgramCache::GetEntry(const std::string& fallback_id, const ProgramKey& key,
+                                                            const std::function<tile::proto::Program()>& make_program) {
+  std::shared_ptr<Entry> entry;
+  {
+    auto& shard = shards_[key.hi % kShards];
+    std::lock_guard<std::mutex> lock{shard.mu};
 
-template <typename M>
-void SerializeShapemap(std::ostringstream* serialized, const M& m) {
-  std::map<std::string, const proto::TensorShape&> shapes;
-  for (const auto& t : m) {
-    shapes.emplace(t.first, t.second.shape());
-  }
-  for (const auto& t : shapes) {
-    (*serialized) << t.first.length() << ':';
-    (*serialized) << t.first;
-    (*serialized) << t.second.type() << ':';
-    for (const auto& dim : t.second.dims()) {
-      (*serialized) << dim.size() << '/' << dim.stride() << ':';
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      it->second->last_use = use_clock_++;
+      return it->second->entry;
     }
-  }
-}
 
-}  // namespace
-
-std::shared_ptr<ProgramCache::Entry> ProgramCache::GetEntry(const std::string& fallback_id,
-                                                            const tile::proto::Program& program) {
-  std::ostringstream serialized;
-
-  // N.B. For cache lookup, we only serialize the parts of the program that
-  // matter to the actual code generation.
-  serialized << program.code().length() << ':';
-  serialized << program.code();
-
-  SerializeShapemap(&serialized, program.inputs());
-  SerializeShapemap(&serialized, program.outputs());
-
-  // The cache itself must be externally synchronized.
-  std::lock_guard<std::mutex> lock{mu_};
-
-  return cache_.Lookup(Key{program.dev_id(), serialized.str()}, [&]() {
+    auto cprog = make_program();
     std::string cid = "c" + std::to_string(next_id_++);
-    if (program.id().size()) {
-      cid = cid + '_' + program.id();
+    if (cprog.id().size()) {
+      cid = cid + '_' + cprog.id();
     } else if (fallback_id.size()) {
       cid = cid + '_' + fallback_id;
     }
     VLOG(3) << "Compiling program as " << cid;
-    tile::proto::Program cprog;
-    cprog.CopyFrom(program);
     cprog.set_id(cid);
-    return std::make_shared<ProgramCache::Entry>(cid, cprog);
-  });
+    entry = std::make_shared<ProgramCache::Entry>(cid, std::move(cprog));
+    if (!size_max_) {
+      return entry;
+    }
+    shard.lru.emplace_front(Slot{key, entry, use_clock_++});
+    shard.entries.emplace(key, shard.lru.begin());
+    ++size_;
+  }
+  Evict();
+  return entry;
+}
+
+void ProgramCache::Evict() {
+  if (size_ <= size_max_) {
+    return;
+  }
+  // Evictions are serialized, so that concurrent insertions don't evict more
+  // entries than they need to.  Within a shard, the least recently used entry
+  // is at the back of its list; the oldest of those is evicted.  Only one
+  // shard lock is held at a time.
+  std::lock_guard<std::mutex> evict_lock{evict_mu_};
+  while (size_max_ < size_) {
+    Shard* oldest = nullptr;
+    std::uint64_t oldest_use = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lock{shard.mu};
+      if (shard.lru.size() && (!oldest || shard.lru.back().last_use < oldest_use)) {
+        oldest = &shard;
+        oldest_use = shard.lru.back().last_use;
+      }
+    }
+    if (!oldest) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{oldest->mu};
+    if (oldest->lru.size()) {
+      VLOG(3) << "Evicting program " << oldest->lru.back().entry->id();
+      oldest->entries.erase(oldest->lru.back().key);
+      oldest->lru.pop_back();
+      --size_;
+    }
+  }
 }
 
 std::shared_ptr<Program> ProgramCache::Entry::GetProgram(const context::Context& ctx, Platform* dev,
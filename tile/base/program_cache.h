@@ -2,27 +2,60 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 
 #include "base/context/context.h"
-#include "tile/base/lru_cache.h"
 #include "tile/base/platform.h"
 #include "tile/base/program.h"
+#include "tile/base/shape.h"
 #include "tile/lang/parser.h"
 #include "tile/proto/tile.pb.h"
 
 namespace vertexai {
 namespace tile {
 
-// ProgramCache implements an LRU Tile program cache.
+// A 128-bit fingerprint of the parts of a program which matter to code
+// generation: its device, its code, and the shapes of its inputs and outputs.
+struct ProgramKey {
+  std::uint64_t hi = 0;
+  std::uint64_t lo = 0;
+
+  bool operator==(const ProgramKey& rhs) const { return hi == rhs.hi && lo == rhs.lo; }
+  bool operator!=(const ProgramKey& rhs) const { return !(*this == rhs); }
+};
+
+// ProgramCache implements an LRU Tile program cache, keyed by ProgramKey.
 class ProgramCache final {
  public:
   ProgramCache(std::shared_ptr<Platform> platform, std::size_t size_max);
 
+  // Returns the key of a program.
+  static ProgramKey MakeKey(const tile::proto::Program& program);
+
+  // Returns the key of the program with the given device, code, shapes, and
+  // consumed inputs, without building it.  This is the same as the key of the
+  // built program.
+  static ProgramKey MakeKey(const std::string& dev_id, const std::string& code, const ShapeMap& inputs,
+                            const ShapeMap& outputs, const std::set<std::string>& consumed);
+
+  // As below, but looks the program up by key, so that callers which keep the
+  // key of a program they run repeatedly need not build it each time;
+  // make_program is only called if the program is not in the cache.
+  std::tuple<std::string, std::shared_ptr<Program>> GetProgram(
+      const context::Context& ctx, const std::string& fallback_id, const ProgramKey& key,
+      const std::function<tile::proto::Program()>& make_program, ConstBufferManager* const_bufs = {});
+
   // Gets the the requested program, looking it up in the cache and building it if necessary.
   // The fallback ID is used as the program ID if the program has no ID -- since GetProgram
   // requires the program without an ID, it's slightly cheaper to pass it in than to set it
@@ -39,23 +72,9 @@ class ProgramCache final {
                                                   const tile::proto::Program& program);
 
  private:
-  struct Key {
-    std::string subdevice;
-    std::string ops;
-  };
-
-  struct KeyComp {
-    bool operator()(const Key& lhs, const Key& rhs) const {
-      if (lhs.subdevice < rhs.subdevice) {
-        return true;
-      }
-      if (rhs.subdevice < lhs.subdevice) {
-        return false;
-      }
-      return lhs.ops < rhs.ops;
-    }
+  struct KeyHash {
+    std::size_t operator()(const ProgramKey& key) const { return key.lo; }
   };
-
   class Entry {
    public:
     Entry(std::string id, tile::proto::Program proto) : id_{std::move(id)}, proto_{std::move(proto)} {}
@@ -74,13 +93,38 @@ class ProgramCache final {
     std::shared_ptr<lang::Program> parsed_;
   };
 
-  std::shared_ptr<Entry> GetEntry(const std::string& fallback_id, const tile::proto::Program& program);
+  struct Slot {
+    ProgramKey key;
+    std::shared_ptr<Entry> entry;
+    std::uint64_t last_use;  // The value of use_clock_ when the entry was last used
+  };
+
+  // The cache is split by key into shards, each with its own lock and LRU
+  // list, so that concurrent lookups rarely contend.  The size limit applies
+  // to the cache as a whole: when it is exceeded, the least recently used
+  // entry of all the shards is evicted.
+  struct Shard {
+    std::mutex mu;
+    std::list<Slot> lru;  // Most recently used first
+    std::unordered_map<ProgramKey, decltype(lru)::iterator, KeyHash> entries;
+  };
+
+  static constexpr std::size_t kShards = 16;
+
+  std::shared_ptr<Entry> GetEntry(const std::string& fallback_id, const ProgramKey& key,
+                                  const std::function<tile::proto::Program()>& make_program);
+
+  // Evicts least recently used entries until the cache is within its limit.
+  void Evict();
 
   std::shared_ptr<Platform> platform_;
 
-  std::mutex mu_;
-  int next_id_ = 1;
-  LruCache<Key, std::shared_ptr<Entry>, KeyComp> cache_;
+  std::size_t size_max_;
+  std::atomic<std::size_t> size_{0};
+  std::atomic<std::uint64_t> use_clock_{0};
+  std::mutex evict_mu_;
+  std::atomic<int> next_id_{1};
+  std::array<Shard, kShards> shards_;
 };
 
 }  // namespace tile
@@ -0,0 +1,107 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#include "tile/base/program_cache.h"
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+namespace vertexai {
+namespace tile {
+namespace {
+
+// A platform which builds no programs; the cache is tested on its own.
+class NullPlatform final : public Platform {
+ public:
+  std::shared_ptr<Buffer> MakeBuffer(const context::Context& ctx, const std::string& device,
+                                     std::uint64_t size) override {
+    return nullptr;
+  }
+
+  std::shared_ptr<Program> MakeProgram(const context::Context& ctx, const proto::Program& program,
+                                       ConstBufferManager* const_bufs) override {
+    return nullptr;
+  }
+
+  void ListDevices(const context::Context& ctx, const proto::ListDevicesRequest& request,
+                   proto::ListDevicesResponse* response) override {}
+
+  void RegisterCostModel(const lang::TileCostFunction& cost_fn) override {}
+
+  std::vector<std::string> ListDevices() override { return {}; }
+
+  std::shared_ptr<Buffer> WrapBuffer(const context::Context& ctx, const std::string& device, void* data,
+                                     std::uint64_t size, std::function<void()> release) override {
+    return nullptr;
+  }
+
+  std::shared_ptr<Program> MakeProgram(const context::Context& ctx, const std::string& device,
+                                       const std::string& target, const std::shared_ptr<stripe::Program>& program,
+                                       ConstBufferManager* const_bufs) override {
+    return nullptr;
+  }
+};
+
+class ProgramCacheTest : public ::testing::Test {
+ protected:
+  explicit ProgramCacheTest(std::size_t size_max = 500)
+      : cache_{std::make_shared<NullPlatform>(), size_max} {}
+
+  // Looks up program i, counting the programs which had to be made.
+  std::string Get(std::size_t i) {
+    auto code = "function (A) -> (B) { B = A + " + std::to_string(i) + "; }";
+    auto key = ProgramCache::MakeKey("dev", code, {}, {}, {});
+    auto make_program = [&] {
+      ++made_;
+      proto::Program program;
+      program.set_dev_id("dev");
+      program.set_code(code);
+      return program;
+    };
+    return std::get<0>(cache_.GetProgram(ctx_, "", key, make_program));
+  }
+
+  context::Context ctx_;
+  ProgramCache cache_;
+  std::size_t made_ = 0;
+};
+
+class SmallProgramCacheTest : public ProgramCacheTest {
+ protected:
+  SmallProgramCacheTest() : ProgramCacheTest{8} {}
+};
+
+TEST_F(ProgramCacheTest, KeepsEveryProgramWithinLimit) {
+  // Cycling through fewer programs than the limit never evicts, however the
+  // keys happen to fall among the cache's shards.
+  const std::size_t kPrograms = 400;
+  for (int round = 0; round < 3; ++round) {
+    for (std::size_t i = 0; i < kPrograms; ++i) {
+      Get(i);
+    }
+  }
+  EXPECT_THAT(made_, Eq(kPrograms));
+}
+
+TEST_F(SmallProgramCacheTest, EvictsLeastRecentlyUsed) {
+  std::vector<std::string> ids;
+  for (std::size_t i = 0; i < 8; ++i) {
+    ids.push_back(Get(i));
+  }
+  EXPECT_THAT(Get(0), Eq(ids[0]));
+  Get(8);  // Evicts program 1, which is now the least recently used
+  EXPECT_THAT(made_, Eq(9u));
+  EXPECT_THAT(Get(0), Eq(ids[0]));
+  EXPECT_THAT(Get(2), Eq(ids[2]));
+  EXPECT_THAT(made_, Eq(9u));
+  EXPECT_THAT(Get(1), Ne(ids[1]));
+  EXPECT_THAT(made_, Eq(10u));
+}
+
+}  // namespace
+}  // namespace tile
+}  // namespace vertexai
@@ -2,13 +2,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "base/util/lookup.h"
+#include "tbb/tbb.h"
 #include "tile/stripe/stripe.h"
 
 namespace vertexai {
@@ -97,31 +100,108 @@ class AliasMap {
 // be instantiated.
 bool CheckOverlap(const std::vector<stripe::Extent>& a_extents, const std::vector<stripe::Extent>& b_extents);
 
+// Refers to the AliasMap of a block, building it on first use, so that walking
+// past blocks which a pass does not run on costs no alias analysis.  Building
+// is thread-safe.
+class LazyAliasMap {
+ public:
+  // Refers to a map which is already built
+  explicit LazyAliasMap(const AliasMap& map) : map_{&map} {}
+  // Refers to the map of an inner block of the block outer refers to
+  LazyAliasMap(const LazyAliasMap& outer, stripe::Block* block) : outer_{&outer}, block_{block} {}
+  LazyAliasMap(const LazyAliasMap&) = delete;
+  LazyAliasMap& operator=(const LazyAliasMap&) = delete;
+  // Get the map, building it (and any outer maps it needs) if need be
+  const AliasMap& get() const {
+    if (!map_) {
+      std::call_once(built_, [this] {
+        owned_ = std::make_unique<AliasMap>(outer_->get(), block_);
+        map_ = owned_.get();
+      });
+    }
+    return *map_;
+  }
+
+ private:
+  const LazyAliasMap* outer_ = nullptr;
+  stripe::Block* block_ = nullptr;
+  mutable std::atomic<const AliasMap*> map_{nullptr};
+  mutable std::unique_ptr<AliasMap> owned_;
+  mutable std::once_flag built_;
+};
+
 template <typename F>
-void RunOnBlocksRecurse(const AliasMap& map, stripe::Block* block, const stripe::Tags& reqs, const F& func,
+void RunOnBlocksRecurse(const LazyAliasMap& map, stripe::Block* block, const stripe::Tags& reqs, const F& func,
                         bool rec_func) {
   bool run_func = block->has_tags(reqs) || reqs.count("all") > 0;
   if (run_func) {
-    func(map, block);
+    func(map.get(), block);
   }
   if (!run_func || rec_func) {
     for (auto& stmt : block->stmts) {
       auto inner = stripe::Block::Downcast(stmt);
       if (inner) {
-        AliasMap inner_map(map, inner.get());
+        LazyAliasMap inner_map(map, inner.get());
         RunOnBlocksRecurse(inner_map, inner.get(), reqs, func, rec_func);
       }
     }
   }
 }
 
+template <typename F>
+void RunOnBlocksRecurse(const AliasMap& map, stripe::Block* block, const stripe::Tags& reqs, const F& func,
+                        bool rec_func) {
+  RunOnBlocksRecurse(LazyAliasMap(map), block, reqs, func, rec_func);
+}
+
 template <typename F>
 void RunOnBlocks(stripe::Block* root, const stripe::Tags& reqs, const F& func, bool rec_func = false) {
   AliasMap base;
-  AliasMap root_map(base, root);
+  LazyAliasMap base_map(base);
+  LazyAliasMap root_map(base_map, root);
   RunOnBlocksRecurse(root_map, root, reqs, func, rec_func);
 }
 
+// Runs func on each inner block of block, concurrently.
+template <typename F>
+void ParallelForInnerBlocks(stripe::Block* block, const F& func) {
+  std::vector<stripe::Block*> inners;
+  for (auto& stmt : block->stmts) {
+    auto inner = stripe::Block::Downcast(stmt);
+    if (inner) {
+      inners.push_back(inner.get());
+    }
+  }
+  tbb::parallel_for(size_t(0), inners.size(), [&](size_t i) { func(inners[i]); });
+}
+
+template <typename F>
+void RunOnBlocksParallelRecurse(const LazyAliasMap& map, stripe::Block* block, const stripe::Tags& reqs,
+                                const F& func, bool rec_func) {
+  bool run_func = block->has_tags(reqs) || reqs.count("all") > 0;
+  if (run_func) {
+    func(map.get(), block);
+  }
+  if (!run_func || rec_func) {
+    ParallelForInnerBlocks(block, [&](stripe::Block* inner) {
+      LazyAliasMap inner_map(map, inner);
+      RunOnBlocksParallelRecurse(inner_map, inner, reqs, func, rec_func);
+    });
+  }
+}
+
+// As RunOnBlocks, but runs func on sibling blocks concurrently.  This is only
+// for passes whose func modifies nothing outside the block it is given (such as
+// independent kernels in 'main'), and which may be called from several threads
+// at once.  Blocks are never visited concurrently with their ancestors.
+template <typename F>
+void RunOnBlocksParallel(stripe::Block* root, const stripe::Tags& reqs, const F& func, bool rec_func = false) {
+  AliasMap base;
+  LazyAliasMap base_map(base);
+  LazyAliasMap root_map(base_map, root);
+  RunOnBlocksParallelRecurse(root_map, root, reqs, func, rec_func);
+}
+
 std::ostream& operator<<(std::ostream& os, const AliasInfo& ai);
 
 }  // namespace codegen
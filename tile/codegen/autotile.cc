@@ -3,7 +3,9 @@
 #include "tile/codegen/autotile.h"
 
 #include <algorithm>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -15,8 +17,10 @@
 #include "base/util/throw.h"
 #include "tile/codegen/alias.h"
 #include "tile/codegen/tile.h"
+#include "tile/codegen/tuning_db.h"
 #include "tile/math/util.h"
 #include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/jit.h"
 
 namespace vertexai {
 namespace tile {
@@ -340,6 +344,7 @@ struct TileSearchState {
   std::set<Tile> found_tiles;
   std::optional<TileResult> best_so_far;
   std::set<std::pair<double, Tile>> todo;
+  std::set<std::pair<double, Tile>> valid;
 
   void AddTile(const Tile& tile, Cost cost) {
     IVLOG(4, "    Found " << cost << ": " << tile);
@@ -347,6 +352,9 @@ struct TileSearchState {
     if (cost.outcome == Cost::Valid && (!best_so_far || cost.value < best_so_far->cost)) {
       best_so_far = TileResult{tile, cost.value};
     }
+    if (cost.outcome == Cost::Valid) {
+      valid.emplace(cost.value, tile);
+    }
     if (cost.outcome != Cost::Stop) {
       todo.emplace(cost.outcome == Cost::Valid ? cost.value : 0, tile);
     }
@@ -354,9 +362,8 @@ struct TileSearchState {
 };
 
 template <typename CostModel>
-std::optional<TileResult> PickBestTile(const Block& block, bool only_po2, bool only_even, bool only_multiple_of_32,
-                                       bool is_fast, const CostModel& model) {
-  IVLOG(3, "Autotile> PickBestTile> block: " << block.name);
+TileSearchState SearchTiles(const Block& block, bool only_po2, bool only_even, bool only_multiple_of_32, bool is_fast,
+                            const CostModel& model) {
   TileSearchState state;
   Tile tile(block, only_multiple_of_32 ? 32 : 1);
 
@@ -407,20 +414,173 @@ std::optional<TileResult> PickBestTile(const Block& block, bool only_po2, bool o
       tile.dims[i] = prev;
     }
   }
-  return state.best_so_far;
+  return state;
+}
+
+template <typename CostModel>
+std::optional<TileResult> PickBestTile(const Block& block, bool only_po2, bool only_even, bool only_multiple_of_32,
+                                       bool is_fast, const CostModel& model) {
+  IVLOG(3, "Autotile> PickBestTile> block: " << block.name);
+  return SearchTiles(block, only_po2, only_even, only_multiple_of_32, is_fast, model).best_so_far;
+}
+
+// Returns up to count valid tiles, cheapest first.
+template <typename CostModel>
+std::vector<TileResult> PickBestTiles(const Block& block, size_t count, bool only_po2, bool only_even,
+                                      bool only_multiple_of_32, bool is_fast, const CostModel& model) {
+  IVLOG(3, "Autotile> PickBestTiles> block: " << block.name << ", count: " << count);
+  auto state = SearchTiles(block, only_po2, only_even, only_multiple_of_32, is_fast, model);
+  std::vector<TileResult> ret;
+  for (const auto& kvp : state.valid) {
+    if (ret.size() == count) {
+      break;
+    }
+    ret.push_back(TileResult{kvp.second, kvp.first});
+  }
+  return ret;
+}
+
+// Builds a standalone program which runs a copy of block, tiled as the pass
+// would tile it, over synthetic buffers; returns the execution ticks of the
+// tiled block over the given number of runs.
+int64_t MeasureTile(const Block& block, const TileShape& tiling_shape, const proto::AutotilePass& options) {
+  auto tiled = CloneBlock(block);
+  // Indexes passed down from the parent have no values here; treat them as 0.
+  for (auto& idx : tiled->idxs) {
+    idx.affine = Affine();
+  }
+  ApplyTile(tiled.get(), tiling_shape, false, false, options.flip() || options.interleave());
+
+  // Size each parent buffer to cover every element the block can touch.
+  struct Span {
+    DataType type;
+    int64_t lo = 0;
+    int64_t hi = 0;
+  };
+  std::map<std::string, Span> spans;
+  for (const auto& ref : tiled->refs) {
+    if (ref.from.empty()) {
+      continue;
+    }
+    std::map<std::string, int64_t> ranges;
+    for (const auto& idx : tiled->idxs) {
+      ranges[idx.name] = idx.range;
+    }
+    int64_t lo = 0;
+    int64_t hi = 0;
+    for (const auto& kvp : ref.FlatAccess().getMap()) {
+      if (kvp.first.empty()) {
+        lo += kvp.second;
+        hi += kvp.second;
+      } else if (kvp.second > 0) {
+        hi += kvp.second * (ranges.at(kvp.first) - 1);
+      } else {
+        lo += kvp.second * (ranges.at(kvp.first) - 1);
+      }
+    }
+    for (const auto& dim : ref.interior_shape.dims) {
+      (dim.stride > 0 ? hi : lo) += dim.stride * (static_cast<int64_t>(dim.size) - 1);
+    }
+    auto it = spans.find(ref.from);
+    if (it == spans.end()) {
+      spans.emplace(ref.from, Span{ref.interior_shape.type, lo, hi});
+    } else {
+      it->second.lo = std::min(it->second.lo, lo);
+      it->second.hi = std::max(it->second.hi, hi);
+    }
+  }
+
+  auto program = std::make_shared<Block>();
+  program->name = "autotune";
+  program->stmts.push_back(tiled);
+  std::vector<std::vector<char>> storage;
+  std::map<std::string, void*> buffers;
+  for (const auto& kvp : spans) {
+    uint64_t count = kvp.second.hi - kvp.second.lo + 1;
+    Refinement ref{RefDir::None, "", kvp.first, {Affine()}, SimpleShape(kvp.second.type, {count})};
+    ref.set_tag("user");
+    program->refs.emplace(ref);
+    // Integer inputs get a nonzero fill so that divisions stay well defined;
+    // float inputs stay zero to keep denormals out of the timing.
+    size_t elem_size = byte_width(kvp.second.type);
+    storage.emplace_back(count * elem_size, is_float(kvp.second.type) ? 0 : 1);
+    buffers.emplace(kvp.first, storage.back().data() - kvp.second.lo * elem_size);
+  }
+
+  targets::cpu::Config config;
+  config.profile_block_execution = true;
+  targets::cpu::Native native;
+  native.compile(*program, config);
+  for (uint32_t i = 0; i < std::max(options.tune_runs(), 1u); i++) {
+    native.run(buffers);
+  }
+  native.set_perf_attrs(program.get());
+  return tiled->get_attr_int("execution_ticks", -1);
+}
+
+// Measures the cheapest tune_candidates tilings and returns the fastest,
+// consulting and updating the tuning database.  Falls back to the modeled
+// best if nothing could be measured.
+std::optional<TileResult> TuneTile(const Block& block, const proto::AutotilePass& options,
+                                   const ComputeDensityCostModel& model) {
+  auto db = TuningDB::Open(options.tune_db());
+  proto::AutotilePass salt = options;
+  salt.clear_tune_candidates();
+  salt.clear_tune_runs();
+  salt.clear_tune_db();
+  auto key = TuningDB::MakeKey(block, salt.SerializeAsString());
+  TileShape sizes;
+  if (db->Lookup(key, &sizes) && sizes.size() == block.idxs.size()) {
+    Tile tile(block, 1);
+    for (size_t i = 0; i < sizes.size(); i++) {
+      tile.set(i, sizes[i], block.idxs[i].range);
+    }
+    IVLOG(2, "Autotile> block: " << block.name << ", tuned tile from " << key << ": " << tile);
+    return TileResult{tile, model.ComputeCost(block, tile).value};
+  }
+  auto candidates = PickBestTiles(block, options.tune_candidates(), options.only_po2(), options.only_even(),
+                                  options.only_multiple_of_32(), options.fast(), model);
+  if (candidates.empty()) {
+    return std::nullopt;
+  }
+  std::optional<TileResult> best;
+  int64_t best_ticks = 0;
+  for (const auto& candidate : candidates) {
+    const TileShape& tiling_shape = options.flip() ? candidate.tile.counts() : candidate.tile.sizes();
+    int64_t ticks;
+    try {
+      ticks = MeasureTile(block, tiling_shape, options);
+    } catch (const std::exception& ex) {
+      LOG(WARNING) << "Autotile> block: " << block.name << ", unable to measure tile " << candidate.tile << ": "
+                   << ex.what();
+      continue;
+    }
+    IVLOG(3, "    Measured " << candidate.tile << ", cost: " << candidate.cost << ", ticks: " << ticks);
+    if (ticks >= 0 && (!best || ticks < best_ticks)) {
+      best = candidate;
+      best_ticks = ticks;
+    }
+  }
+  if (!best) {
+    return candidates.front();
+  }
+  db->AddEntry(key, best->tile.sizes(), best_ticks);
+  return best;
 }
 
 }  // namespace
 
 void AutotilePass::Apply(CompilerState* state) const {
   auto reqs = FromProto(options_.reqs());
-  RunOnBlocks(state->entry(), reqs, [this](const AliasMap& map, Block* block) {
+  auto tile_block = [this](const AliasMap& map, Block* block) {
     if (block->has_any_tags(FromProto(options_.exclude()))) {
       return;
     }
     ComputeDensityCostModel model(*block, options_);
-    auto result = PickBestTile(*block, options_.only_po2(), options_.only_even(), options_.only_multiple_of_32(),
-                               options_.fast(), model);
+    auto result = options_.tune_candidates()
+                      ? TuneTile(*block, options_, model)
+                      : PickBestTile(*block, options_.only_po2(), options_.only_even(),
+                                     options_.only_multiple_of_32(), options_.fast(), model);
     if (result) {
       IVLOG(2, "Autotile> block: " << block->name << ", tile: " << result->tile << ", cost: " << result->cost);
       const TileShape& tiling_shape = options_.flip() ? result->tile.counts() : result->tile.sizes();
@@ -456,7 +616,13 @@ void AutotilePass::Apply(CompilerState* state) const {
       }
       LOG(WARNING) << "Autotile> block: " << block->name << " was NOT split; unable to find a valid tiling";
     }
-  });
+  };
+  if (options_.tune_candidates()) {
+    // Tuning times candidate tilings on the host, one at a time.
+    RunOnBlocks(state->entry(), reqs, tile_block);
+  } else {
+    RunOnBlocksParallel(state->entry(), reqs, tile_block);
+  }
 }
 
 void PartitionComputePass::Apply(CompilerState* state) const {
@@ -32,6 +32,9 @@ class CompilePass {
  public:
   virtual ~CompilePass() {}
   virtual bool is_stripe() const { return true; }
+  // Whether the pass never changes the program, letting the driver skip it
+  // along with any conversions it would need.
+  virtual bool is_noop() const { return false; }
   virtual void Apply(CompilerState* root) const = 0;
 };
 
@@ -2,13 +2,19 @@
 
 #include "tile/codegen/driver.h"
 
+#include <chrono>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <boost/format.hpp>
 
 #include "base/config/config.h"
 #include "base/util/any_factory_map.h"
+#include "base/util/env.h"
 #include "base/util/throw.h"
 #include "tile/codegen/alias.h"
 #include "tile/codegen/compile_pass.h"
@@ -74,6 +80,125 @@ void ValidateBlock(Block* root) {
       true);
 }
 
+void CountStatements(const Block& block, StepStats* stats) {
+  stats->blocks++;
+  for (const auto& stmt : block.stmts) {
+    stats->statements++;
+    auto inner = Block::Downcast(stmt);
+    if (inner) {
+      CountStatements(*inner, stats);
+    }
+  }
+}
+
+// Measures the steps of Optimize when a report is wanted, and otherwise just
+// runs them.
+class Instrument {
+ public:
+  explicit Instrument(OptimizeReport* report) : report_(report), start_(Clock::now()) {}
+
+  template <typename F>
+  StepStats* Measure(const std::string& name, const std::string& kind, F step) {
+    if (!report_) {
+      step();
+      return nullptr;
+    }
+    auto rss = PeakResidentBytes();
+    auto start = Clock::now();
+    step();
+    StepStats stats;
+    stats.name = name;
+    stats.kind = kind;
+    stats.seconds = Seconds(start);
+    stats.peak_rss_delta = PeakResidentBytes() - rss;
+    report_->steps.emplace_back(std::move(stats));
+    return &report_->steps.back();
+  }
+
+  void Validate(Block* block, StepStats* stats) {
+    auto start = Clock::now();
+    ValidateBlock(block);
+    if (stats) {
+      stats->validate_seconds = Seconds(start);
+      CountStatements(*block, stats);
+    }
+  }
+
+  void Finish() {
+    if (report_) {
+      report_->total_seconds = Seconds(start_);
+      report_->peak_rss = PeakResidentBytes();
+    }
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  static double Seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  OptimizeReport* report_;
+  Clock::time_point start_;
+};
+
+void AppendReport(const std::string& path, const OptimizeReport& report) {
+  static std::mutex mu;
+  std::lock_guard<std::mutex> lock(mu);
+  std::ofstream fout(path, std::ofstream::app);
+  fout << report.ToJson() << std::endl;
+}
+
+// A run of consecutive passes which work on the same representation, so that
+// the program only needs converting at the start of each group.
+struct PassGroup {
+  bool is_stripe;
+  std::vector<std::pair<const proto::Pass*, std::unique_ptr<CompilePass>>> passes;
+
+  // Whether the group leaves an MLIR program as it found it, making the
+  // conversions into and out of MLIR unnecessary.
+  bool is_noop() const {
+    if (is_stripe) {
+      return false;
+    }
+    for (const auto& item : passes) {
+      if (!item.second->is_noop()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::string names() const {
+    std::string result;
+    for (const auto& item : passes) {
+      if (!result.empty()) {
+        result += ", ";
+      }
+      result += item.first->name();
+    }
+    return result;
+  }
+};
+
+std::vector<PassGroup> PlanPassGroups(const Passes& passes) {
+  std::vector<PassGroup> groups;
+  for (const auto& pass : passes) {
+    std::unique_ptr<CompilePass> compile_pass =
+        AnyFactoryMap<CompilePass>::Instance()->MakeInstanceIfSupported(context::Context{}, pass.pass());
+    if (!compile_pass) {
+      throw_with_trace(std::runtime_error(
+          str(boost::format("Unsupported pass: %1% -> %2%") % pass.name() % pass.pass().type_url())));
+    }
+    bool is_stripe = compile_pass->is_stripe();
+    if (groups.empty() || groups.back().is_stripe != is_stripe) {
+      groups.emplace_back(PassGroup{is_stripe, {}});
+    }
+    groups.back().passes.emplace_back(&pass, std::move(compile_pass));
+  }
+  return groups;
+}
+
 class ConfigsRegistry {
  public:
   static ConfigsRegistry* Instance() {
@@ -100,48 +225,66 @@ class ConfigsRegistry {
 }  // namespace
 
 void Optimize(CompilerState* state, const Passes& passes, const OptimizeOptions& options) {
+  auto report = options.report;
+  OptimizeReport env_report;
+  auto report_path = env::Get("PLAIDML_PASS_REPORT");
+  if (!report && !report_path.empty()) {
+    report = &env_report;
+  }
+  Instrument instrument(report);
   size_t counter = 0;
   DumpProgram(*state->entry(), options, "initial", counter++);
   bool in_stripe = true;
-  for (const auto& pass : passes) {
-    IVLOG(1, "Optimization Pass " << pass.name());
-    std::unique_ptr<CompilePass> compile_pass =
-        AnyFactoryMap<CompilePass>::Instance()->MakeInstanceIfSupported(context::Context{}, pass.pass());
-    if (!compile_pass) {
-      throw_with_trace(std::runtime_error(
-          str(boost::format("Unsupported pass: %1% -> %2%") % pass.name() % pass.pass().type_url())));
+  for (const auto& group : PlanPassGroups(passes)) {
+    if (group.is_noop()) {
+      // Nothing to gain from converting the program just to leave it as is.
+      IVLOG(1, "Skipping no-op MLIR passes: " << group.names());
+      counter += group.passes.size();
+      continue;
     }
-    bool wants_stripe = compile_pass->is_stripe();
-    if (!in_stripe && wants_stripe) {
-      ConvertFromMLIR(state);
-    } else if (in_stripe && !wants_stripe) {
-      ConvertIntoMLIR(state);
+    if (!in_stripe && group.is_stripe) {
+      instrument.Measure("from_mlir", "convert", [&] { ConvertFromMLIR(state); });
+    } else if (in_stripe && !group.is_stripe) {
+      instrument.Measure("into_mlir", "convert", [&] { ConvertIntoMLIR(state); });
     }
-    in_stripe = wants_stripe;
-    compile_pass->Apply(state);
-    if (in_stripe) {
-      DumpProgram(*state->entry(), options, pass.name(), counter);
-    } else {
-      // DUMP MLIR
+    in_stripe = group.is_stripe;
+    for (const auto& item : group.passes) {
+      const auto& name = item.first->name();
+      IVLOG(1, "Optimization Pass " << name);
+      auto stats = instrument.Measure(name, in_stripe ? "stripe" : "mlir", [&] { item.second->Apply(state); });
+      if (in_stripe) {
+        DumpProgram(*state->entry(), options, name, counter);
+        instrument.Validate(state->entry(), stats);
+      } else {
+        // DUMP MLIR
+        // The Stripe program is stale until the group ends, so there is nothing to validate.
+      }
+      counter++;
     }
-    counter++;
-    ValidateBlock(state->entry());
   }
   if (!in_stripe) {
-    ConvertFromMLIR(state);
+    instrument.Measure("from_mlir", "convert", [&] { ConvertFromMLIR(state); });
+    instrument.Validate(state->entry(), nullptr);
   }
   // Remove constants that are no longer used
-  if (state->const_bufs == nullptr) {
-    return;
-  }
-  auto& cbufs = state->const_bufs->buffers;
-  for (auto it = cbufs.begin(); it != cbufs.end();) {
-    if (state->entry()->ref_by_into(it->first, false) == state->entry()->refs.end()) {
-      it = cbufs.erase(it);
-    } else {
-      ++it;
+  if (state->const_bufs) {
+    auto& cbufs = state->const_bufs->buffers;
+    for (auto it = cbufs.begin(); it != cbufs.end();) {
+      if (state->entry()->ref_by_into(it->first, false) == state->entry()->refs.end()) {
+        it = cbufs.erase(it);
+      } else {
+        ++it;
+      }
     }
   }
+  instrument.Finish();
+  if (report) {
+    IVLOG(1, "Optimization took " << report->total_seconds << "s, of which " << report->conversion_seconds()
+                                  << "s converting to and from MLIR");
+  }
+  if (report == &env_report) {
+    AppendReport(report_path, env_report);
+  }
   IVLOG(3, "All optimization passes complete");
 }
 
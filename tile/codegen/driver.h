@@ -3,6 +3,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -14,11 +15,48 @@ namespace vertexai {
 namespace tile {
 namespace codegen {
 
+// Measurements of one step of Optimize: a pass, or a conversion of the
+// program between Stripe and MLIR.
+struct StepStats {
+  // The pass name, or "into_mlir" / "from_mlir" for conversions
+  std::string name;
+  // "stripe" or "mlir" for passes, "convert" for conversions
+  std::string kind;
+  // Wall time of the step, and of the validation which follows a pass
+  double seconds = 0;
+  double validate_seconds = 0;
+  // Growth of the process's peak resident set size during the step
+  int64_t peak_rss_delta = 0;
+  // The size of the Stripe program after the step; zero while in MLIR
+  size_t blocks = 0;
+  size_t statements = 0;
+};
+
+struct OptimizeReport {
+  std::vector<StepStats> steps;
+  double total_seconds = 0;
+  // The process's peak resident set size at the end of Optimize
+  int64_t peak_rss = 0;
+
+  // Time spent converting between Stripe and MLIR
+  double conversion_seconds() const;
+
+  // Renders the report as a single line JSON object.
+  std::string ToJson() const;
+};
+
+// The process's peak resident set size in bytes, or zero if unknown.
+int64_t PeakResidentBytes();
+
 struct OptimizeOptions {
   bool dump_passes = false;
   bool dump_passes_proto = false;
   bool dump_code = false;
   boost::filesystem::path dbg_dir;
+  // When set, Optimize records the cost of each of its steps here.  Setting
+  // PLAIDML_PASS_REPORT to a file name appends a report of every Optimize
+  // call to that file, one JSON object per line.
+  OptimizeReport* report = nullptr;
 };
 
 using Passes = google::protobuf::RepeatedPtrField<proto::Pass>;
@@ -0,0 +1,110 @@
+// Copyright 2020, Intel Corporation
+
+#include <sstream>
+#include <string>
+
+#include <boost/format.hpp>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+// psapi.h must follow windows.h
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "tile/codegen/driver.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+
+namespace {
+
+std::string Quote(const std::string& text) {
+  std::string result = "\"";
+  for (char ch : text) {
+    switch (ch) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20) {
+          result += str(boost::format("\\u%04x") % static_cast<int>(ch));
+        } else {
+          result += ch;
+        }
+        break;
+    }
+  }
+  return result + "\"";
+}
+
+std::string Seconds(double seconds) { return str(boost::format("%.6f") % seconds); }
+
+}  // namespace
+
+double OptimizeReport::conversion_seconds() const {
+  double total = 0;
+  for (const auto& step : steps) {
+    if (step.kind == "convert") {
+      total += step.seconds;
+    }
+  }
+  return total;
+}
+
+std::string OptimizeReport::ToJson() const {
+  std::ostringstream ss;
+  ss << "{\"total_seconds\": " << Seconds(total_seconds)               //
+     << ", \"conversion_seconds\": " << Seconds(conversion_seconds())  //
+     << ", \"peak_rss\": " << peak_rss                                 //
+     << ", \"steps\": [";
+  for (size_t i = 0; i < steps.size(); i++) {
+    const auto& step = steps[i];
+    if (i) {
+      ss << ", ";
+    }
+    ss << "{\"name\": " << Quote(step.name)                             //
+       << ", \"kind\": " << Quote(step.kind)                            //
+       << ", \"seconds\": " << Seconds(step.seconds)                    //
+       << ", \"validate_seconds\": " << Seconds(step.validate_seconds)  //
+       << ", \"peak_rss_delta\": " << step.peak_rss_delta               //
+       << ", \"blocks\": " << step.blocks                               //
+       << ", \"statements\": " << step.statements << "}";
+  }
+  ss << "]}";
+  return ss.str();
+}
+
+int64_t PeakResidentBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<int64_t>(counters.PeakWorkingSetSize);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage)) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<int64_t>(usage.ru_maxrss);
+#else
+  // Linux reports kilobytes.
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
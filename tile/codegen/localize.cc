@@ -3,6 +3,9 @@
 #include "tile/codegen/localize.h"
 
 #include <algorithm>
+#include <map>
+#include <set>
+#include <string>
 
 #include <boost/format.hpp>
 
@@ -74,12 +77,15 @@ void LocalizeRef(Block* block, const std::string& var_name) {
 
 void LocalizeBlockPass(const AliasMap& scope, Block* block, const std::set<std::string>& ref_reqs) {
   auto use_count = scope.RefUseCounts(*block);
+  // Pick the refs of each inner block to localize, removing them from this
+  // block.  A ref picked for one inner block is used by no other, so the inner
+  // blocks can then be localized concurrently.
+  std::map<Block*, std::set<std::string>> refs_to_localize;
   for (auto& stmt : block->stmts) {
     auto inner = Block::Downcast(stmt);
     if (!inner) {
       continue;
     }
-    std::set<std::string> refs_to_localize;
     std::set<std::string> refs_to_remove;
     for (const auto& ref : inner->refs) {
       auto it = block->ref_by_into(ref.from, false);
@@ -98,19 +104,24 @@ void LocalizeBlockPass(const AliasMap& scope, Block* block, const std::set<std::
       if (use_count[ref.from] != 1) {
         continue;
       }
-      refs_to_localize.emplace(ref.into());
+      refs_to_localize[inner.get()].emplace(ref.into());
       refs_to_remove.emplace(ref.from);
     }
     for (const auto& name : refs_to_remove) {
       block->refs.erase(block->ref_by_into(name));
     }
-    for (const auto& name : refs_to_localize) {
-      LocalizeRef(inner.get(), name);
+  }
+  ParallelForInnerBlocks(block, [&](Block* inner) {
+    auto it = refs_to_localize.find(inner);
+    if (it != refs_to_localize.end()) {
+      for (const auto& name : it->second) {
+        LocalizeRef(inner, name);
+      }
     }
     // Now localize block itself
-    AliasMap inner_map(scope, inner.get());
-    LocalizeBlockPass(inner_map, inner.get(), ref_reqs);
-  }
+    AliasMap inner_map(scope, inner);
+    LocalizeBlockPass(inner_map, inner, ref_reqs);
+  });
 }
 
 void LocalizePass::Apply(CompilerState* state) const {
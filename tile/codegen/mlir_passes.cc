@@ -4,6 +4,7 @@
 
 #include <functional>
 #include <memory>
+#include <utility>
 
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/DebugStringHelper.h"
@@ -42,7 +43,10 @@ CompilerState::~CompilerState() = default;
 
 void ConvertFromMLIR(CompilerState* state) {
   IVLOG(1, "Converting from Stripe MLIR");
-  *state->prog = *pmlc::dialect::stripe::FromMLIR(*state->mlir->module);
+  auto prog = pmlc::dialect::stripe::FromMLIR(*state->mlir->module);
+  // The transcoder only carries the code; keep the program's buffers.
+  prog->buffers = std::move(state->prog->buffers);
+  *state->prog = std::move(*prog);
   IVLOG(3, "New\n" << *state->prog->entry);
 }
 
@@ -59,10 +63,21 @@ std::unique_ptr<mlir::Pass> CreatePass(Config config) {
   return std::make_unique<Pass>(config);
 }
 
+// Whether an MLIR pass with the given config leaves the program as it is.
+template <typename Config>
+bool IsNoop(const Config&) {
+  return false;
+}
+
+// The no-op pass is only worth converting the program for when it is there to
+// exercise the transcoders.
+inline bool IsNoop(const proto::MLIR_NopPass& config) { return !config.transcode(); }
+
 template <class Pass, class Config>
 class MlirCompilePass : public CompilePass {
  public:
   bool is_stripe() const override { return false; }
+  bool is_noop() const override { return IsNoop(config); }
   explicit MlirCompilePass(const Config& cfg) : config(cfg) {}
   void Apply(CompilerState* root) const override {
     mlir::PassManager pm(&root->mlir->ctx, true);
@@ -100,12 +100,7 @@ void Scalarize(Block* block, bool recursive) {
   }
   // If recursion was requested, do that
   if (recursive) {
-    for (auto& stmt : block->stmts) {
-      auto inner = Block::Downcast(stmt);
-      if (inner) {
-        Scalarize(inner.get(), true);
-      }
-    }
+    ParallelForInnerBlocks(block, [](Block* inner) { Scalarize(inner, true); });
   }
 }
 
@@ -9,6 +9,7 @@
 #include "base/util/lookup.h"
 #include "base/util/stream_container.h"
 #include "base/util/throw.h"
+#include "tile/codegen/alias.h"
 #include "tile/codegen/tile.h"
 #include "tile/math/util.h"
 #include "tile/stripe/stripe.h"
@@ -257,12 +258,7 @@ void ApplyRefTags(Block* block, const StencilMatch& match, const StencilPassOpti
 }
 
 void StencilPassRecurse(Block* block, const StencilPassOptions& options) {
-  for (auto stmt : block->stmts) {
-    auto inner = Block::Downcast(stmt);
-    if (inner) {
-      StencilPassRecurse(inner.get(), options);
-    }
-  }
+  ParallelForInnerBlocks(block, [&options](Block* inner) { StencilPassRecurse(inner, options); });
   if (block->has_tags(options.reqs)) {
     auto match = FindBestStencil(options.specs, options.is_strict_dims, block);
     if (!match) {
@@ -2,6 +2,8 @@
 
 #include <gmock/gmock.h>
 
+#include <atomic>
+
 #include "tile/codegen/alias.h"
 
 namespace vertexai {
@@ -64,6 +66,41 @@ TEST(Codegen, AliasCheckOverlap) {
       }));
 }
 
+TEST(Codegen, RunOnBlocksParallel) {
+  using stripe::Block;
+  auto program = std::make_shared<Block>();
+  program->name = "program";
+  program->refs.emplace(stripe::RefDir::None, "", "A", std::vector<stripe::Affine>{0},
+                        SimpleShape(DataType::FLOAT32, {64}));
+  auto main = std::make_shared<Block>();
+  main->name = "main";
+  main->set_tag("main");
+  main->refs.emplace(stripe::RefDir::InOut, "A", "A", std::vector<stripe::Affine>{0},
+                     SimpleShape(DataType::FLOAT32, {64}));
+  for (size_t i = 0; i < 64; i++) {
+    auto kernel = std::make_shared<Block>();
+    kernel->name = "kernel_" + std::to_string(i);
+    kernel->set_tag("kernel");
+    kernel->refs.emplace(stripe::RefDir::InOut, "A", "a", std::vector<stripe::Affine>{static_cast<int64_t>(i)},
+                         SimpleShape(DataType::FLOAT32, {1}));
+    main->stmts.push_back(kernel);
+  }
+  program->stmts.push_back(main);
+
+  std::atomic<size_t> visits{0};
+  RunOnBlocksParallel(program.get(), {"kernel"}, [&](const AliasMap& map, Block* block) {
+    EXPECT_EQ(map.this_block(), block);
+    EXPECT_EQ(map.parent_block(), main.get());
+    EXPECT_EQ(map.at("a").base_name, "d1:A");
+    block->set_tag("visited");
+    visits++;
+  });
+  EXPECT_EQ(visits, 64);
+  for (const auto& stmt : main->stmts) {
+    EXPECT_TRUE(Block::Downcast(stmt)->has_tag("visited"));
+  }
+}
+
 }  // namespace test
 }  // namespace codegen
 }  // namespace tile
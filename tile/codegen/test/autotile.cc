@@ -0,0 +1,106 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <boost/filesystem.hpp>
+
+#include "plaidml2/edsl/helper.h"
+#include "tile/codegen/autotile.h"
+#include "tile/codegen/tuning_db.h"
+#include "tile/codegen/vm.h"
+#include "tile/lib/lib.h"
+#include "tile/stripe/stripe.h"
+
+using ::testing::ContainerEq;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Ne;
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+namespace test {
+
+namespace fs = boost::filesystem;
+
+using plaidml::edsl::LogicalShape;
+
+TEST(TuningDB, KeepsFastestAcrossReloads) {
+  auto path = fs::temp_directory_path() / fs::unique_path("tuning-%%%%-%%%%.json");
+  {
+    TuningDB db(path.string());
+    db.AddEntry("k", {4, 4}, 100);
+    db.AddEntry("k", {8, 2}, 50);
+    db.AddEntry("k", {2, 8}, 75);
+  }
+  TuningDB db(path.string());
+  TileShape tile;
+  EXPECT_TRUE(db.Lookup("k", &tile));
+  EXPECT_THAT(tile, ElementsAre(8, 2));
+  EXPECT_FALSE(db.Lookup("missing", &tile));
+  fs::remove(path);
+}
+
+TEST(TuningDB, KeyIgnoresBlockName) {
+  stripe::Block a;
+  a.name = "kernel_0";
+  a.idxs.emplace_back(stripe::Index{"i", 16});
+  stripe::Block b = a;
+  b.name = "kernel_1";
+  EXPECT_THAT(TuningDB::MakeKey(a), Eq(TuningDB::MakeKey(b)));
+  EXPECT_THAT(TuningDB::MakeKey(a), Ne(TuningDB::MakeKey(a, "salt")));
+  b.idxs[0].range = 32;
+  EXPECT_THAT(TuningDB::MakeKey(a), Ne(TuningDB::MakeKey(b)));
+}
+
+TEST(Autotile, MeasuredTiling) {
+  const std::int64_t DIM = 5;
+  std::vector<float> a(DIM * DIM);
+  std::vector<float> b(DIM * DIM);
+  std::vector<float> expected(DIM * DIM);
+  for (int64_t i = 0; i < DIM * DIM; i++) {
+    a[i] = i % 7;
+    b[i] = i % 3;
+  }
+  for (int64_t i = 0; i < DIM; i++) {
+    for (int64_t j = 0; j < DIM; j++) {
+      for (int64_t k = 0; k < DIM; k++) {
+        expected[i * DIM + j] += a[i * DIM + k] * b[k * DIM + j];
+      }
+    }
+  }
+
+  auto path = fs::temp_directory_path() / fs::unique_path("tuning-%%%%-%%%%.json");
+  proto::AutotilePass options;
+  options.add_reqs("agg_op_add");
+  options.set_tune_candidates(4);
+  options.set_tune_db(path.string());
+
+  for (int run = 0; run < 2; run++) {
+    // The second run is served from the tuning database.
+    auto tileProgram = lib::LoadMatMul(                  //
+        "matmul",                                        //
+        LogicalShape(PLAIDML_DATA_FLOAT32, {DIM, DIM}),  //
+        LogicalShape(PLAIDML_DATA_FLOAT32, {DIM, DIM}));
+    auto program = plaidml::edsl::ConvertIntoStripe(tileProgram);
+    CompilerState state(program);
+    AutotilePass(options).Apply(&state);
+    IVLOG(2, "\n" << *program->entry);
+
+    EXPECT_THAT(fs::file_size(path), Ne(0));
+
+    std::map<std::string, std::vector<float>> data = {
+        {"A", a},
+        {"B", b},
+        {"C", std::vector<float>(DIM * DIM)},
+    };
+    ExecuteProgram(*program->entry, &data);
+    EXPECT_THAT(data["C"], ContainerEq(expected));
+  }
+  fs::remove(path);
+}
+
+}  // namespace test
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,194 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/proto/proto.h"
+#include "tile/codegen/codegen.pb.h"
+#include "tile/codegen/driver.h"
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/targets.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+namespace test {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+
+static std::shared_ptr<stripe::Program> MatMul() {
+  lang::RunInfo runinfo;
+  runinfo.program_name = "matmul";
+  runinfo.code = R"***(
+    function (A[I, K], B[K, J]) -> (C) {
+      C[i, j: I, J] = +(A[i, k] * B[k, j]);
+    }
+  )***";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {8, 8}));
+  runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {8, 8}));
+  runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {8, 8}));
+  return GenerateStripe(runinfo);
+}
+
+TEST(Driver, OptimizeReport) {
+  auto program = MatMul();
+
+  auto stage = ParseProtoText<proto::Stage>(R"(
+    passes: [
+      {
+        name: "loc_prog"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.LocateMemoryPass] {
+            reqs: ["program"]
+            loc: { devs: [{name: "DRAM"}] }
+          }
+        }
+      }, {
+        name: "compute_deps"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.ComputeDepsPass] {
+            reqs: ["all"]
+          }
+        }
+      }
+    ]
+  )");
+
+  OptimizeReport report;
+  OptimizeOptions options;
+  options.report = &report;
+  CompilerState state(program);
+  Optimize(&state, stage.passes(), options);
+
+  ASSERT_THAT(report.steps.size(), Eq(2u));
+  EXPECT_THAT(report.steps[0].name, Eq("loc_prog"));
+  EXPECT_THAT(report.steps[1].name, Eq("compute_deps"));
+  for (const auto& step : report.steps) {
+    EXPECT_THAT(step.kind, Eq("stripe"));
+    // At least the program and main
+    EXPECT_THAT(step.blocks, Gt(1u));
+    EXPECT_THAT(step.statements, Gt(0u));
+  }
+  EXPECT_THAT(report.conversion_seconds(), Eq(0));
+  EXPECT_THAT(report.total_seconds, Gt(0));
+
+  auto json = report.ToJson();
+  EXPECT_THAT(json, HasSubstr("\"name\": \"compute_deps\""));
+  EXPECT_THAT(json, HasSubstr("\"kind\": \"stripe\""));
+}
+
+TEST(Driver, SkipsNoopMlirPasses) {
+  auto program = MatMul();
+  auto stage = ParseProtoText<proto::Stage>(R"(
+    passes: [
+      {
+        name: "loc_prog"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.LocateMemoryPass] {
+            reqs: ["program"]
+            loc: { devs: [{name: "DRAM"}] }
+          }
+        }
+      }, {
+        name: "mlir_nop"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.MLIR_NopPass] {}
+        }
+      }, {
+        name: "compute_deps"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.ComputeDepsPass] {
+            reqs: ["all"]
+          }
+        }
+      }
+    ]
+  )");
+
+  OptimizeReport report;
+  OptimizeOptions options;
+  options.report = &report;
+  CompilerState state(program);
+  Optimize(&state, stage.passes(), options);
+
+  // Neither the no-op pass nor the conversions around it run.
+  ASSERT_THAT(report.steps.size(), Eq(2u));
+  EXPECT_THAT(report.steps[0].name, Eq("loc_prog"));
+  EXPECT_THAT(report.steps[1].name, Eq("compute_deps"));
+}
+
+TEST(Driver, TranscodesForNopPass) {
+  auto program = MatMul();
+  auto stage = ParseProtoText<proto::Stage>(R"(
+    passes: [
+      {
+        name: "loc_prog"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.LocateMemoryPass] {
+            reqs: ["program"]
+            loc: { devs: [{name: "DRAM"}] }
+          }
+        }
+      }, {
+        name: "mlir_nop"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.MLIR_NopPass] { transcode: true }
+        }
+      }, {
+        name: "compute_deps"
+        pass: {
+          [type.vertex.ai/vertexai.tile.codegen.proto.ComputeDepsPass] {
+            reqs: ["all"]
+          }
+        }
+      }
+    ]
+  )");
+
+  OptimizeReport report;
+  OptimizeOptions options;
+  options.report = &report;
+  CompilerState state(program);
+  Optimize(&state, stage.passes(), options);
+
+  // A no-op pass which asks for transcoding runs, converting the program into
+  // MLIR and back.
+  ASSERT_THAT(report.steps.size(), Eq(5u));
+  EXPECT_THAT(report.steps[1].name, Eq("into_mlir"));
+  EXPECT_THAT(report.steps[2].name, Eq("mlir_nop"));
+  EXPECT_THAT(report.steps[3].name, Eq("from_mlir"));
+  EXPECT_THAT(report.steps[4].name, Eq("compute_deps"));
+}
+
+TEST(Driver, LlvmCpuConvertsOncePerMlirGroup) {
+  auto program = MatMul();
+  auto configs = targets::GetConfigs();
+  const auto& stage = configs.configs().at("llvm_cpu").stages().at("default");
+
+  OptimizeReport report;
+  OptimizeOptions options;
+  options.report = &report;
+  CompilerState state(program);
+  Optimize(&state, stage.passes(), options);
+
+  // The MLIR passes run in two groups, each converting into MLIR and back.
+  std::vector<std::string> conversions;
+  for (const auto& step : report.steps) {
+    if (step.kind == "convert") {
+      conversions.push_back(step.name);
+    }
+  }
+  EXPECT_THAT(conversions, ElementsAre("into_mlir", "from_mlir", "into_mlir", "from_mlir"));
+}
+
+}  // namespace test
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,97 @@
+// Copyright 2020, Intel Corporation
+
+#include "tile/codegen/tuning_db.h"
+
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+#include "base/util/json_transfer.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+
+TuningDB::TuningDB(const std::string& filename) {
+  if (filename.empty()) {
+    return;
+  }
+  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
+  file_.open(filename, std::fstream::in | std::fstream::out | std::fstream::app);
+  file_.seekp(0);
+  std::string line;
+  file_.exceptions(std::fstream::badbit);
+  while (std::getline(file_, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    AddEntry(inline_json_deserialize<Entry>(line));
+  }
+  file_.clear();
+  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
+}
+
+TuningDB* TuningDB::Open(const std::string& filename) {
+  static std::mutex mu;
+  static std::map<std::string, std::unique_ptr<TuningDB>> instances;
+  std::lock_guard<std::mutex> lock(mu);
+  auto& db = instances[filename];
+  if (!db) {
+    db = std::make_unique<TuningDB>(filename);
+  }
+  return db.get();
+}
+
+std::string TuningDB::MakeKey(const stripe::Block& block, const std::string& salt) {
+  // The block name and comments vary between otherwise identical programs,
+  // so they are left out of the key.
+  auto clone = stripe::CloneBlock(block);
+  clone->name.clear();
+  clone->comments.clear();
+  std::stringstream ss;
+  ss << *clone << salt;
+  // FNV-1a, so that keys are stable across processes and builds.
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (char c : ss.str()) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001B3ull;
+  }
+  std::stringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return key.str();
+}
+
+void TuningDB::AddEntry(const std::string& key, const TileShape& tile, int64_t ticks) {
+  Entry e;
+  e.key = key;
+  e.tile = tile;
+  e.ticks = ticks;
+  std::lock_guard<std::mutex> lock(mu_);
+  AddEntry(e);
+  if (file_.is_open()) {
+    std::string row = json_serialize(e);
+    file_.write(row.data(), row.size());
+    file_.flush();
+  }
+}
+
+bool TuningDB::Lookup(const std::string& key, TileShape* tile) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = best_.find(key);
+  if (it == best_.end()) {
+    return false;
+  }
+  *tile = it->second.tile;
+  return true;
+}
+
+void TuningDB::AddEntry(const Entry& entry) {
+  auto it = best_.find(entry.key);
+  if (it == best_.end() || entry.ticks < it->second.ticks) {
+    best_[entry.key] = entry;
+  }
+}
+
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
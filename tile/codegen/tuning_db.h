@@ -0,0 +1,57 @@
+// Copyright 2020, Intel Corporation
+
+#pragma once
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "base/util/transfer_object.h"
+#include "tile/base/shape.h"
+#include "tile/stripe/stripe.h"
+
+namespace vertexai {
+namespace tile {
+namespace codegen {
+
+// Records measured tilings so that repeated compiles of the same block can
+// skip the measurement.  Entries are stored one JSON object per line; when
+// several measurements exist for a key, the fastest one wins.
+class TuningDB {
+ public:
+  // Construct a database, if given a filename, use that for storage
+  explicit TuningDB(const std::string& filename = "");
+  // Get the shared instance for a filename ("" for an in-memory database)
+  static TuningDB* Open(const std::string& filename);
+  // Computes a key which identifies a block by its shape rather than its name
+  static std::string MakeKey(const stripe::Block& block, const std::string& salt = "");
+  // Record a measured tile for a key
+  void AddEntry(const std::string& key, const TileShape& tile, int64_t ticks);
+  // Looks up the fastest recorded tile for a key, returns false if not found
+  bool Lookup(const std::string& key, TileShape* tile) const;
+
+ private:
+  struct Entry {
+    std::string key;
+    TileShape tile;
+    int64_t ticks;
+
+    TRANSFER_OBJECT {
+      VERSION(0);
+      FIELD(key);
+      FIELD(tile);
+      FIELD(ticks);
+    }
+  };
+
+  void AddEntry(const Entry& entry);
+
+  mutable std::mutex mu_;
+  std::map<std::string, Entry> best_;
+  std::fstream file_;
+};
+
+}  // namespace codegen
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,112 @@
+// Copyright 2020, Intel Corporation
+
+// Measures the constraint solving done for each contraction as it is
+// flattened: ComputeBounds, and the ILPSolver::batch_solve call at its core.
+// The workloads are the contractions built by the tile/lib operations.
+//
+// Run with: bazel run //tile/lang:bench
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/base/shape.h"
+#include "tile/bilp/ilp_solver.h"
+#include "tile/lang/bound.h"
+#include "tile/lang/parser.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+namespace bench {
+
+using namespace math;  // NOLINT
+
+namespace {
+
+struct Workload {
+  const char* name;
+  const char* code;
+  std::vector<std::vector<size_t>> dims;  // Output first, then each input
+};
+
+const std::vector<Workload>& Workloads() {
+  static const std::vector<Workload> workloads{
+      {"matmul", "O[i, j] = +(A[i, k] * B[k, j])", {{1024, 1024}, {1024, 1024}, {1024, 1024}}},
+      {"conv2d",
+       "O[n, x, y, co] = +(I[n, x + i - 1, y + j - 1, ci] * K[i, j, ci, co])",
+       {{1, 56, 56, 64}, {1, 56, 56, 64}, {3, 3, 64, 64}}},
+      {"conv2d_strided",
+       "O[n, x, y, co] = +(I[n, 2*x + i, 2*y + j, ci] * K[i, j, ci, co])",
+       {{1, 112, 112, 64}, {1, 230, 230, 3}, {7, 7, 3, 64}}},
+      {"conv2d_dilated",
+       "O[n, x, y, co] = +(I[n, x + 2*i, y + 2*j, ci] * K[i, j, ci, co])",
+       {{1, 56, 56, 64}, {1, 60, 60, 64}, {3, 3, 64, 64}}},
+      {"maxpool2d", "O[n, x, y, c] = >(I[n, 2*x + i, 2*y + j, c]), i < 2, j < 2", {{1, 56, 56, 64}, {1, 112, 112, 64}}},
+  };
+  return workloads;
+}
+
+std::vector<RangeConstraint> Constraints(const Workload& workload) {
+  Parser parser;
+  auto contraction = parser.ParseContraction(workload.code);
+  std::vector<TensorShape> shapes;
+  for (const auto& dims : workload.dims) {
+    shapes.push_back(SimpleShape(DataType::FLOAT32, dims));
+  }
+  auto constraints = GatherConstraints(contraction, shapes);
+  MergeParallelConstraints(&constraints);
+  return constraints;
+}
+
+void WorkloadArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < Workloads().size(); i++) {
+    b->Arg(i);
+  }
+}
+
+}  // namespace
+
+void ComputeContractionBounds(benchmark::State& state) {  // NOLINT[runtime/references]
+  const auto& workload = Workloads()[state.range(0)];
+  state.SetLabel(workload.name);
+  auto constraints = Constraints(workload);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputeBounds(constraints));
+  }
+}
+
+BENCHMARK(ComputeContractionBounds)->Apply(WorkloadArgs)->Unit(benchmark::kMicrosecond);
+
+void BatchSolveContraction(benchmark::State& state) {  // NOLINT[runtime/references]
+  const auto& workload = Workloads()[state.range(0)];
+  state.SetLabel(workload.name);
+  auto constraints = Constraints(workload);
+  // Minimize and maximize each index, as ComputeBounds does
+  std::set<std::string> names;
+  for (const auto& constraint : constraints) {
+    for (const auto& kvp : constraint.poly.getMap()) {
+      if (!kvp.first.empty()) {
+        names.insert(kvp.first);
+      }
+    }
+  }
+  std::vector<Polynomial<Rational>> objectives;
+  for (const auto& name : names) {
+    objectives.emplace_back(name);
+    objectives.emplace_back(name, -1);
+  }
+  bilp::ILPSolver solver;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(solver.batch_solve(constraints, objectives));
+  }
+}
+
+BENCHMARK(BatchSolveContraction)->Apply(WorkloadArgs)->Unit(benchmark::kMicrosecond);
+
+}  // namespace bench
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
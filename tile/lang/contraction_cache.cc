@@ -0,0 +1,167 @@
+#include "tile/lang/contraction_cache.h"
+
+#include <sstream>
+
+#include "base/util/env.h"
+#include "base/util/json_transfer.h"
+#include "base/util/logging.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+
+using namespace math;  // NOLINT
+
+namespace {
+
+Rational LoadRational(const std::string& text) {
+  auto slash = text.find('/');
+  if (slash == std::string::npos) {
+    return Rational(Integer(text));
+  }
+  return Rational(Integer(text.substr(0, slash)), Integer(text.substr(slash + 1)));
+}
+
+}  // namespace
+
+ContractionCache::ContractionCache(const std::string& filename, bool use_env) {
+  std::string openname = filename;
+  if (filename == "") {
+    if (!use_env) {
+      return;
+    }
+    openname = env::Get("PLAIDML_CONTRACTION_CACHE");
+    if (!openname.length()) {
+      return;
+    }
+  }
+  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
+  file_.open(openname, std::fstream::in | std::fstream::out | std::fstream::app);
+  file_.seekp(0);
+  std::string line;
+  file_.exceptions(std::fstream::badbit);
+  while (std::getline(file_, line)) {
+    auto entry = inline_json_deserialize<Entry>(line);
+    cache_[entry.key] = FromEntry(entry);
+  }
+  file_.clear();
+  file_.exceptions(std::fstream::failbit | std::fstream::badbit);
+  IVLOG(1, "Loaded " << cache_.size() << " lowered contractions from " << openname);
+}
+
+ContractionCache* ContractionCache::Instance() {
+  static ContractionCache instance("", true);
+  return &instance;
+}
+
+std::string ContractionCache::Key(const Contraction& c, const std::vector<TensorShape>& shapes) {
+  // Lowering only looks at the index polynomials, the constraints, and the
+  // sizes of the dimensions, so the tensor names and types are left out.
+  std::ostringstream ss;
+  for (const auto& spec : c.specs) {
+    ss << "[";
+    for (const auto& poly : spec.spec) {
+      ss << poly.toString() << ",";
+    }
+    ss << "]";
+  }
+  for (const auto& cons : c.constraints) {
+    ss << to_string(cons.bound) << ";";
+  }
+  if (c.no_defract) {
+    ss << "no_defract;";
+  }
+  for (const auto& shape : shapes) {
+    ss << "(";
+    for (const auto& dim : shape.dims) {
+      ss << dim.size << ",";
+    }
+    ss << ")";
+  }
+  return ss.str();
+}
+
+LoweredContraction ContractionCache::GetOrLower(const Contraction& c, const std::vector<TensorShape>& shapes,
+                                                const std::function<LoweredContraction()>& lower) {
+  auto key = Key(c, shapes);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+      hits_++;
+      return it->second;
+    }
+    misses_++;
+  }
+  // Lower without holding the lock; if another thread lowers the same
+  // contraction meanwhile, both arrive at the same result.
+  auto lowered = lower();
+  std::lock_guard<std::mutex> lock(mu_);
+  if (cache_.emplace(key, lowered).second && file_.is_open()) {
+    std::string row = json_serialize(ToEntry(key, lowered));
+    file_.write(row.data(), row.size());
+    file_.flush();
+  }
+  return lowered;
+}
+
+ContractionCache::Poly ContractionCache::SavePoly(const Polynomial<Rational>& poly) {
+  Poly out;
+  for (const auto& kvp : poly.getMap()) {
+    out.push_back(Term{kvp.first, kvp.second.str()});
+  }
+  return out;
+}
+
+Polynomial<Rational> ContractionCache::LoadPoly(const ContractionCache::Poly& saved) {
+  Polynomial<Rational> poly;
+  for (const auto& term : saved) {
+    poly.mutateMap().emplace(term.index, LoadRational(term.coeff));
+  }
+  return poly;
+}
+
+ContractionCache::Entry ContractionCache::ToEntry(const std::string& key, const LoweredContraction& lowered) {
+  Entry entry;
+  entry.key = key;
+  for (const auto& spec : lowered.specs) {
+    entry.specs.emplace_back();
+    for (const auto& poly : spec) {
+      entry.specs.back().push_back(SavePoly(poly));
+    }
+  }
+  for (const auto& cons : lowered.constraints) {
+    entry.constraints.push_back(Constraint{SavePoly(cons.poly), cons.range});
+  }
+  for (const auto& kvp : lowered.bounds) {
+    entry.bounds.push_back(Range{kvp.first, kvp.second.min, kvp.second.max});
+  }
+  for (const auto& cons : lowered.remaining) {
+    entry.remaining.push_back(Constraint{SavePoly(cons.poly), cons.rhs});
+  }
+  return entry;
+}
+
+LoweredContraction ContractionCache::FromEntry(const Entry& entry) {
+  LoweredContraction lowered;
+  for (const auto& spec : entry.specs) {
+    lowered.specs.emplace_back();
+    for (const auto& poly : spec) {
+      lowered.specs.back().push_back(LoadPoly(poly));
+    }
+  }
+  for (const auto& cons : entry.constraints) {
+    lowered.constraints.emplace_back(LoadPoly(cons.poly), cons.value);
+  }
+  for (const auto& range : entry.bounds) {
+    lowered.bounds[range.index] = Bound{range.min, range.max};
+  }
+  for (const auto& cons : entry.remaining) {
+    lowered.remaining.emplace_back(LoadPoly(cons.poly), cons.value);
+  }
+  return lowered;
+}
+
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
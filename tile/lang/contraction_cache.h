@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/util/transfer_object.h"
+#include "tile/base/shape.h"
+#include "tile/lang/ops.h"
+
+namespace vertexai {
+namespace tile {
+namespace lang {
+
+// The result of lowering a contraction: the index spec of each tensor after
+// reduction and defractionalization, the constraints on the indexes, their
+// bounds, and the constraints which the bounds do not already imply.
+struct LoweredContraction {
+  std::vector<IndexSpec> specs;
+  std::vector<math::RangeConstraint> constraints;
+  math::IndexBounds bounds;
+  std::vector<math::SimpleConstraint> remaining;
+};
+
+// Memoizes contraction lowering, so that a contraction which recurs with the
+// same shapes, such as a layer repeated throughout a network, is analysed once.
+// Keys do not depend on the names of the tensors involved.
+class ContractionCache {
+ public:
+  // Construct a cache, if given a filename, use that for storage
+  explicit ContractionCache(const std::string& filename = "", bool use_env = false);
+  // Get the 'singleton' instance, loads for PLAIDML_CONTRACTION_CACHE if set
+  static ContractionCache* Instance();
+  // Returns the canonical key of a contraction applied to the given shapes
+  static std::string Key(const Contraction& c, const std::vector<TensorShape>& shapes);
+  // Returns the lowered form of the contraction, calling lower to produce it if
+  // it is not already known
+  LoweredContraction GetOrLower(const Contraction& c, const std::vector<TensorShape>& shapes,
+                                const std::function<LoweredContraction()>& lower);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+ private:
+  // A term of a polynomial
+  struct Term {
+    std::string index;  // Empty for the constant term
+    std::string coeff;
+
+    TRANSFER_OBJECT {
+      VERSION(0);
+      FIELD(index);
+      FIELD(coeff);
+    }
+  };
+
+  typedef std::vector<Term> Poly;
+
+  // A range or simple constraint
+  struct Constraint {
+    Poly poly;
+    int64_t value;
+
+    TRANSFER_OBJECT {
+      VERSION(0);
+      FIELD(poly);
+      FIELD(value);
+    }
+  };
+
+  struct Range {
+    std::string index;
+    int64_t min;
+    int64_t max;
+
+    TRANSFER_OBJECT {
+      VERSION(0);
+      FIELD(index);
+      FIELD(min);
+      FIELD(max);
+    }
+  };
+
+  struct Entry {
+    std::string key;
+    std::vector<std::vector<Poly>> specs;
+    std::vector<Constraint> constraints;
+    std::vector<Range> bounds;
+    std::vector<Constraint> remaining;
+
+    TRANSFER_OBJECT {
+      VERSION(0);
+      FIELD(key);
+      FIELD(specs);
+      FIELD(constraints);
+      FIELD(bounds);
+      FIELD(remaining);
+    }
+  };
+
+  static Poly SavePoly(const math::Polynomial<math::Rational>& poly);
+  static math::Polynomial<math::Rational> LoadPoly(const Poly& saved);
+  static Entry ToEntry(const std::string& key, const LoweredContraction& lowered);
+  static LoweredContraction FromEntry(const Entry& entry);
+
+  std::mutex mu_;
+  std::unordered_map<std::string, LoweredContraction> cache_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+  std::fstream file_;
+};
+
+}  // namespace lang
+}  // namespace tile
+}  // namespace vertexai
@@ -7,6 +7,7 @@
 #include <boost/format.hpp>
 
 #include "tile/lang/bound.h"
+#include "tile/lang/contraction_cache.h"
 #include "tile/lang/defract.h"
 #include "tile/lang/parser.h"
 #include "tile/lang/reduce.h"
@@ -215,20 +216,31 @@ class StripeGenerator {
       IVLOG(3, "Contraction output " << op.output << " size==0; skipping");
       return;
     }
-    Contraction cion;
-    std::vector<math::RangeConstraint> range_cons;
     auto shapes = MakeShapes(op.c);
-    std::tie(cion, range_cons) = CompileContraction(op.c, shapes);
-
-    // Compute bounds
-    IndexBounds bounds;
-    std::vector<SimpleConstraint> simple_cons;
-    try {
-      std::tie(bounds, simple_cons) = ComputeBounds(range_cons);
-    } catch (const std::runtime_error& ex) {
-      LOG(WARNING) << "Unable to compute bounds for contraction: " << to_string(cion);
-      throw;
+    auto lowered = ContractionCache::Instance()->GetOrLower(op.c, shapes, [&] {
+      LoweredContraction result;
+      Contraction cion;
+      std::tie(cion, result.constraints) = CompileContraction(op.c, shapes);
+      for (const auto& spec : cion.specs) {
+        result.specs.push_back(spec.spec);
+      }
+      // Compute bounds
+      try {
+        std::tie(result.bounds, result.remaining) = ComputeBounds(result.constraints);
+      } catch (const std::runtime_error& ex) {
+        LOG(WARNING) << "Unable to compute bounds for contraction: " << to_string(cion);
+        throw;
+      }
+      return result;
+    });
+    // Lowering rewrites only the index specs, so the cached specs may be
+    // applied to this contraction's own tensors.
+    Contraction cion = op.c;
+    for (size_t i = 0; i < cion.specs.size(); i++) {
+      cion.specs[i].spec = lowered.specs[i];
     }
+    const auto& bounds = lowered.bounds;
+    const auto& simple_cons = lowered.remaining;
 
     auto kernel = AddKernel(main, op);
     auto agg_op = GetAggOp(cion.agg_op);
@@ -1,8 +1,12 @@
+#include <fstream>
 #include <mutex>
 
+#include <boost/filesystem.hpp>
+
 #include "tile/base/shape.h"
 #include "tile/lang/bound.h"
 #include "tile/lang/compile.h"
+#include "tile/lang/contraction_cache.h"
 #include "tile/lang/defract.h"
 #include "tile/lang/flat.h"
 #include "tile/lang/gen_contract.h"
@@ -17,11 +21,13 @@
 #include "tile/lang/semtree.h"
 #include "tile/lang/sym_poly.h"
 #include "tile/lang/symbolic.h"
+#include "tile/lang/tile_cache.h"
 #include "tile/lang/tile_opt.h"
 #include "tile/lang/type.h"
 #include "tile/math/matrix.h"
 
 #include "base/util/catch.h"
+#include "base/util/env.h"
 #include "base/util/logging.h"
 
 namespace vertexai {
@@ -85,6 +91,130 @@ TEST_CASE("Bound check convolution equal sized", "[bound]") {
   REQUIRE(out["x"].max == 6);
 }
 
+TEST_CASE("Contraction cache ignores tensor names", "[bound][cache]") {
+  Parser p;
+  auto shapes = std::vector<TensorShape>{SimpleShape(DataType::FLOAT32, {1, 8, 8, 4}),  //
+                                         SimpleShape(DataType::FLOAT32, {1, 8, 8, 4}),  //
+                                         SimpleShape(DataType::FLOAT32, {3, 3, 4, 4})};
+  auto c1 = p.ParseContraction("O[n, x, y, co] = +(I[n, x + i - 1, y + j - 1, ci] * K[i, j, ci, co])");
+  auto c2 = p.ParseContraction("P[n, x, y, co] = +(J[n, x + i - 1, y + j - 1, ci] * L[i, j, ci, co])");
+  size_t lowerings = 0;
+  auto lower = [&] {
+    lowerings++;
+    LoweredContraction lowered;
+    lowered.constraints = GatherConstraints(c1, shapes);
+    std::tie(lowered.bounds, lowered.remaining) = ComputeBounds(lowered.constraints);
+    for (const auto& spec : c1.specs) {
+      lowered.specs.push_back(spec.spec);
+    }
+    return lowered;
+  };
+  auto filename = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "%%%%-%%%%.json");
+  ContractionCache cache(filename.string());
+  auto first = cache.GetOrLower(c1, shapes, lower);
+  auto second = cache.GetOrLower(c2, shapes, lower);
+  REQUIRE(lowerings == 1);
+  REQUIRE(cache.hits() == 1);
+  REQUIRE(second.specs == first.specs);
+  REQUIRE(second.remaining.size() == 4);
+  REQUIRE(second.bounds["x"].min == 0);
+  REQUIRE(second.bounds["x"].max == 7);
+
+  // Different shapes are lowered separately
+  shapes[2] = SimpleShape(DataType::FLOAT32, {5, 5, 4, 4});
+  cache.GetOrLower(c2, shapes, lower);
+  REQUIRE(lowerings == 2);
+
+  // The entries are reloaded from storage
+  ContractionCache reloaded(filename.string());
+  auto restored = reloaded.GetOrLower(c2, shapes, lower);
+  REQUIRE(lowerings == 2);
+  REQUIRE(reloaded.hits() == 1);
+  REQUIRE(restored.specs == first.specs);
+  REQUIRE(restored.bounds["i"].max == 4);
+  REQUIRE(restored.remaining.size() == 4);
+  boost::filesystem::remove(filename);
+}
+
+TEST_CASE("Tile cache merges, exports and imports by hardware", "[cache]") {
+  DirectSettings settings{256, false, 64};
+  TileCache a;
+  a.AddEntry("gpu0", "k", settings, {4, 4}, 100);
+  a.AddEntry("gpu0", "k", settings, {8, 4}, 50);
+  a.AddEntry("gpu1", "k", settings, {4, 4}, 70);
+  REQUIRE(a.size() == 3);
+  REQUIRE(a.GetDuration("gpu0", "k", settings, {8, 4}) == 50);
+  REQUIRE(a.GetDuration("gpu2", "k", settings, {8, 4}) == -1);
+
+  // Merging keeps the shorter of two durations
+  TileCache b;
+  b.AddEntry("gpu0", "k", settings, {4, 4}, 30);
+  b.AddEntry("gpu0", "k", settings, {8, 4}, 90);
+  b.Merge(a);
+  REQUIRE(b.size() == 3);
+  REQUIRE(b.GetDuration("gpu0", "k", settings, {4, 4}) == 30);
+  REQUIRE(b.GetDuration("gpu0", "k", settings, {8, 4}) == 50);
+  REQUIRE(b.GetDuration("gpu1", "k", settings, {4, 4}) == 70);
+
+  auto filename = boost::filesystem::unique_path(boost::filesystem::temp_directory_path() / "%%%%-%%%%.json");
+  b.Export(filename.string());
+  TileCache c;
+  REQUIRE(c.Import(filename.string()) == 3);
+  REQUIRE(c.GetDuration("gpu0", "k", settings, {8, 4}) == 50);
+
+  // Rows stored before hardware was recorded apply to hardware without rows of its own
+  {
+    std::ofstream legacy(filename.string(), std::ofstream::trunc);
+    legacy << R"({"_ver":0,"key":"k","subkey":{"settings":{"mem_width":64,"threads":256,"use_global":false},)"
+           << R"("tile_size":[8,4]},"value":40})" << '\n';
+  }
+  REQUIRE(c.Import(filename.string()) == 1);
+  REQUIRE(c.GetDuration("gpu0", "k", settings, {8, 4}) == 50);
+  REQUIRE(c.GetDuration("gpu1", "k", settings, {8, 4}) == 40);
+  REQUIRE(c.GetDuration("", "k", settings, {8, 4}) == 40);
+  boost::filesystem::remove(filename);
+}
+
+TEST_CASE("Tile cache imports and exports through the environment", "[cache]") {
+  DirectSettings settings{256, false, 64};
+  auto dir = boost::filesystem::temp_directory_path();
+  auto first = boost::filesystem::unique_path(dir / "%%%%-%%%%.json");
+  auto second = boost::filesystem::unique_path(dir / "%%%%-%%%%.json");
+  auto exported = boost::filesystem::unique_path(dir / "%%%%-%%%%.json");
+  {
+    TileCache a;
+    a.AddEntry("gpu0", "k", settings, {4, 4}, 100);
+    a.Export(first.string());
+    TileCache b;
+    b.AddEntry("gpu0", "k", settings, {4, 4}, 60);
+    b.AddEntry("gpu0", "k", settings, {8, 4}, 80);
+    b.Export(second.string());
+  }
+  env::Set("PLAIDML_TILE_CACHE", "");
+#ifdef _WIN32
+  const std::string sep = ";";
+#else
+  const std::string sep = ":";
+#endif
+  env::Set("PLAIDML_TILE_CACHE_IMPORT", first.string() + sep + (dir / "missing.json").string() + sep + second.string());
+  env::Set("PLAIDML_TILE_CACHE_EXPORT", exported.string());
+
+  // Missing files are skipped
+  TileCache c("", true);
+  REQUIRE(c.size() == 2);
+  REQUIRE(c.GetDuration("gpu0", "k", settings, {4, 4}) == 60);
+  c.AddEntry("gpu0", "k", settings, {2, 4}, 20);
+  c.ExportToEnv();
+  TileCache d;
+  REQUIRE(d.Import(exported.string()) == 3);
+
+  env::Set("PLAIDML_TILE_CACHE_IMPORT", "");
+  env::Set("PLAIDML_TILE_CACHE_EXPORT", "");
+  boost::filesystem::remove(first);
+  boost::filesystem::remove(second);
+  boost::filesystem::remove(exported);
+}
+
 TEST_CASE("Optimization of Matrix Multiply", "[mat_opt][opt]") {
   Parser p;
   auto c = p.ParseContraction("O[i,j] = +(A[i,k] * B[k,j])");
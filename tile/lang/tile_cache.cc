@@ -1,8 +1,13 @@
 
 #include "tile/lang/tile_cache.h"
 
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
 #include "base/util/env.h"
 #include "base/util/json_transfer.h"
+#include "base/util/logging.h"
 
 namespace vertexai {
 namespace tile {
@@ -10,65 +15,213 @@ namespace lang {
 
 TileCache::TileCache(const std::string& filename, bool use_env) {
   std::string openname = filename;
-  if (filename == "") {
-    if (!use_env) {
-      return;
-    }
+  if (filename == "" && use_env) {
     openname = env::Get("PLAIDML_TILE_CACHE");
-    if (!openname.length()) {
-      return;
-    }
   }
+  if (openname.length()) {
+    Open(openname);
+  }
+  if (use_env) {
+    ImportFromEnv();
+  }
+}
+
+void TileCache::Open(const std::string& openname) {
   file_.exceptions(std::fstream::failbit | std::fstream::badbit);
   file_.open(openname, std::fstream::in | std::fstream::out | std::fstream::app);
   file_.seekp(0);
-  std::string line;
   file_.exceptions(std::fstream::badbit);
-  while (std::getline(file_, line)) {
-    Entry e = inline_json_deserialize<Entry>(line);
-    AddEntry(e.key, e.subkey, e.value);
+  auto entries = Load(&file_);
+  for (const auto& e : entries) {
+    Insert(e, false);
   }
+  LogLegacyEntries(openname, entries);
   file_.clear();
   file_.exceptions(std::fstream::failbit | std::fstream::badbit);
 }
 
+void TileCache::ImportFromEnv() {
+  // A list of files, separated as in PATH, e.g. caches measured on other machines.
+#ifdef _WIN32
+  const char separator = ';';
+#else
+  const char separator = ':';
+#endif
+  std::istringstream imports(env::Get("PLAIDML_TILE_CACHE_IMPORT"));
+  std::string filename;
+  while (std::getline(imports, filename, separator)) {
+    if (filename.empty()) {
+      continue;
+    }
+    try {
+      auto count = Import(filename);
+      LOG(INFO) << "Imported " << count << " tile cache entries from " << filename;
+    } catch (const std::exception& ex) {
+      LOG(WARNING) << "Unable to import tile cache " << filename << ": " << ex.what();
+    }
+  }
+}
+
+void TileCache::ExportToEnv() const {
+  auto filename = env::Get("PLAIDML_TILE_CACHE_EXPORT");
+  if (filename.empty()) {
+    return;
+  }
+  try {
+    Export(filename);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to export tile cache " << filename << ": " << ex.what();
+  }
+}
+
 TileCache* TileCache::Instance() {
   static TileCache instance("", true);
   return &instance;
 }
 
-void TileCache::AddEntry(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size,
-                         int64_t dur) {
+void TileCache::AddEntry(const std::string& hardware, const std::string& key, const DirectSettings& settings,
+                         const std::vector<uint64_t>& tile_size, int64_t dur) {
   Entry e;
   e.key = key;
   e.subkey = Subkey(settings, tile_size);
   e.value = dur;
-  AddEntry(key, e.subkey, dur);
-  if (file_.is_open()) {
+  e.hardware = hardware;
+  std::lock_guard<std::mutex> lock(mu_);
+  Insert(e, false);
+  Store(e);
+}
+
+int64_t TileCache::GetDuration(const std::string& hardware, const std::string& key, const DirectSettings& settings,
+                               const std::vector<uint64_t>& tile_size) {
+  Subkey subkey(settings, tile_size);
+  std::lock_guard<std::mutex> lock(mu_);
+  auto dur = Find(hardware, key, subkey);
+  if (dur < 0 && !hardware.empty()) {
+    // Entries stored before hardware was recorded apply to any hardware
+    // which has not been measured itself.
+    dur = Find("", key, subkey);
+  }
+  return dur;
+}
+
+void TileCache::Merge(const TileCache& other) {
+  if (&other == this) {
+    return;
+  }
+  auto entries = other.Entries();
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto& e : entries) {
+    if (Insert(e, true)) {
+      Store(e);
+    }
+  }
+}
+
+size_t TileCache::Import(const std::string& filename) {
+  std::ifstream in(filename);
+  if (!in) {
+    throw std::runtime_error("Unable to open tile cache " + filename);
+  }
+  auto entries = Load(&in);
+  LogLegacyEntries(filename, entries);
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const auto& e : entries) {
+    if (Insert(e, true)) {
+      Store(e);
+    }
+  }
+  return entries.size();
+}
+
+void TileCache::Export(const std::string& filename) const {
+  std::ofstream out;
+  out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  out.open(filename, std::ofstream::out | std::ofstream::trunc);
+  for (const auto& e : Entries()) {
     std::string row = json_serialize(e);
-    file_.write(row.data(), row.size());
-    file_.flush();
+    out.write(row.data(), row.size());
   }
 }
 
-int64_t TileCache::GetDuration(const std::string& key, const DirectSettings& settings,
-                               const std::vector<uint64_t>& tile_size) {
-  auto it = cache_.find(key);
-  if (it == cache_.end()) {
+size_t TileCache::size() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  size_t count = 0;
+  for (const auto& kvp_hw : cache_) {
+    for (const auto& kvp : kvp_hw.second) {
+      count += kvp.second.times.size();
+    }
+  }
+  return count;
+}
+
+std::vector<TileCache::Entry> TileCache::Load(std::istream* in) {
+  std::vector<Entry> entries;
+  std::string line;
+  while (std::getline(*in, line)) {
+    if (!line.empty()) {
+      entries.emplace_back(inline_json_deserialize<Entry>(line));
+    }
+  }
+  return entries;
+}
+
+void TileCache::LogLegacyEntries(const std::string& filename, const std::vector<Entry>& entries) {
+  auto legacy = std::count_if(entries.begin(), entries.end(), [](const Entry& e) { return e.hardware.empty(); });
+  if (legacy) {
+    LOG(INFO) << "Loaded " << legacy << " tile cache entries without a hardware description from " << filename
+              << "; they are used for hardware without entries of its own";
+  }
+}
+
+std::vector<TileCache::Entry> TileCache::Entries() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  std::vector<Entry> entries;
+  for (const auto& kvp_hw : cache_) {
+    for (const auto& kvp : kvp_hw.second) {
+      for (const auto& kvp_time : kvp.second.times) {
+        entries.emplace_back(Entry{kvp.first, kvp_time.first, kvp_time.second, kvp_hw.first});
+      }
+    }
+  }
+  return entries;
+}
+
+int64_t TileCache::Find(const std::string& hardware, const std::string& key, const Subkey& subkey) const {
+  auto it_hw = cache_.find(hardware);
+  if (it_hw == cache_.end()) {
+    return -1;
+  }
+  auto it = it_hw->second.find(key);
+  if (it == it_hw->second.end()) {
     return -1;
   }
-  auto it2 = it->second.times.find(Subkey(settings, tile_size));
+  auto it2 = it->second.times.find(subkey);
   if (it2 == it->second.times.end()) {
     return -1;
   }
   return it2->second;
 }
 
-void TileCache::AddEntry(const std::string& key, const Subkey& subkey, int64_t dur) {
-  PerFC& p = cache_[key];
-  p.times[subkey] = dur;
-  if (p.times.size() == 1 || p.times[p.best] > dur) {
-    p.best = subkey;
+bool TileCache::Insert(const Entry& e, bool keep_min) {
+  PerFC& p = cache_[e.hardware][e.key];
+  auto inserted = p.times.emplace(e.subkey, e.value);
+  if (!inserted.second) {
+    if (inserted.first->second == e.value || (keep_min && inserted.first->second < e.value)) {
+      return false;
+    }
+    inserted.first->second = e.value;
+  }
+  if (p.times.size() == 1 || p.times[p.best] > e.value) {
+    p.best = e.subkey;
+  }
+  return true;
+}
+
+void TileCache::Store(const Entry& e) {
+  if (file_.is_open()) {
+    std::string row = json_serialize(e);
+    file_.write(row.data(), row.size());
+    file_.flush();
   }
 }
 
@@ -2,9 +2,12 @@
 #pragma once
 
 #include <fstream>
+#include <istream>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/util/transfer_object.h"
@@ -14,17 +17,34 @@ namespace vertexai {
 namespace tile {
 namespace lang {
 
+// TileCache records how long each candidate tiling of a kernel took to run, so
+// that a tile scan need not time the same candidate twice.  Entries are indexed
+// by the hardware they were measured on and by the kernel key.  All methods may
+// be called concurrently.
 class TileCache {
  public:
   // Construct a cache, if given a filename, use that for storage
   explicit TileCache(const std::string& filename = "", bool use_env = false);
-  // Get the 'singlton' instance, loads for PLAIDML_TILE_CACHE if set
+  // Get the 'singlton' instance, loads for PLAIDML_TILE_CACHE if set, and
+  // merges in the files listed in PLAIDML_TILE_CACHE_IMPORT
   static TileCache* Instance();
   // Add a new entry with a duration
-  void AddEntry(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size,
-                int64_t dur);
-  // Checks for an exact matching entry (to skip tile scan for repeats), or -1 if not found
-  int64_t GetDuration(const std::string& key, const DirectSettings& settings, const std::vector<uint64_t>& tile_size);
+  void AddEntry(const std::string& hardware, const std::string& key, const DirectSettings& settings,
+                const std::vector<uint64_t>& tile_size, int64_t dur);
+  // Checks for an exact matching entry (to skip tile scan for repeats), or -1 if not found.
+  // Entries stored without a hardware description match any hardware with no entry of its own.
+  int64_t GetDuration(const std::string& hardware, const std::string& key, const DirectSettings& settings,
+                      const std::vector<uint64_t>& tile_size);
+  // Adds the entries of another cache, keeping the shorter duration where both have one
+  void Merge(const TileCache& other);
+  // Merges in the entries stored in a file, returning how many there were
+  size_t Import(const std::string& filename);
+  // Writes every entry to a file, once each, in the format used for storage
+  void Export(const std::string& filename) const;
+  // Exports to PLAIDML_TILE_CACHE_EXPORT if set, logging rather than throwing on failure
+  void ExportToEnv() const;
+  // The number of entries
+  size_t size() const;
 
  private:
   struct Subkey {
@@ -46,12 +66,14 @@ class TileCache {
     std::string key;
     TileCache::Subkey subkey;
     int64_t value;
+    std::string hardware;  // Empty for entries stored before hardware was recorded
 
     TRANSFER_OBJECT {
-      VERSION(0);
+      VERSION(1);
       FIELD(key);
       FIELD(subkey);
       FIELD(value);
+      FIELD(hardware);
     }
   };
 
@@ -60,9 +82,22 @@ class TileCache {
     std::map<Subkey, int64_t> times;
   };
 
-  void AddEntry(const std::string& key, const Subkey& subkey, int64_t dur);
+  typedef std::unordered_map<std::string, PerFC> PerHardware;
+
+  void Open(const std::string& filename);
+  void ImportFromEnv();
+  static std::vector<Entry> Load(std::istream* in);
+  static void LogLegacyEntries(const std::string& filename, const std::vector<Entry>& entries);
+  std::vector<Entry> Entries() const;
+  // The duration recorded for exactly this hardware, or -1
+  int64_t Find(const std::string& hardware, const std::string& key, const Subkey& subkey) const;
+  // Records an entry, returning whether it changed the cache; keep_min keeps an
+  // existing shorter duration
+  bool Insert(const Entry& e, bool keep_min);
+  void Store(const Entry& e);
 
-  std::map<const std::string, PerFC> cache_;
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, PerHardware> cache_;
 
   std::fstream file_;
 };
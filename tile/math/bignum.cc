@@ -1,13 +1,224 @@
 
 #include "tile/math/bignum.h"
 
+#include <numeric>
+#include <stdexcept>
+
 #include <boost/math/common_factor_rt.hpp>
 
 namespace vertexai {
 namespace tile {
 namespace math {
 
+namespace {
+
+const int64_t kMinSmall = -std::numeric_limits<int64_t>::max();
+const int64_t kMaxSmall = std::numeric_limits<int64_t>::max();
+
+// The checked operations fail when the result overflows or is INT64_MIN,
+// which the small form of Rational excludes.
+bool CheckedAdd(int64_t a, int64_t b, int64_t* result) {
+#if defined(__GNUC__) || defined(__clang__)
+  if (__builtin_add_overflow(a, b, result)) {
+    return false;
+  }
+#else
+  if ((b > 0 && a > kMaxSmall - b) || (b < 0 && a < kMinSmall - b)) {
+    return false;
+  }
+  *result = a + b;
+#endif
+  return *result >= kMinSmall;
+}
+
+bool CheckedMul(int64_t a, int64_t b, int64_t* result) {
+#if defined(__GNUC__) || defined(__clang__)
+  if (__builtin_mul_overflow(a, b, result)) {
+    return false;
+  }
+#else
+  // Both operands are within [-INT64_MAX, INT64_MAX].
+  if (a && b) {
+    auto abs_a = a < 0 ? -a : a;
+    auto abs_b = b < 0 ? -b : b;
+    if (abs_a > kMaxSmall / abs_b) {
+      return false;
+    }
+  }
+  *result = a * b;
+#endif
+  return *result >= kMinSmall;
+}
+
+bool FitsSmall(const Integer& x) { return x >= kMinSmall && x <= kMaxSmall; }
+
+}  // namespace
+
+Rational::Rational(const Integer& value) {
+  if (FitsSmall(value)) {
+    num_ = static_cast<int64_t>(value);
+  } else {
+    assign(BigRational(value));
+  }
+}
+
+Rational::Rational(const Integer& num, const Integer& den) {
+  if (den == 0) {
+    throw std::domain_error("Rational with a zero denominator");
+  }
+  if (FitsSmall(num) && FitsSmall(den)) {
+    auto n = static_cast<int64_t>(num);
+    auto d = static_cast<int64_t>(den);
+    if (d < 0) {
+      n = -n;
+      d = -d;
+    }
+    assign_small(n, d);
+  } else if (den < 0) {
+    assign(BigRational(-num, -den));
+  } else {
+    assign(BigRational(num, den));
+  }
+}
+
+Rational::Rational(const BigRational& value) { assign(value); }
+
+void Rational::assign(const BigRational& value) {
+  const auto& num = boost::multiprecision::numerator(value);
+  const auto& den = boost::multiprecision::denominator(value);
+  if (FitsSmall(num) && den <= kMaxSmall) {
+    num_ = static_cast<int64_t>(num);
+    den_ = static_cast<int64_t>(den);
+    big_.reset();
+  } else {
+    big_ = std::make_shared<const BigRational>(value);
+  }
+}
+
+void Rational::assign_small(int64_t num, int64_t den) {
+  auto gcd = std::gcd(num, den);
+  num_ = num / gcd;
+  den_ = den / gcd;
+  big_.reset();
+}
+
+Integer Rational::numerator() const { return big_ ? boost::multiprecision::numerator(*big_) : Integer(num_); }
+
+Integer Rational::denominator() const { return big_ ? boost::multiprecision::denominator(*big_) : Integer(den_); }
+
+BigRational Rational::big() const { return big_ ? *big_ : BigRational(num_, den_); }
+
+std::string Rational::str() const {
+  if (big_) {
+    return big_->str();
+  }
+  if (den_ == 1) {
+    return std::to_string(num_);
+  }
+  return std::to_string(num_) + "/" + std::to_string(den_);
+}
+
+Rational Rational::operator-() const {
+  Rational result;
+  if (big_) {
+    result.assign(-*big_);
+  } else {
+    result.num_ = -num_;
+    result.den_ = den_;
+  }
+  return result;
+}
+
+Rational& Rational::operator+=(const Rational& rhs) {
+  if (!big_ && !rhs.big_) {
+    if (den_ == 1 && rhs.den_ == 1) {
+      int64_t sum;
+      if (CheckedAdd(num_, rhs.num_, &sum)) {
+        num_ = sum;
+        return *this;
+      }
+    } else {
+      // a/b + c/d = (a*(d/g) + c*(b/g)) / (b*(d/g)), where g = gcd(b, d)
+      auto gcd = std::gcd(den_, rhs.den_);
+      int64_t lhs_num, rhs_num, num, den;
+      if (CheckedMul(num_, rhs.den_ / gcd, &lhs_num) &&  //
+          CheckedMul(rhs.num_, den_ / gcd, &rhs_num) &&  //
+          CheckedAdd(lhs_num, rhs_num, &num) &&          //
+          CheckedMul(den_, rhs.den_ / gcd, &den)) {
+        assign_small(num, den);
+        return *this;
+      }
+    }
+  }
+  assign(big() + rhs.big());
+  return *this;
+}
+
+Rational& Rational::operator-=(const Rational& rhs) { return *this += -rhs; }
+
+Rational& Rational::operator*=(const Rational& rhs) {
+  if (!big_ && !rhs.big_) {
+    if (den_ == 1 && rhs.den_ == 1) {
+      int64_t product;
+      if (CheckedMul(num_, rhs.num_, &product)) {
+        num_ = product;
+        return *this;
+      }
+    } else {
+      if (!num_ || !rhs.num_) {
+        *this = 0;
+        return *this;
+      }
+      // Cancel common factors first, so that the result is already reduced.
+      auto gcd1 = std::gcd(num_, rhs.den_);
+      auto gcd2 = std::gcd(rhs.num_, den_);
+      int64_t num, den;
+      if (CheckedMul(num_ / gcd1, rhs.num_ / gcd2, &num) &&  //
+          CheckedMul(den_ / gcd2, rhs.den_ / gcd1, &den)) {
+        num_ = num;
+        den_ = den;
+        return *this;
+      }
+    }
+  }
+  assign(big() * rhs.big());
+  return *this;
+}
+
+Rational& Rational::operator/=(const Rational& rhs) {
+  if (!rhs) {
+    throw std::domain_error("Rational division by zero");
+  }
+  if (rhs.big_) {
+    assign(big() / rhs.big());
+    return *this;
+  }
+  Rational inverse;
+  inverse.num_ = rhs.num_ < 0 ? -rhs.den_ : rhs.den_;
+  inverse.den_ = rhs.num_ < 0 ? -rhs.num_ : rhs.num_;
+  return *this *= inverse;
+}
+
+int Rational::compare(const Rational& rhs) const {
+  if (!big_ && !rhs.big_) {
+    if (den_ == rhs.den_) {
+      return num_ < rhs.num_ ? -1 : (num_ > rhs.num_ ? 1 : 0);
+    }
+    int64_t lhs_cross, rhs_cross;
+    if (CheckedMul(num_, rhs.den_, &lhs_cross) && CheckedMul(rhs.num_, den_, &rhs_cross)) {
+      return lhs_cross < rhs_cross ? -1 : (lhs_cross > rhs_cross ? 1 : 0);
+    }
+  }
+  auto lhs = big();
+  auto other = rhs.big();
+  return lhs < other ? -1 : (lhs > other ? 1 : 0);
+}
+
 Integer Floor(const Rational& x) {
+  if (!x.big_) {
+    auto quotient = x.num_ / x.den_;
+    return (x.num_ % x.den_ && x.num_ < 0) ? quotient - 1 : quotient;
+  }
   if (x < 0) {
     return (numerator(x) - denominator(x) + 1) / denominator(x);
   } else {
@@ -15,7 +226,13 @@ Integer Floor(const Rational& x) {
   }
 }
 
-Integer Ceil(const Rational& x) { return Floor(Rational(numerator(x) - 1, denominator(x))) + 1; }
+Integer Ceil(const Rational& x) {
+  if (!x.big_) {
+    auto quotient = x.num_ / x.den_;
+    return (x.num_ % x.den_ && x.num_ > 0) ? quotient + 1 : quotient;
+  }
+  return Floor(Rational(numerator(x) - 1, denominator(x))) + 1;
+}
 
 int ToInteger(const Rational& x) {
   if (Floor(x) != Ceil(x)) {
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <type_traits>
 
 #include <boost/multiprecision/cpp_int.hpp>
 
@@ -11,7 +16,111 @@ namespace math {
 typedef boost::multiprecision::cpp_int_backend<> IntegerBackend;
 typedef boost::multiprecision::rational_adaptor<IntegerBackend> RationalBackend;
 typedef boost::multiprecision::number<IntegerBackend, boost::multiprecision::et_off> Integer;
-typedef boost::multiprecision::number<RationalBackend, boost::multiprecision::et_off> Rational;
+typedef boost::multiprecision::number<RationalBackend, boost::multiprecision::et_off> BigRational;
+
+// An exact rational number.  Nearly every value seen by the constraint solver
+// has a numerator and denominator which fit in 64 bits, so a value is kept as a
+// reduced pair of int64s, and an operation falls back to BigRational only when
+// its result would overflow.  A value which fits the small form is always kept
+// in it, so that each value has a single representation.
+class Rational {
+ public:
+  Rational() = default;
+  template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+  Rational(I value);  // NOLINT(runtime/explicit)
+  template <typename I, typename J,
+            typename std::enable_if<std::is_integral<I>::value && std::is_integral<J>::value, int>::type = 0>
+  Rational(I num, J den);
+  Rational(const Integer& value);  // NOLINT(runtime/explicit)
+  Rational(const Integer& num, const Integer& den);
+  explicit Rational(const BigRational& value);
+
+  Integer numerator() const;
+  Integer denominator() const;
+  BigRational big() const;  // The value as a BigRational
+  std::string str() const;
+
+  explicit operator bool() const { return big_ || num_; }
+  template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+  explicit operator T() const;  // Truncates toward zero for integral types
+
+  Rational operator-() const;
+  Rational& operator+=(const Rational& rhs);
+  Rational& operator-=(const Rational& rhs);
+  Rational& operator*=(const Rational& rhs);
+  Rational& operator/=(const Rational& rhs);
+
+  friend Rational operator+(Rational lhs, const Rational& rhs) { return lhs += rhs; }
+  friend Rational operator-(Rational lhs, const Rational& rhs) { return lhs -= rhs; }
+  friend Rational operator*(Rational lhs, const Rational& rhs) { return lhs *= rhs; }
+  friend Rational operator/(Rational lhs, const Rational& rhs) { return lhs /= rhs; }
+
+  friend bool operator==(const Rational& lhs, const Rational& rhs) {
+    if (lhs.big_ || rhs.big_) {
+      return lhs.big_ && rhs.big_ && *lhs.big_ == *rhs.big_;
+    }
+    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+  }
+  friend bool operator!=(const Rational& lhs, const Rational& rhs) { return !(lhs == rhs); }
+  friend bool operator<(const Rational& lhs, const Rational& rhs) { return lhs.compare(rhs) < 0; }
+  friend bool operator>(const Rational& lhs, const Rational& rhs) { return lhs.compare(rhs) > 0; }
+  friend bool operator<=(const Rational& lhs, const Rational& rhs) { return lhs.compare(rhs) <= 0; }
+  friend bool operator>=(const Rational& lhs, const Rational& rhs) { return lhs.compare(rhs) >= 0; }
+
+  // Returns a negative, zero, or positive number as this is less than, equal
+  // to, or greater than rhs.
+  int compare(const Rational& rhs) const;
+
+  friend Integer Floor(const Rational& x);
+  friend Integer Ceil(const Rational& x);
+
+ private:
+  void assign(const BigRational& value);
+  // Sets the value to num / den, where den > 0 and neither is INT64_MIN.
+  void assign_small(int64_t num, int64_t den);
+
+  // Neither field is ever INT64_MIN, so that negation cannot overflow.
+  int64_t num_ = 0;
+  int64_t den_ = 1;  // Always positive
+  // The value, when it does not fit in the fields above.
+  std::shared_ptr<const BigRational> big_;
+};
+
+template <typename I, typename std::enable_if<std::is_integral<I>::value, int>::type>
+Rational::Rational(I value) {
+  if constexpr (std::is_signed<I>::value) {
+    if (static_cast<int64_t>(value) != std::numeric_limits<int64_t>::min()) {
+      num_ = value;
+      return;
+    }
+  } else {
+    if (static_cast<uint64_t>(value) <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+      num_ = static_cast<int64_t>(value);
+      return;
+    }
+  }
+  assign(BigRational(Integer(value)));
+}
+
+template <typename I, typename J,
+          typename std::enable_if<std::is_integral<I>::value && std::is_integral<J>::value, int>::type>
+Rational::Rational(I num, J den) : Rational(Integer(num), Integer(den)) {}
+
+template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type>
+Rational::operator T() const {
+  if (big_) {
+    return big_->template convert_to<T>();
+  }
+  if (std::is_integral<T>::value) {
+    return static_cast<T>(num_ / den_);
+  }
+  return static_cast<T>(num_) / static_cast<T>(den_);
+}
+
+inline Integer numerator(const Rational& x) { return x.numerator(); }
+inline Integer denominator(const Rational& x) { return x.denominator(); }
+
+inline std::ostream& operator<<(std::ostream& os, const Rational& x) { return os << x.str(); }
 
 inline std::string to_string(const Integer& x) { return x.str(); }
 inline std::string to_string(const Rational& x) { return x.str(); }
@@ -1,4 +1,7 @@
 
+#include <limits>
+#include <string>
+
 #include "base/util/catch.h"
 #include "base/util/logging.h"
 #include "tile/math/basis.h"
@@ -42,6 +45,27 @@ TEST_CASE("Reduce", "[lattice]") {
   REQUIRE(Reduce(Rational(13, 4), Rational(1, 5)) == Rational(1, 20));
 }
 
+TEST_CASE("Rational overflow", "[rational]") {
+  const int64_t kMax = std::numeric_limits<int64_t>::max();
+  Rational big = Rational(kMax) + 1;
+  REQUIRE(big.str() == "9223372036854775808");
+  REQUIRE(big > kMax);
+  REQUIRE(big - 1 == kMax);
+  REQUIRE((big - 1).str() == std::to_string(kMax));
+  REQUIRE(Rational(kMax) * kMax / kMax == kMax);
+  REQUIRE(Rational(1, kMax) + Rational(1, kMax - 1) - Rational(1, kMax - 1) == Rational(1, kMax));
+  REQUIRE(Rational(std::numeric_limits<int64_t>::min()) == -big);
+  REQUIRE(Floor(-big / 2) == -(Integer(kMax) + 1) / 2);
+  REQUIRE(Floor(-big / 3) == -(Integer(kMax) + 1) / 3 - 1);
+  REQUIRE(Ceil(-big / 3) == -(Integer(kMax) + 1) / 3);
+  REQUIRE(Rational(6, -4) == Rational(-3, 2));
+  REQUIRE(Rational(6, -4).str() == "-3/2");
+  REQUIRE(Rational(0, -4) == 0);
+  REQUIRE(Rational(1, 3) < Rational(1, 2));
+  REQUIRE(Rational(-kMax, kMax - 1) < -1);
+  REQUIRE(static_cast<int64_t>(Rational(-7, 2)) == -3);
+}
+
 static void ValidateXGCD(const Rational& a, const Rational& b) {
   Integer x, y;
   Rational o = XGCD(a, b, x, y);
@@ -118,6 +142,16 @@ TEST_CASE("Basic Polynomial<Rational> evaluation", "[poly]") {
   REQUIRE(r.eval({{"a0", 5}, {"a1", 9}}) == 33);
 }
 
+TEST_CASE("Polynomial<Rational> arithmetic with itself", "[poly]") {
+  Polynomial<Rational> i("i"), j("j");
+  Polynomial<Rational> p = 3 * i - j + 2;
+  p += p;
+  REQUIRE(to_string(p) == "4 + 6*i - 2*j");
+  p -= p;
+  REQUIRE(to_string(p) == "0");
+  REQUIRE(p.getMap().empty());
+}
+
 TEST_CASE("IntersectParallelConstraintPair", "[poly]") {
   Polynomial<Rational> i("i"), j("j");
   RangeConstraint c1{2 * i + j + 1, 8};
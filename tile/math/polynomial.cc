@@ -146,13 +146,45 @@ std::map<std::string, T>& Polynomial<T>::mutateMap() {
 
 template <typename T>
 Polynomial<T>& Polynomial<T>::operator+=(const Polynomial<T>& rhs) {
+  addTerms(rhs, false);
+  return *this;
+}
+
+template <typename T>
+void Polynomial<T>::addTerms(const Polynomial<T>& rhs, bool negate) {
+  if (&rhs == this) {
+    // The merge below would erase terms of rhs as it walks them.
+    if (negate) {
+      map_.clear();
+    } else {
+      for (auto& kvp : map_) {
+        kvp.second += kvp.second;
+      }
+    }
+    return;
+  }
+  // Both maps are ordered by index, so merge them in a single pass rather than
+  // looking up each term of rhs separately.
+  auto it = map_.begin();
   for (const auto& kvp : rhs.map_) {
-    T new_val = (map_[kvp.first] += kvp.second);
-    if (new_val == 0) {
-      map_.erase(kvp.first);
+    while (it != map_.end() && it->first < kvp.first) {
+      ++it;
+    }
+    if (it != map_.end() && it->first == kvp.first) {
+      if (negate) {
+        it->second -= kvp.second;
+      } else {
+        it->second += kvp.second;
+      }
+      if (it->second == 0) {
+        it = map_.erase(it);
+      } else {
+        ++it;
+      }
+    } else {
+      map_.emplace_hint(it, kvp.first, negate ? -kvp.second : kvp.second);
     }
   }
-  return *this;
 }
 
 template <typename T>
@@ -167,12 +199,17 @@ bool Polynomial<T>::operator<(const Polynomial<T>& rhs) const {
 
 template <typename T>
 Polynomial<T>& Polynomial<T>::operator-=(const Polynomial<T>& rhs) {
-  return *this += -1 * rhs;
+  addTerms(rhs, true);
+  return *this;
 }
 
 template <typename T>
 Polynomial<T> Polynomial<T>::operator-() const {
-  return -1 * (*this);
+  Polynomial<T> result = *this;
+  for (auto& kvp : result.map_) {
+    kvp.second = -kvp.second;
+  }
+  return result;
 }
 
 template <typename T>
@@ -236,12 +273,13 @@ T Polynomial<T>::tryDivide(const Polynomial<T>& p, bool ignoreConst) const {
 
 template <typename T>
 void Polynomial<T>::substitute(const std::string& var, const Polynomial<T>& replacement) {
-  if (map_.count(var) == 0) {
+  auto it = map_.find(var);
+  if (it == map_.end()) {
     // If var isn't in this polynomial, nothing needs to be done
     return;
   }
-  T coeff = safe_at(map_, var);
-  map_.erase(var);
+  T coeff = it->second;
+  map_.erase(it);
   (*this) += coeff * replacement;
 }
 
@@ -299,7 +337,7 @@ T Polynomial<T>::get(const std::string& name) const {
 
 int64_t abs_value(int64_t value) { return std::llabs(value); }
 
-Rational abs_value(Rational value) { return abs(value); }
+Rational abs_value(Rational value) { return Abs(value); }
 
 template <typename T>
 std::string Polynomial<T>::toString() const {
@@ -65,6 +65,9 @@ class Polynomial : boost::additive<Polynomial<T>>,
   std::string toString() const;  // Pretty-print to string
 
  private:
+  // Adds (or subtracts) the terms of rhs
+  void addTerms(const Polynomial& rhs, bool negate);
+
   // Map from index -> coefficient
   // Constant offset is a coefficent of empty string
   std::map<std::string, T> map_;
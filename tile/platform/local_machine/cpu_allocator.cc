@@ -0,0 +1,238 @@
+// Copyright 2020 Intel Corporation.
+
+#include "tile/platform/local_machine/cpu_allocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "base/util/env.h"
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+namespace {
+
+std::size_t GetEnvSize(const std::string& name, std::size_t default_value) {
+  auto value = env::Get(name);
+  if (value.empty()) {
+    return default_value;
+  }
+  return std::stoull(value);
+}
+
+}  // namespace
+
+constexpr std::size_t CpuAllocator::kAlignment;
+constexpr std::size_t CpuAllocator::kLargeSize;
+
+CpuAllocator* CpuAllocator::Instance() {
+  // Buffers may be destroyed during static destruction, so the allocator is
+  // never destroyed.
+  static CpuAllocator* allocator = new CpuAllocator{
+      GetEnvSize("PLAIDML_CPU_POOL_SIZE", std::size_t{1} << 30),
+      env::Get("PLAIDML_CPU_HUGE_PAGES") != "0",
+  };
+  return allocator;
+}
+
+CpuAllocator::CpuAllocator(std::size_t pool_size, bool huge_pages) : pool_size_{pool_size}, huge_pages_{huge_pages} {
+  std::size_t nodes = 0;
+#ifdef __linux__
+  // Each node lists its CPUs as ranges, e.g. "0-3,8-11".
+  for (;; ++nodes) {
+    std::ifstream cpulist{"/sys/devices/system/node/node" + std::to_string(nodes) + "/cpulist"};
+    std::string ranges;
+    if (!std::getline(cpulist, ranges)) {
+      break;
+    }
+    std::stringstream ss{ranges};
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+      if (range.empty()) {
+        continue;
+      }
+      auto dash = range.find('-');
+      std::size_t first = std::stoul(range.substr(0, dash));
+      std::size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+      if (cpu_nodes_.size() <= last) {
+        cpu_nodes_.resize(last + 1);
+      }
+      std::fill(cpu_nodes_.begin() + first, cpu_nodes_.begin() + last + 1, nodes);
+    }
+  }
+#endif
+  if (nodes < 2) {
+    nodes = 1;
+    cpu_nodes_.clear();
+  }
+  pools_.resize(nodes);
+}
+
+CpuAllocator::~CpuAllocator() {
+  for (auto& pool : pools_) {
+    for (auto& kvp : pool) {
+      for (auto data : kvp.second) {
+        SystemFree(data, kvp.first);
+      }
+    }
+  }
+}
+
+std::size_t CpuAllocator::SizeClass(std::size_t size) {
+  if (size <= kAlignment) {
+    return kAlignment;
+  }
+  if (size >= kLargeSize) {
+    return (size + kLargeSize - 1) / kLargeSize * kLargeSize;
+  }
+  // Four classes between consecutive powers of two keep the waste under 25%.
+  std::size_t pow2 = kAlignment;
+  while (pow2 * 2 < size) {
+    pow2 *= 2;
+  }
+  auto step = std::max(kAlignment, pow2 / 4);
+  return (size + step - 1) / step * step;
+}
+
+char* CpuAllocator::Allocate(std::size_t size, bool* zeroed) {
+  auto size_class = SizeClass(size);
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    auto& blocks = pools_[CurrentNode()][size_class];
+    if (blocks.size()) {
+      auto data = blocks.back();
+      blocks.pop_back();
+      pooled_bytes_ -= size_class;
+      *zeroed = false;
+      return data;
+    }
+  }
+  auto data = SystemAllocate(size_class);
+#ifdef _WIN32
+  *zeroed = false;
+#else
+  // Fresh mappings read as zeros.
+  *zeroed = size_class >= kLargeSize;
+#endif
+  return data;
+}
+
+void CpuAllocator::Free(char* data, std::size_t size) {
+  auto size_class = SizeClass(size);
+  auto node = NodeOf(data, size_class);
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    if (pooled_bytes_ + size_class <= pool_size_) {
+      pools_[node][size_class].push_back(data);
+      pooled_bytes_ += size_class;
+      return;
+    }
+  }
+  SystemFree(data, size_class);
+}
+
+std::size_t CpuAllocator::pooled_bytes() {
+  std::lock_guard<std::mutex> lock{mu_};
+  return pooled_bytes_;
+}
+
+char* CpuAllocator::SystemAllocate(std::size_t size) {
+#ifdef _WIN32
+  auto data = static_cast<char*>(_aligned_malloc(size, kAlignment));
+  if (!data) {
+    throw std::bad_alloc{};
+  }
+  return data;
+#else
+  if (size < kLargeSize) {
+    void* data = nullptr;
+    if (posix_memalign(&data, kAlignment, size)) {
+      throw std::bad_alloc{};
+    }
+    return static_cast<char*>(data);
+  }
+  // Over-map by a huge page and trim, so that the whole block is aligned to
+  // huge pages and can be backed by them.
+  auto mapped = mmap(nullptr, size + kLargeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    throw std::bad_alloc{};
+  }
+  auto base = reinterpret_cast<std::uintptr_t>(mapped);
+  auto aligned = (base + kLargeSize - 1) & ~(kLargeSize - 1);
+  if (aligned != base) {
+    munmap(mapped, aligned - base);
+  }
+  if (aligned + size != base + size + kLargeSize) {
+    munmap(reinterpret_cast<void*>(aligned + size), base + kLargeSize - aligned);
+  }
+  auto data = reinterpret_cast<char*>(aligned);
+#ifdef MADV_HUGEPAGE
+  if (huge_pages_) {
+    // This fails harmlessly where huge pages are unavailable.
+    madvise(data, size, MADV_HUGEPAGE);
+  }
+#endif
+  return data;
+#endif
+}
+
+void CpuAllocator::SystemFree(char* data, std::size_t size) {
+#ifdef _WIN32
+  _aligned_free(data);
+#else
+  if (size < kLargeSize) {
+    free(data);
+  } else {
+    munmap(data, size);
+  }
+#endif
+}
+
+std::size_t CpuAllocator::CurrentNode() {
+#ifdef __linux__
+  if (cpu_nodes_.size()) {
+    auto cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_nodes_.size()) {
+      return cpu_nodes_[cpu];
+    }
+  }
+#endif
+  return 0;
+}
+
+std::size_t CpuAllocator::NodeOf(char* data, std::size_t size) {
+#ifdef __linux__
+  // Large blocks are placed by first touch, which may have been on any node.
+  if (cpu_nodes_.size() && size >= kLargeSize) {
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, data, MPOL_F_NODE | MPOL_F_ADDR) == 0 && node >= 0 &&
+        static_cast<std::size_t>(node) < pools_.size()) {
+      return node;
+    }
+  }
+#endif
+  return CurrentNode();
+}
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,67 @@
+// Copyright 2020 Intel Corporation.
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+// CpuAllocator provides the host memory behind CpuBuffers.
+//
+// Every allocation is aligned for the widest vector loads the CPU target
+// emits, and is rounded up to a size class so that freed memory can be kept in
+// a pool and handed out again without returning to the system. Large
+// allocations are mapped directly, optionally backed by transparent huge
+// pages, and are not touched until they are used; the kernel then places each
+// page on the NUMA node of the thread which first writes it. On hosts with
+// several NUMA nodes, the pool is kept per node, and memory is reused on the
+// node where it was placed.
+class CpuAllocator final {
+ public:
+  static constexpr std::size_t kAlignment = 64;
+  // Allocations of at least this size are mapped directly.
+  static constexpr std::size_t kLargeSize = 2 << 20;
+
+  // Returns the process-wide allocator, configured by the
+  // PLAIDML_CPU_POOL_SIZE (in bytes) and PLAIDML_CPU_HUGE_PAGES environment
+  // variables.
+  static CpuAllocator* Instance();
+
+  CpuAllocator(std::size_t pool_size, bool huge_pages);
+  ~CpuAllocator();
+
+  // Allocates at least size bytes. The memory is not cleared; *zeroed is set
+  // if it is known to be zero-filled already.
+  char* Allocate(std::size_t size, bool* zeroed);
+
+  // Returns memory obtained from Allocate(size).
+  void Free(char* data, std::size_t size);
+
+  // The number of bytes currently held by the pool.
+  std::size_t pooled_bytes();
+
+  // Returns the size actually allocated for a request of size bytes.
+  static std::size_t SizeClass(std::size_t size);
+
+ private:
+  char* SystemAllocate(std::size_t size);
+  void SystemFree(char* data, std::size_t size);
+  std::size_t CurrentNode();
+  std::size_t NodeOf(char* data, std::size_t size);
+
+  std::size_t pool_size_;
+  bool huge_pages_;
+  std::vector<std::size_t> cpu_nodes_;  // The NUMA node of each CPU, if there are several nodes
+  std::mutex mu_;
+  std::vector<std::unordered_map<std::size_t, std::vector<char*>>> pools_;  // Per node, by size class
+  std::size_t pooled_bytes_ = 0;
+};
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
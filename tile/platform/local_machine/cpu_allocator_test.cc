@@ -0,0 +1,106 @@
+// Copyright 2020, Intel Corporation.
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "tile/platform/local_machine/cpu_allocator.h"
+#include "tile/platform/local_machine/cpu_buffer.h"
+
+using ::testing::Eq;
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+namespace {
+
+bool IsAligned(const char* data, std::size_t alignment) {  //
+  return reinterpret_cast<std::uintptr_t>(data) % alignment == 0;
+}
+
+TEST(CpuAllocator, RoundsToSizeClasses) {
+  EXPECT_THAT(CpuAllocator::SizeClass(0), Eq(64));
+  EXPECT_THAT(CpuAllocator::SizeClass(64), Eq(64));
+  EXPECT_THAT(CpuAllocator::SizeClass(65), Eq(128));
+  EXPECT_THAT(CpuAllocator::SizeClass(600), Eq(640));
+  EXPECT_THAT(CpuAllocator::SizeClass(1000), Eq(1024));
+  EXPECT_THAT(CpuAllocator::SizeClass(1025), Eq(1280));
+  EXPECT_THAT(CpuAllocator::SizeClass(CpuAllocator::kLargeSize + 1), Eq(2 * CpuAllocator::kLargeSize));
+}
+
+TEST(CpuAllocator, AlignsAllocations) {
+  CpuAllocator allocator{0, true};
+  for (std::size_t size : {1, 100, 4096, 100000, 5 << 20}) {
+    bool zeroed;
+    auto data = allocator.Allocate(size, &zeroed);
+    EXPECT_TRUE(IsAligned(data, CpuAllocator::kAlignment));
+    if (size >= CpuAllocator::kLargeSize) {
+      EXPECT_TRUE(IsAligned(data, CpuAllocator::kLargeSize));
+    }
+    if (zeroed) {
+      EXPECT_TRUE(std::all_of(data, data + size, [](char c) { return c == 0; }));
+    }
+    std::fill(data, data + size, 'x');
+    allocator.Free(data, size);
+  }
+}
+
+TEST(CpuAllocator, ReusesFreedMemory) {
+  CpuAllocator allocator{1 << 20, false};
+  bool zeroed;
+  auto data = allocator.Allocate(1000, &zeroed);
+  allocator.Free(data, 1000);
+  EXPECT_THAT(allocator.pooled_bytes(), Eq(1024));
+  // Any request in the same size class gets the same memory back.
+  EXPECT_THAT(allocator.Allocate(1020, &zeroed), Eq(data));
+  EXPECT_FALSE(zeroed);
+  EXPECT_THAT(allocator.pooled_bytes(), Eq(0));
+  allocator.Free(data, 1020);
+}
+
+TEST(CpuAllocator, BoundsPool) {
+  CpuAllocator allocator{1024, false};
+  bool zeroed;
+  auto first = allocator.Allocate(1024, &zeroed);
+  auto second = allocator.Allocate(1024, &zeroed);
+  allocator.Free(first, 1024);
+  allocator.Free(second, 1024);
+  EXPECT_THAT(allocator.pooled_bytes(), Eq(1024));
+}
+
+TEST(CpuBuffer, ReadsAsZeros) {
+  context::Context ctx;
+  for (std::size_t size : {100, 3 << 20}) {
+    for (int i = 0; i < 2; i++) {
+      // The second buffer reuses the storage dirtied by the first.
+      auto buffer = std::make_shared<CpuBuffer>(size);
+      EXPECT_TRUE(IsAligned(buffer->data(), CpuAllocator::kAlignment));
+      auto view = buffer->MapCurrent(ctx).get();
+      EXPECT_TRUE(std::all_of(view->begin(), view->end(), [](char c) { return c == 0; }));
+      std::fill(view->begin(), view->end(), 'x');
+    }
+  }
+}
+
+TEST(CpuBuffer, ClonesWrittenContents) {
+  context::Context ctx;
+  {
+    auto buffer = std::make_shared<CpuBuffer>(100);
+    auto view = buffer->MapDiscard(ctx);
+    std::fill(view->begin(), view->end(), 'x');
+  }
+  auto buffer = std::make_shared<CpuBuffer>(100);
+  auto view = buffer->MapDiscard(ctx);
+  EXPECT_THAT(view->size(), Eq(100));
+  std::fill(view->begin(), view->end(), 'y');
+  view.reset();
+  auto clone = buffer->Clone();
+  auto clone_view = clone->MapCurrent(ctx).get();
+  EXPECT_TRUE(std::all_of(clone_view->begin(), clone_view->end(), [](char c) { return c == 'y'; }));
+}
+
+}  // namespace
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
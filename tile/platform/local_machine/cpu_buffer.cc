@@ -0,0 +1,160 @@
+// Copyright 2019 Intel Corporation.
+
+#include "tile/platform/local_machine/cpu_buffer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "tile/platform/local_machine/cpu_allocator.h"
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+namespace {
+
+class CpuView final : public View {
+ public:
+  CpuView(std::shared_ptr<CpuBuffer> buffer, char* data, std::size_t size)
+      : View(data, size), buffer_{std::move(buffer)} {}
+  void WriteBack(const context::Context& ctx) final {}
+
+ private:
+  std::shared_ptr<CpuBuffer> buffer_;
+};
+
+bool IsComplete(const std::shared_ptr<hal::Event>& event) { return event->GetFuture().is_ready(); }
+
+void Wait(const std::vector<std::shared_ptr<hal::Event>>& events) {
+  for (const auto& event : events) {
+    // Rethrows the exception of a failed operation, surfacing it to the caller.
+    event->GetFuture().get();
+  }
+}
+
+}  // namespace
+
+CpuBuffer::CpuBuffer(std::uint64_t size) : size_{size} {
+  bool zeroed;
+  data_ = CpuAllocator::Instance()->Allocate(size, &zeroed);
+  clear_pending_ = !zeroed;
+  release_ = [data = data_, size] { CpuAllocator::Instance()->Free(data, size); };
+}
+
+CpuBuffer::CpuBuffer(const std::vector<char>& data) : CpuBuffer(data.size()) {
+  std::copy(data.begin(), data.end(), data_);
+  clear_pending_ = false;
+}
+
+CpuBuffer::CpuBuffer(char* data, std::uint64_t size, std::function<void()> release)
+    : data_{data}, size_{size}, release_{std::move(release)} {}
+
+CpuBuffer::~CpuBuffer() {
+  if (!release_) {
+    return;
+  }
+  // The memory may be freed or reused as soon as it is released, so wait for
+  // the invocations still using it; their failures are reported elsewhere.
+  for (const auto& event : readers_) {
+    event->GetFuture().wait();
+  }
+  for (const auto& event : writers_) {
+    event->GetFuture().wait();
+  }
+  release_();
+}
+
+boost::future<std::unique_ptr<View>> CpuBuffer::MapCurrent(const context::Context& ctx) {
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  GetReadDependencies(&deps);
+  Wait(deps);
+  PrepareRead();
+  std::unique_ptr<View> view = std::make_unique<CpuView>(shared_from_this(), data_, size_);
+  return boost::make_ready_future(std::move(view));
+}
+
+std::unique_ptr<View> CpuBuffer::MapDiscard(const context::Context& ctx) {
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  GetWriteDependencies(&deps);
+  Wait(deps);
+  PrepareWrite();
+  return std::make_unique<CpuView>(shared_from_this(), data_, size_);
+}
+
+BufferPtr CpuBuffer::Clone() {
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  GetReadDependencies(&deps);
+  Wait(deps);
+  auto clone = std::make_shared<CpuBuffer>(size_);
+  std::lock_guard<std::mutex> lock{mu_};
+  if (!clear_pending_) {
+    std::copy(data_, data_ + size_, clone->data_);
+    clone->clear_pending_ = false;
+  }
+  return clone;
+}
+
+void CpuBuffer::PrepareRead() {
+  std::lock_guard<std::mutex> lock{mu_};
+  if (clear_pending_) {
+    std::fill(data_, data_ + size_, '\0');
+    clear_pending_ = false;
+  }
+}
+
+void CpuBuffer::PrepareWrite() {
+  std::lock_guard<std::mutex> lock{mu_};
+  clear_pending_ = false;
+}
+
+void CpuBuffer::GetReadDependencies(std::vector<std::shared_ptr<hal::Event>>* deps) {
+  std::lock_guard<std::mutex> lock{mu_};
+  Prune();
+  deps->insert(deps->end(), writers_.begin(), writers_.end());
+}
+
+void CpuBuffer::GetWriteDependencies(std::vector<std::shared_ptr<hal::Event>>* deps) {
+  std::lock_guard<std::mutex> lock{mu_};
+  Prune();
+  deps->insert(deps->end(), readers_.begin(), readers_.end());
+  deps->insert(deps->end(), writers_.begin(), writers_.end());
+}
+
+void CpuBuffer::Acquire(std::shared_ptr<hal::Event> event, bool is_write,
+                        std::vector<std::shared_ptr<hal::Event>>* deps) {
+  std::lock_guard<std::mutex> lock{mu_};
+  Prune();
+  auto add_deps = [&](const std::vector<std::shared_ptr<hal::Event>>& events) {
+    std::copy_if(events.begin(), events.end(), std::back_inserter(*deps),
+                 [&](const std::shared_ptr<hal::Event>& dep) { return dep != event; });
+  };
+  add_deps(writers_);
+  if (!is_write) {
+    readers_.emplace_back(std::move(event));
+    return;
+  }
+  add_deps(readers_);
+  // A new writer is ordered after every pending reader and writer, so it
+  // subsumes them as a dependency for later operations. Completed writers are
+  // kept only until pruned, so that a failure can still be observed.
+  readers_.clear();
+  writers_.clear();
+  writers_.emplace_back(std::move(event));
+}
+
+void CpuBuffer::Prune() {
+  readers_.erase(std::remove_if(readers_.begin(), readers_.end(), IsComplete), readers_.end());
+  // Keep the last writer if it failed, so that its exception keeps propagating
+  // to readers until the buffer is overwritten.
+  writers_.erase(std::remove_if(writers_.begin(), writers_.end(),
+                                [](const std::shared_ptr<hal::Event>& event) {
+                                  auto future = event->GetFuture();
+                                  return future.is_ready() && !future.has_exception();
+                                }),
+                 writers_.end());
+}
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,108 @@
+// Copyright 2019 Intel Corporation.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tile/base/buffer.h"
+#include "tile/base/hal.h"
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+// The result of a completed CPU program invocation.
+class CpuResult final : public hal::Result {
+ public:
+  explicit CpuResult(std::chrono::high_resolution_clock::duration duration) : duration_{duration} {}
+
+  std::chrono::high_resolution_clock::duration GetDuration() const final { return duration_; }
+  void LogStatistics() const final {}
+
+ private:
+  std::chrono::high_resolution_clock::duration duration_;
+};
+
+// A synchronization event tracking a CPU program invocation.
+class CpuEvent final : public hal::Event {
+ public:
+  explicit CpuEvent(boost::shared_future<std::shared_ptr<hal::Result>> future) : future_{std::move(future)} {}
+
+  boost::shared_future<std::shared_ptr<hal::Result>> GetFuture() final { return future_; }
+
+ private:
+  boost::shared_future<std::shared_ptr<hal::Result>> future_;
+};
+
+// A host memory buffer for the CPU device.
+//
+// CPU programs may run asynchronously, so each buffer records the events of
+// the invocations currently reading or writing it. Mapping the buffer waits
+// for any pending writers (and, when discarding the contents, any pending
+// readers); programs use the same events to order their invocations.
+//
+// A buffer's own storage comes from the CpuAllocator. Its contents read as
+// zeros until first written; the storage is only cleared if it is read before
+// then, so buffers which are written first (e.g. program outputs, or buffers
+// mapped with MapDiscard) never pay for it.
+//
+// A buffer may also wrap memory owned by the caller (e.g. a framework's
+// tensor), which programs then read and write in place.
+class CpuBuffer final : public tile::Buffer, public std::enable_shared_from_this<CpuBuffer> {
+ public:
+  explicit CpuBuffer(std::uint64_t size);
+  explicit CpuBuffer(const std::vector<char>& data);
+
+  // Wraps `size` bytes of caller-owned memory at `data`.  Once the buffer is
+  // destroyed and every pending operation on it has completed, `release` (if
+  // set) is called to return the memory to its owner.
+  CpuBuffer(char* data, std::uint64_t size, std::function<void()> release);
+
+  ~CpuBuffer();
+
+  // Buffer implementation.
+  boost::future<std::unique_ptr<View>> MapCurrent(const context::Context& ctx) final;
+  std::unique_ptr<View> MapDiscard(const context::Context& ctx) final;
+  std::uint64_t size() const final { return size_; }
+  BufferPtr Clone() final;
+
+  // The base address of the buffer's storage; this never changes.
+  char* data() { return data_; }
+
+  // Prepares the storage to be read, clearing it if it has never been written.
+  void PrepareRead();
+
+  // Notes that the whole buffer is about to be written.
+  void PrepareWrite();
+
+  // Adds the events which must complete before the buffer may be read.
+  void GetReadDependencies(std::vector<std::shared_ptr<hal::Event>>* deps);
+
+  // Adds the events which must complete before the buffer may be written.
+  void GetWriteDependencies(std::vector<std::shared_ptr<hal::Event>>* deps);
+
+  // Records an operation which will read (or write) the buffer, adding the
+  // events it must wait for to deps. Both happen under the buffer's lock, so
+  // concurrent operations are always ordered one after the other. An event
+  // acquiring the buffer for both reading and writing never waits on itself.
+  void Acquire(std::shared_ptr<hal::Event> event, bool is_write, std::vector<std::shared_ptr<hal::Event>>* deps);
+
+ private:
+  void Prune();
+
+  char* data_;
+  std::uint64_t size_;
+  std::function<void()> release_;
+  std::mutex mu_;
+  bool clear_pending_ = false;
+  std::vector<std::shared_ptr<hal::Event>> readers_;
+  std::vector<std::shared_ptr<hal::Event>> writers_;
+};
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
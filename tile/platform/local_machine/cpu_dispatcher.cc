@@ -0,0 +1,116 @@
+// Copyright 2019 Intel Corporation.
+
+#include "tile/platform/local_machine/cpu_dispatcher.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
+
+#include "base/util/env.h"
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+namespace {
+
+std::size_t GetEnvSize(const std::string& name, std::size_t default_value) {
+  auto value = env::Get(name);
+  if (value.empty()) {
+    return default_value;
+  }
+  return std::max<std::size_t>(1, std::stoull(value));
+}
+
+}  // namespace
+
+CpuDispatcher* CpuDispatcher::Instance() {
+  // The compiled kernels parallelize internally, so a few dispatch threads are
+  // enough to overlap independent invocations without oversubscribing cores.
+  static CpuDispatcher dispatcher{
+      GetEnvSize("PLAIDML_CPU_DISPATCH_THREADS", std::min(std::max(1u, std::thread::hardware_concurrency()), 4u)),
+      GetEnvSize("PLAIDML_CPU_DISPATCH_DEPTH", 64),
+  };
+  return &dispatcher;
+}
+
+CpuDispatcher::CpuDispatcher(std::size_t threads, std::size_t max_in_flight) : max_in_flight_{max_in_flight} {
+  for (std::size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this] { Work(); });
+  }
+}
+
+CpuDispatcher::~CpuDispatcher() {
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void CpuDispatcher::Schedule(const std::vector<std::shared_ptr<hal::Event>>& deps, std::function<void()> fn) {
+  {
+    std::unique_lock<std::mutex> lock{mu_};
+    space_cv_.wait(lock, [this] { return in_flight_ < max_in_flight_; });
+    ++in_flight_;
+  }
+  if (deps.empty()) {
+    Enqueue(std::move(fn));
+    return;
+  }
+  // Count down the outstanding dependencies; the continuation of the last one
+  // to complete enqueues the job. The continuations run synchronously on the
+  // completing thread, so no threads are spawned to wait on dependencies.
+  struct Pending {
+    std::atomic<std::size_t> remaining;
+    std::function<void()> fn;
+  };
+  auto pending = std::make_shared<Pending>();
+  pending->remaining = deps.size();
+  pending->fn = std::move(fn);
+  for (const auto& dep : deps) {
+    dep->GetFuture().then(boost::launch::sync,
+                          [this, pending](const boost::shared_future<std::shared_ptr<hal::Result>>&) {
+                            if (--pending->remaining == 0) {
+                              Enqueue(std::move(pending->fn));
+                            }
+                          });
+  }
+}
+
+void CpuDispatcher::Enqueue(std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    queue_.emplace_back(std::move(fn));
+  }
+  work_cv_.notify_one();
+}
+
+void CpuDispatcher::Work() {
+  for (;;) {
+    std::function<void()> fn;
+    {
+      std::unique_lock<std::mutex> lock{mu_};
+      work_cv_.wait(lock, [this] { return shutdown_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      fn = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    fn();
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      --in_flight_;
+    }
+    space_cv_.notify_one();
+  }
+}
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
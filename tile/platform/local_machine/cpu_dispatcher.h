@@ -0,0 +1,56 @@
+// Copyright 2019 Intel Corporation.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tile/base/hal.h"
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+
+// CpuDispatcher runs CPU program invocations on a small fixed pool of threads.
+//
+// Jobs are queued once all of their dependencies have completed, and run in
+// the order in which they became ready. The number of outstanding jobs is
+// bounded: Schedule blocks the caller while the limit is reached, which
+// applies backpressure to callers that issue work faster than it completes.
+class CpuDispatcher final {
+ public:
+  // Returns the process-wide dispatcher, configured by the
+  // PLAIDML_CPU_DISPATCH_THREADS and PLAIDML_CPU_DISPATCH_DEPTH environment
+  // variables.
+  static CpuDispatcher* Instance();
+
+  CpuDispatcher(std::size_t threads, std::size_t max_in_flight);
+  ~CpuDispatcher();
+
+  // Runs fn on a dispatcher thread after every event in deps has completed
+  // (successfully or not; the job is responsible for checking).
+  void Schedule(const std::vector<std::shared_ptr<hal::Event>>& deps, std::function<void()> fn);
+
+ private:
+  void Enqueue(std::function<void()> fn);
+  void Work();
+
+  std::size_t max_in_flight_;
+  std::mutex mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable space_cv_;
+  std::deque<std::function<void()>> queue_;
+  std::size_t in_flight_ = 0;
+  bool shutdown_ = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,151 @@
+// Copyright 2019, Intel Corporation.
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "tile/platform/local_machine/cpu_buffer.h"
+#include "tile/platform/local_machine/cpu_dispatcher.h"
+
+using ::testing::Eq;
+using ::testing::Ge;
+
+namespace vertexai {
+namespace tile {
+namespace local_machine {
+namespace {
+
+std::shared_ptr<hal::Result> MakeResult() {
+  return std::make_shared<CpuResult>(std::chrono::high_resolution_clock::duration::zero());
+}
+
+TEST(CpuDispatcher, RunsAfterDependencies) {
+  CpuDispatcher dispatcher{1, 8};
+  boost::promise<std::shared_ptr<hal::Result>> dep_prom;
+  auto dep = std::make_shared<CpuEvent>(dep_prom.get_future().share());
+  std::atomic<bool> ran{false};
+  boost::promise<void> done;
+  dispatcher.Schedule({dep}, [&] {
+    ran = true;
+    done.set_value();
+  });
+  // The single thread runs ready jobs in order, so once a job scheduled later
+  // has run, the first would have too had it not been waiting.
+  boost::promise<void> later;
+  dispatcher.Schedule({}, [&] { later.set_value(); });
+  later.get_future().get();
+  EXPECT_FALSE(ran);
+  dep_prom.set_value(MakeResult());
+  done.get_future().get();
+  EXPECT_TRUE(ran);
+}
+
+TEST(CpuDispatcher, BoundsInFlightJobs) {
+  CpuDispatcher dispatcher{1, 2};
+  boost::promise<std::shared_ptr<hal::Result>> gate_prom;
+  auto gate = std::make_shared<CpuEvent>(gate_prom.get_future().share());
+  std::atomic<int> count{0};
+  dispatcher.Schedule({gate}, [&] { ++count; });
+  dispatcher.Schedule({gate}, [&] { ++count; });
+  // The third job may only be scheduled once one of the gated jobs has run.
+  boost::promise<void> scheduling;
+  int count_when_scheduled = -1;
+  std::thread producer{[&] {
+    scheduling.set_value();
+    dispatcher.Schedule({}, [&] { ++count; });
+    count_when_scheduled = count;
+  }};
+  scheduling.get_future().get();
+  gate_prom.set_value(MakeResult());
+  producer.join();
+  EXPECT_THAT(count_when_scheduled, Ge(1));
+}
+
+TEST(CpuBuffer, OrdersWritersAfterReaders) {
+  auto buffer = std::make_shared<CpuBuffer>(16);
+  boost::promise<std::shared_ptr<hal::Result>> read_prom;
+  auto read = std::make_shared<CpuEvent>(read_prom.get_future().share());
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  buffer->Acquire(read, false, &deps);
+  EXPECT_THAT(deps.size(), Eq(0));
+
+  buffer->GetReadDependencies(&deps);
+  EXPECT_THAT(deps.size(), Eq(0));
+  buffer->GetWriteDependencies(&deps);
+  EXPECT_THAT(deps.size(), Eq(1));
+
+  read_prom.set_value(MakeResult());
+  deps.clear();
+  buffer->GetWriteDependencies(&deps);
+  EXPECT_THAT(deps.size(), Eq(0));
+}
+
+TEST(CpuBuffer, OrdersConcurrentWriters) {
+  auto buffer = std::make_shared<CpuBuffer>(16);
+  boost::promise<std::shared_ptr<hal::Result>> first_prom;
+  auto first = std::make_shared<CpuEvent>(first_prom.get_future().share());
+  boost::promise<std::shared_ptr<hal::Result>> second_prom;
+  auto second = std::make_shared<CpuEvent>(second_prom.get_future().share());
+
+  std::vector<std::shared_ptr<hal::Event>> first_deps;
+  buffer->Acquire(first, true, &first_deps);
+  EXPECT_THAT(first_deps.size(), Eq(0));
+  std::vector<std::shared_ptr<hal::Event>> second_deps;
+  buffer->Acquire(second, true, &second_deps);
+  ASSERT_THAT(second_deps.size(), Eq(1));
+  EXPECT_THAT(second_deps[0], Eq(first));
+
+  first_prom.set_value(MakeResult());
+  second_prom.set_value(MakeResult());
+}
+
+TEST(CpuBuffer, DoesNotWaitOnItself) {
+  // An invocation reading and writing the same buffer.
+  auto buffer = std::make_shared<CpuBuffer>(16);
+  boost::promise<std::shared_ptr<hal::Result>> prom;
+  auto event = std::make_shared<CpuEvent>(prom.get_future().share());
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  buffer->Acquire(event, false, &deps);
+  buffer->Acquire(event, true, &deps);
+  EXPECT_THAT(deps.size(), Eq(0));
+  prom.set_value(MakeResult());
+}
+
+TEST(CpuBuffer, PropagatesWriterFailures) {
+  auto buffer = std::make_shared<CpuBuffer>(16);
+  boost::promise<std::shared_ptr<hal::Result>> write_prom;
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  buffer->Acquire(std::make_shared<CpuEvent>(write_prom.get_future().share()), true, &deps);
+  write_prom.set_exception(std::runtime_error("failed"));
+  context::Context ctx;
+  EXPECT_THROW(buffer->MapCurrent(ctx), std::runtime_error);
+}
+
+TEST(CpuBuffer, WrapsHostMemory) {
+  std::vector<char> memory(16, 'x');
+  std::atomic<bool> released{false};
+  auto buffer = std::make_shared<CpuBuffer>(memory.data(), memory.size(), [&] { released = true; });
+  EXPECT_THAT(buffer->data(), Eq(memory.data()));
+  EXPECT_THAT(buffer->size(), Eq(memory.size()));
+
+  // The memory is released only once pending operations have completed.
+  boost::promise<std::shared_ptr<hal::Result>> write_prom;
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  buffer->Acquire(std::make_shared<CpuEvent>(write_prom.get_future().share()), true, &deps);
+  boost::promise<void> destroying;
+  std::thread destroyer{[buffer = std::move(buffer), &destroying]() mutable {
+    destroying.set_value();
+    buffer.reset();
+  }};
+  destroying.get_future().get();
+  EXPECT_FALSE(released);
+  write_prom.set_value(MakeResult());
+  destroyer.join();
+  EXPECT_TRUE(released);
+}
+
+}  // namespace
+}  // namespace local_machine
+}  // namespace tile
+}  // namespace vertexai
@@ -2,11 +2,20 @@
 
 #include "tile/platform/local_machine/cpu_program.h"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "base/util/env.h"
 #include "tile/codegen/driver.h"
 #include "tile/lang/gen_stripe.h"
+#include "tile/platform/local_machine/cpu_buffer.h"
+#include "tile/platform/local_machine/cpu_dispatcher.h"
 #include "tile/targets/cpu/jit.h"
 #include "tile/targets/targets.h"
 
@@ -14,11 +23,47 @@ namespace vertexai {
 namespace tile {
 namespace local_machine {
 
+namespace {
+
+// Reads a count from an environment variable, falling back to the default
+// (with a warning) if the variable is malformed.
+std::uint64_t GetEnvSize(const std::string& name, std::uint64_t default_value) {
+  auto value = env::Get(name);
+  if (value.empty()) {
+    return default_value;
+  }
+  if (value.find_first_not_of("0123456789") == std::string::npos) {
+    try {
+      return std::stoull(value);
+    } catch (const std::out_of_range&) {
+    }
+  }
+  LOG(WARNING) << "Ignoring invalid " << name << "=" << value << "; using " << default_value;
+  return default_value;
+}
+
+targets::cpu::Config MakeConfig() {
+  targets::cpu::Config config;
+  // Allow the code generation target to be pinned, e.g. to reproduce code
+  // generated on another machine. By default the JIT targets the host.
+  config.target_cpu = env::Get("PLAIDML_CPU_TARGET");
+  config.target_features = env::Get("PLAIDML_CPU_FEATURES");
+  // Persist compiled object code across processes to reduce cold start time.
+  config.cache_dir = env::Get("PLAIDML_CPU_CACHE_DIR");
+  config.cache_max_bytes = GetEnvSize("PLAIDML_CPU_CACHE_SIZE", config.cache_max_bytes);
+  // Bound the threads which compile kernels in parallel; 1 compiles serially.
+  config.compile_threads = std::min<std::uint64_t>(
+      GetEnvSize("PLAIDML_CPU_COMPILE_THREADS", config.compile_threads), std::numeric_limits<unsigned>::max());
+  return config;
+}
+
+}  // namespace
+
 CpuProgram::CpuProgram(            //
     const std::string& target,     //
     const lang::RunInfo& runinfo,  //
     ConstBufferManager* const_bufs)
-    : executable_{new targets::cpu::Native} {
+    : executable_{std::make_shared<targets::cpu::Native>()}, profile_path_{env::Get("PLAIDML_CPU_PROFILE")} {
   auto stripe = GenerateStripe(runinfo);
   auto out_dir = boost::filesystem::path(env::Get("PLAIDML_STRIPE_OUTPUT"));
   codegen::OptimizeOptions options = {
@@ -33,8 +78,8 @@ CpuProgram::CpuProgram(            //
   codegen::CompilerState state(stripe);
   state.const_bufs = const_bufs;
   codegen::Optimize(&state, stage.passes(), options);
-  targets::cpu::Config config;
-  if (!env::Get("PLAIDML_CPU_PROFILE").empty()) {
+  auto config = MakeConfig();
+  if (!profile_path_.empty()) {
     config.profile_block_execution = true;
     source_ = stripe->entry;
   }
@@ -45,7 +90,7 @@ CpuProgram::CpuProgram(                              //
     const std::string& target,                       //
     const std::shared_ptr<stripe::Program>& stripe,  //
     ConstBufferManager* const_bufs)
-    : executable_{new targets::cpu::Native} {
+    : executable_{std::make_shared<targets::cpu::Native>()}, profile_path_{env::Get("PLAIDML_CPU_PROFILE")} {
   auto out_dir = boost::filesystem::path(env::Get("PLAIDML_STRIPE_OUTPUT"));
   codegen::OptimizeOptions options = {
       !out_dir.empty(),    // dump_passes
@@ -59,8 +104,8 @@ CpuProgram::CpuProgram(                              //
   codegen::CompilerState state(stripe);
   state.const_bufs = const_bufs;
   codegen::Optimize(&state, stage.passes(), options);
-  targets::cpu::Config config;
-  if (!env::Get("PLAIDML_CPU_PROFILE").empty()) {
+  auto config = MakeConfig();
+  if (!profile_path_.empty()) {
     config.profile_block_execution = true;
     source_ = CloneBlock(*stripe->entry);
   }
@@ -73,37 +118,119 @@ boost::future<void> CpuProgram::Run(  //
     const context::Context& ctx,      //
     std::map<std::string, std::shared_ptr<tile::Buffer>> inputs,
     std::map<std::string, std::shared_ptr<tile::Buffer>> outputs) {
-  std::map<std::string, void*> buffers;
-  // map in the input buffers, preserving contents
-  for (auto& kvp : inputs) {
-    IVLOG(2, "Input: " << kvp.first);
-    auto view = kvp.second->MapCurrent(ctx).get();
-    buffers.emplace(kvp.first, view->data());
-  }
-  // map in output buffers, discarding contents
-  for (auto& kvp : outputs) {
-    IVLOG(2, "Output: " << kvp.first);
-    // don't overwrite the buffer if it's already been mapped in
-    if (buffers.find(kvp.first) == buffers.end()) {
-      auto view = kvp.second->MapDiscard(ctx);
-      buffers.emplace(kvp.first, view->data());
+  // Bind each buffer directly to its parameter slot. CPU buffers are bound by
+  // address and ordered by their pending accesses; other buffers are mapped.
+  const auto& params = executable_->parameters();
+  std::vector<void*> args(params.size());
+  std::vector<std::shared_ptr<CpuBuffer>> readers;
+  std::vector<std::shared_ptr<CpuBuffer>> writers;
+  std::vector<std::shared_ptr<View>> views;
+  for (size_t i = 0; i < params.size(); ++i) {
+    auto it = inputs.find(params[i]);
+    if (it != inputs.end()) {
+      IVLOG(2, "Input: " << it->first);
+      auto buffer = std::dynamic_pointer_cast<CpuBuffer>(it->second);
+      if (buffer) {
+        buffer->PrepareRead();
+        readers.emplace_back(buffer);
+        args[i] = buffer->data();
+      } else {
+        // map in the input buffers, preserving contents
+        views.emplace_back(it->second->MapCurrent(ctx).get());
+        args[i] = views.back()->data();
+      }
+      continue;
+    }
+    it = outputs.find(params[i]);
+    if (it != outputs.end()) {
+      IVLOG(2, "Output: " << it->first);
+      auto buffer = std::dynamic_pointer_cast<CpuBuffer>(it->second);
+      if (buffer) {
+        // Programs write every element of their outputs.
+        buffer->PrepareWrite();
+        writers.emplace_back(buffer);
+        args[i] = buffer->data();
+      } else {
+        // map in output buffers, discarding contents
+        views.emplace_back(it->second->MapDiscard(ctx));
+        args[i] = views.back()->data();
+      }
+      continue;
     }
+    throw std::runtime_error("No buffer provided for program parameter: " + params[i]);
   }
-  executable_->run(buffers);
-  std::string profile_var = env::Get("PLAIDML_CPU_PROFILE");
-  if (!profile_var.empty()) {
+
+  if (!profile_path_.empty()) {
+    // Profiling annotates the shared source block, so run synchronously.
+    std::vector<std::shared_ptr<hal::Event>> deps;
+    for (const auto& buffer : readers) {
+      buffer->GetReadDependencies(&deps);
+    }
+    for (const auto& buffer : writers) {
+      buffer->GetWriteDependencies(&deps);
+    }
+    for (const auto& dep : deps) {
+      dep->GetFuture().get();
+    }
+    executable_->invoke(args.data());
     // copy profile measurements into the saved stripe block
     executable_->set_perf_attrs(source_.get());
     // generate a unique file name for this run
     static unsigned run_counter;
     std::string suffix = "00000" + std::to_string(run_counter++);
     suffix = suffix.substr(suffix.size() - 6);
-    auto path = boost::filesystem::path(profile_var + "." + suffix);
+    auto path = boost::filesystem::path(profile_path_ + "." + suffix);
     // dump annotated stripe block contents to disk
     std::ofstream fout(path.string());
     fout << *source_ << std::endl;
+    return boost::make_ready_future();
   }
-  return boost::make_ready_future();
+
+  // Register the invocation with its buffers before it is queued, so that
+  // subsequent operations on those buffers are ordered after it. Invocations
+  // register with all of their buffers as one step: were two of them to
+  // interleave, each could end up waiting on the other through different
+  // buffers.
+  auto promise = std::make_shared<boost::promise<std::shared_ptr<hal::Result>>>();
+  auto event = std::make_shared<CpuEvent>(promise->get_future().share());
+  std::vector<std::shared_ptr<hal::Event>> deps;
+  {
+    static std::mutex registration_mu;
+    std::lock_guard<std::mutex> lock{registration_mu};
+    for (const auto& buffer : readers) {
+      buffer->Acquire(event, false, &deps);
+    }
+    for (const auto& buffer : writers) {
+      buffer->Acquire(event, true, &deps);
+    }
+  }
+
+  // The arguments are raw addresses, so the invocation holds every bound
+  // buffer until it has run, even if the caller releases them first.
+  std::vector<std::shared_ptr<CpuBuffer>> buffers{readers};
+  buffers.insert(buffers.end(), writers.begin(), writers.end());
+  CpuDispatcher::Instance()->Schedule(
+      deps, [executable = executable_, args = std::move(args), buffers = std::move(buffers), deps,
+             views = std::move(views), promise]() {
+        try {
+          // Propagate the failure of any operation this invocation depends on.
+          for (const auto& dep : deps) {
+            dep->GetFuture().get();
+          }
+          auto start = std::chrono::high_resolution_clock::now();
+          executable->invoke(args.data());
+          auto duration = std::chrono::high_resolution_clock::now() - start;
+          promise->set_value(std::make_shared<CpuResult>(duration));
+        } catch (...) {
+          try {
+            promise->set_exception(boost::current_exception());
+          } catch (...) {
+          }  // set_exception() may throw too
+        }
+      });
+
+  return event->GetFuture().then(boost::launch::sync,
+                                 [](const boost::shared_future<std::shared_ptr<hal::Result>>& fut) { fut.get(); });
 }
 
 void CpuProgram::Release() {}
@@ -49,8 +49,9 @@ class CpuProgram final : public tile::Program {
   void Release() final;
 
  private:
-  std::unique_ptr<tile::targets::cpu::Native> executable_;
+  std::shared_ptr<tile::targets::cpu::Native> executable_;
   std::shared_ptr<stripe::Block> source_;
+  std::string profile_path_;
 };
 
 }  // namespace local_machine
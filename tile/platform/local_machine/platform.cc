@@ -20,6 +20,7 @@
 #include "tile/lang/parser.h"
 #include "tile/platform/local_machine/block_placer.h"
 #include "tile/platform/local_machine/buffer.h"
+#include "tile/platform/local_machine/cpu_buffer.h"
 #include "tile/platform/local_machine/cpu_program.h"
 #include "tile/platform/local_machine/direct_mem_strategy.h"
 #include "tile/platform/local_machine/fifo_scheduler.h"
@@ -214,12 +215,24 @@ void Platform::RegisterCostModel(const lang::TileCostFunction& cost_fn) { tile_o
 std::shared_ptr<tile::Buffer> Platform::MakeBuffer(const context::Context& ctx, const std::string& device_id,
                                                    std::uint64_t size) {
   if (device_id == kCpuDevice) {
-    return std::make_shared<SimpleBuffer>(size);
+    return std::make_shared<CpuBuffer>(size);
   }
   auto& platform_dev = LookupDevice(device_id);
   return std::make_shared<Buffer>(platform_dev.devinfo, platform_dev.mem_strategy, size);
 }
 
+std::shared_ptr<tile::Buffer> Platform::WrapBuffer(const context::Context& ctx, const std::string& device_id,
+                                                   void* data, std::uint64_t size, std::function<void()> release) {
+  // Only the CPU device executes directly against host memory.
+  if (device_id != kCpuDevice) {
+    throw error::Unimplemented{"Device \"" + device_id + "\" cannot wrap host memory"};
+  }
+  if (!data && size) {
+    throw error::InvalidArgument{"Cannot wrap a null host pointer"};
+  }
+  return std::make_shared<CpuBuffer>(static_cast<char*>(data), size, std::move(release));
+}
+
 std::shared_ptr<tile::Program> Platform::MakeProgram(  //
     const context::Context& ctx,                       //
     const tile::proto::Program& program,               //
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <set>
 #include <string>
@@ -43,6 +44,13 @@ class Platform : public tile::Platform {
       const std::string& device,             //
       std::uint64_t size) final;
 
+  std::shared_ptr<tile::Buffer> WrapBuffer(  //
+      const context::Context& ctx,           //
+      const std::string& device,             //
+      void* data,                            //
+      std::uint64_t size,                    //
+      std::function<void()> release) final;
+
   std::shared_ptr<tile::Program> MakeProgram(  //
       const context::Context& ctx,             //
       const tile::proto::Program& program,     //
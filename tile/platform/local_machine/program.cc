@@ -4,9 +4,14 @@
 
 #include <algorithm>
 #include <forward_list>
+#include <future>
 #include <limits>
+#include <map>
 #include <numeric>
 #include <set>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -45,41 +50,124 @@ void AllocateBuffers(const std::vector<std::string>& names, const ShapeMap& type
   }
 }
 
-int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki,
-                  const std::vector<std::shared_ptr<hal::Buffer>>& buffers, const DevInfo& devinfo, size_t trial_runs) {
-  // Check in cache, and early return if found
-  int64_t cached_time = lang::TileCache::Instance()->GetDuration(ki.key, ki.settings, ki.tile.shape);
-  if (cached_time >= 0) {
-    LOG(DEBUG) << "Cached kernel: " << ki.kname << ", key: " << ki.key << ", tile: " << ki.tile.shape;
-    return cached_time;
+std::size_t GetEnvSize(const std::string& name, std::size_t default_value) {
+  auto value = env::Get(name);
+  if (value.empty()) {
+    return default_value;
   }
+  if (value.find_first_not_of("0123456789") == std::string::npos) {
+    try {
+      return std::stoull(value);
+    } catch (const std::out_of_range&) {
+    }
+  }
+  LOG(WARNING) << "Ignoring invalid " << name << "=" << value << "; using " << default_value;
+  return default_value;
+}
 
-  LOG(DEBUG) << "Trying kernel: " << ki.kname << ", key: " << ki.key << ", tile: " << ki.tile.shape;
-  try {
-    // Prep to do a real run
-    auto& device = *devinfo.dev;
-    auto library = device.compiler()->Build(ctx, {ki}, devinfo.settings).get();
-    auto executable = device.executor()->Prepare(library.get()).get();
-    int64_t best_time = std::numeric_limits<int64_t>::max();
-
-    // Run trial_runs number of times, picking minimum time
-    for (size_t i = 0; i < trial_runs; i++) {
-      auto evt = executable->Run(ctx, 0, buffers, {}, true);
-      device.executor()->Flush();
-      auto result = evt->GetFuture().get();
-      int64_t time = result->GetDuration().count();
-      best_time = std::min(time, best_time);
+// Builds the libraries of tile scan candidates on a pool of threads, in the
+// order in which they will be timed, so that building overlaps with timing.
+// Builders stay at most a few candidates ahead of the timing, to bound the
+// number of libraries held at once.  With no threads, each library is built
+// when it is taken, so that nothing else runs while a candidate is timed.
+class TrialBuilder {
+ public:
+  TrialBuilder(const context::Context& ctx, const DevInfo& devinfo, std::vector<const lang::KernelInfo*> kernels,
+               std::size_t threads)
+      : ctx_{ctx}, devinfo_{devinfo}, kernels_{std::move(kernels)}, window_{2 * threads}, promises_(kernels_.size()) {
+    for (auto& promise : promises_) {
+      futures_.emplace_back(promise.get_future());
+    }
+    threads = std::min(threads, kernels_.size());
+    for (std::size_t i = 0; i < threads; ++i) {
+      threads_.emplace_back([this] { Work(); });
+    }
+  }
+
+  ~TrialBuilder() {
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
     }
+  }
 
-    // Save in cache and return
-    lang::TileCache::Instance()->AddEntry(ki.key, ki.settings, ki.tile.shape, best_time);
-    return best_time;
-  } catch (const std::exception& ex) {
-    LOG(ERROR) << "Skipping kernel failure: " << ex.what();
-  } catch (...) {
-    LOG(ERROR) << "Skipping unknown kernel failure";
+  // Waits for the library of the idx'th kernel, throwing if it failed to build.
+  // Libraries must be taken in order.
+  std::unique_ptr<hal::Library> Take(std::size_t idx) {
+    if (threads_.empty()) {
+      return Build(idx);
+    }
+    {
+      std::lock_guard<std::mutex> lock{mu_};
+      taken_ = idx + 1;
+    }
+    cv_.notify_all();
+    return futures_[idx].get();
+  }
+
+ private:
+  void Work() {
+    for (;;) {
+      std::size_t idx;
+      {
+        std::unique_lock<std::mutex> lock{mu_};
+        cv_.wait(lock, [this] { return stop_ || next_ == kernels_.size() || next_ < taken_ + window_; });
+        if (stop_ || next_ == kernels_.size()) {
+          return;
+        }
+        idx = next_++;
+      }
+      try {
+        promises_[idx].set_value(Build(idx));
+      } catch (...) {
+        promises_[idx].set_exception(std::current_exception());
+      }
+    }
+  }
+
+  std::unique_ptr<hal::Library> Build(std::size_t idx) {
+    return devinfo_.dev->compiler()->Build(ctx_, {*kernels_[idx]}, devinfo_.settings).get();
+  }
+
+  const context::Context& ctx_;
+  const DevInfo& devinfo_;
+  const std::vector<const lang::KernelInfo*> kernels_;
+  const std::size_t window_;
+  std::vector<std::promise<std::unique_ptr<hal::Library>>> promises_;
+  std::vector<std::future<std::unique_ptr<hal::Library>>> futures_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::size_t next_ = 0;   // The next kernel to build
+  std::size_t taken_ = 0;  // The number of libraries taken for timing
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+int64_t TryKernel(const context::Context& ctx, const lang::KernelInfo& ki, const std::string& hardware,
+                  std::unique_ptr<hal::Library> library, const std::vector<std::shared_ptr<hal::Buffer>>& buffers,
+                  const DevInfo& devinfo, size_t trial_runs) {
+  LOG(DEBUG) << "Trying kernel: " << ki.kname << ", key: " << ki.key << ", tile: " << ki.tile.shape;
+  // Prep to do a real run
+  auto& device = *devinfo.dev;
+  auto executable = device.executor()->Prepare(library.get()).get();
+  int64_t best_time = std::numeric_limits<int64_t>::max();
+
+  // Run trial_runs number of times, picking minimum time
+  for (size_t i = 0; i < trial_runs; i++) {
+    auto evt = executable->Run(ctx, 0, buffers, {}, true);
+    device.executor()->Flush();
+    auto result = evt->GetFuture().get();
+    int64_t time = result->GetDuration().count();
+    best_time = std::min(time, best_time);
   }
-  return std::numeric_limits<int64_t>::max();
+
+  // Save in cache and return
+  lang::TileCache::Instance()->AddEntry(hardware, ki.key, ki.settings, ki.tile.shape, best_time);
+  return best_time;
 }
 
 lang::KernelList CompileProgram(           //
@@ -140,36 +228,114 @@ lang::KernelList CompileProgram(           //
     }
   }
 
-  for (auto& ki : kernel_list.kernels) {
+  // Gather the candidates of every kernel, looking each up in the tile cache,
+  // so that those which must be timed can all be built ahead of the timing.
+  auto hardware = device.description();
+  std::vector<std::vector<lang::KernelInfo>> trials(kernel_list.kernels.size());
+  std::vector<std::vector<int64_t>> times(kernel_list.kernels.size());
+  for (size_t k = 0; k < kernel_list.kernels.size(); k++) {
+    auto& ki = kernel_list.kernels[k];
     if (ki.candidates.empty()) {
       continue;
     }
+    std::vector<lang::KernelInfo> candidates;
+    std::swap(candidates, ki.candidates);
+    trials[k].push_back(ki);
+    trials[k].insert(trials[k].end(), candidates.begin(), candidates.end());
+    for (const auto& candidate : trials[k]) {
+      int64_t cached_time =
+          lang::TileCache::Instance()->GetDuration(hardware, candidate.key, candidate.settings, candidate.tile.shape);
+      if (cached_time >= 0) {
+        LOG(DEBUG) << "Cached kernel: " << candidate.kname << ", key: " << candidate.key
+                   << ", tile: " << candidate.tile.shape;
+      }
+      times[k].push_back(cached_time);
+    }
+  }
+
+  // Kernels which share a cache key (e.g. repeated layers) have the same
+  // candidates, so each distinct candidate is built and timed once, and its
+  // time used for all of them.  Copies of a candidate also share its kfunc,
+  // which building optimizes in place, so they must not be built concurrently.
+  using TrialKey = std::tuple<std::string, uint64_t, bool, uint64_t, std::vector<uint64_t>>;
+  std::map<TrialKey, size_t> trial_ids;
+  std::vector<std::vector<size_t>> trial_id(trials.size());
+  std::vector<const lang::KernelInfo*> to_build;
+  for (size_t k = 0; k < trials.size(); k++) {
+    trial_id[k].resize(trials[k].size());
+    for (size_t i = 0; i < trials[k].size(); i++) {
+      if (times[k][i] >= 0) {
+        continue;
+      }
+      const auto& ki = trials[k][i];
+      TrialKey key{ki.key, ki.settings.threads, ki.settings.use_global, ki.settings.mem_width, ki.tile.shape};
+      auto inserted = trial_ids.emplace(key, to_build.size());
+      trial_id[k][i] = inserted.first->second;
+      if (inserted.second) {
+        to_build.push_back(&ki);
+      }
+    }
+  }
+  std::vector<int64_t> trial_times(to_build.size(), -1);
+  // Devices which run on the host share its cores with the builders, which
+  // would skew the timing, so by default their candidates are built inline.
+  std::size_t build_threads = 0;
+  if (device.executor()->info().type() != hal::proto::HardwareType::CPU) {
+    build_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  TrialBuilder builder{ctx, devinfo, to_build, GetEnvSize("PLAIDML_KERNEL_TRIAL_THREADS", build_threads)};
+
+  // Candidates are timed one at a time, so that timing runs do not contend
+  // with each other; on other devices, builds continue during timing.
+  for (size_t k = 0; k < trials.size(); k++) {
+    if (trials[k].empty()) {
+      continue;
+    }
 
     std::vector<std::shared_ptr<hal::Buffer>> buffers;
-    AllocateBuffers(ki.outputs, kernel_list.types, memory, &buffers);
-    AllocateBuffers(ki.inputs, kernel_list.types, memory, &buffers);
+    AllocateBuffers(kernel_list.kernels[k].outputs, kernel_list.types, memory, &buffers);
+    AllocateBuffers(kernel_list.kernels[k].inputs, kernel_list.types, memory, &buffers);
 
-    std::vector<lang::KernelInfo> candidates;
-    std::swap(candidates, ki.candidates);
+    for (size_t i = 0; i < trials[k].size(); i++) {
+      if (times[k][i] >= 0) {
+        continue;
+      }
+      // Candidates are built in the order in which they are first timed.
+      auto id = trial_id[k][i];
+      if (trial_times[id] < 0) {
+        trial_times[id] = std::numeric_limits<int64_t>::max();
+        try {
+          trial_times[id] = TryKernel(ctx, trials[k][i], hardware, builder.Take(id), buffers, devinfo, trial_runs);
+        } catch (const std::exception& ex) {
+          LOG(ERROR) << "Skipping kernel failure: " << ex.what();
+        } catch (...) {
+          LOG(ERROR) << "Skipping unknown kernel failure";
+        }
+      }
+      times[k][i] = trial_times[id];
+    }
 
-    size_t cur_num = 0;
     size_t best_num = 0;
-    uint64_t best_time = TryKernel(ctx, ki, buffers, devinfo, trial_runs);
+    uint64_t best_time = times[k][0];
     pre_scan_time.add(best_time);
-    for (const auto& candidate : candidates) {
-      cur_num++;
-      uint64_t time = TryKernel(ctx, candidate, buffers, devinfo, trial_runs);
+    for (size_t i = 1; i < trials[k].size(); i++) {
+      uint64_t time = times[k][i];
       if (time < best_time) {
         best_time = time;
-        ki = candidate;
-        best_num = cur_num;
+        best_num = i;
       }
     }
+    if (best_num) {
+      kernel_list.kernels[k] = trials[k][best_num];
+    }
     post_scan_time.add(best_time);
     IVLOG(1, "  best: " << double(best_time) / 1e9 << ", index: " << best_num);
     IVLOG(1, "  pre_scan_time: " << double(pre_scan_time.get()) / 1e9
                                  << ", post_scan_time: " << double(post_scan_time.get()) / 1e9);
   }
+  if (!to_build.empty()) {
+    lang::TileCache::Instance()->ExportToEnv();
+  }
 
   return kernel_list;
 }
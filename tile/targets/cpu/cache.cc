@@ -0,0 +1,243 @@
+// Copyright 2019, Intel Corp.
+
+#include "tile/targets/cpu/cache.h"
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/SHA1.h>
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "base/util/file.h"
+#include "base/util/logging.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Bump the format version whenever the entry layout or the code generator
+// changes in a way that invalidates previously cached object code.
+const char kMagic[] = "PMLCPU03";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+constexpr size_t kDigestSize = 20;
+const char kEntryExtension[] = ".pmlobj";
+
+std::string Digest(llvm::StringRef data) {
+  llvm::SHA1 sha;
+  sha.update(data);
+  return sha.final().str();
+}
+
+std::string ToHex(const std::string& bytes) {
+  static const char digits[] = "0123456789abcdef";
+  std::string ret;
+  ret.reserve(bytes.size() * 2);
+  for (unsigned char ch : bytes) {
+    ret.push_back(digits[ch >> 4]);
+    ret.push_back(digits[ch & 0xf]);
+  }
+  return ret;
+}
+
+void WriteU64(std::string* out, uint64_t value) {
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    out->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+void WriteString(std::string* out, const std::string& value) {
+  WriteU64(out, value.size());
+  out->append(value);
+}
+
+class Reader {
+ public:
+  explicit Reader(llvm::StringRef data) : data_(data) {}
+
+  bool ReadU64(uint64_t* value) {
+    if (data_.size() < sizeof(*value)) {
+      return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < sizeof(*value); ++i) {
+      *value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[i])) << (i * 8);
+    }
+    data_ = data_.drop_front(sizeof(*value));
+    return true;
+  }
+
+  bool ReadString(std::string* value) {
+    uint64_t size;
+    if (!ReadU64(&size) || data_.size() < size) {
+      return false;
+    }
+    *value = data_.take_front(size).str();
+    data_ = data_.drop_front(size);
+    return true;
+  }
+
+  bool empty() const { return data_.empty(); }
+
+ private:
+  llvm::StringRef data_;
+};
+
+}  // namespace
+
+CodeCache::CodeCache(const fs::path& dir, uint64_t max_bytes) : dir_(dir), max_bytes_(max_bytes) {
+  boost::system::error_code ec;
+  fs::create_directories(dir_, ec);
+  if (ec) {
+    LOG(WARNING) << "Unable to create CPU code cache directory " << dir_ << ": " << ec.message();
+  }
+}
+
+bool CodeCache::IsCacheable(const Config& config) {
+  return config.externals.empty() && !config.profile_block_execution && !config.profile_loop_body;
+}
+
+std::string CodeCache::MakeKey(const stripe::Block& program, const Config& config, const Target& target) {
+  std::ostringstream ss;
+  ss << kMagic << '\n';
+  ss << "llvm: " << LLVM_VERSION_STRING << '\n';
+  ss << "triple: " << target.triple << '\n';
+  ss << "cpu: " << target.cpu << '\n';
+  ss << "features: " << target.features << '\n';
+  ss << "vector_math: " << config.vector_math << '\n';
+  ss << program;
+  return ToHex(Digest(ss.str()));
+}
+
+fs::path CodeCache::EntryPath(const std::string& key) const { return dir_ / (key + kEntryExtension); }
+
+bool CodeCache::Load(const std::string& key, Entry* entry) {
+  auto path = EntryPath(key);
+  std::string contents;
+  try {
+    if (!fs::exists(path)) {
+      return false;
+    }
+    contents = ReadFile(path, true);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to read CPU code cache entry " << path << ": " << ex.what();
+    return false;
+  }
+  llvm::StringRef data(contents);
+  bool valid = data.size() >= kMagicSize + kDigestSize && data.startswith(kMagic);
+  if (valid) {
+    auto digest = data.substr(kMagicSize, kDigestSize);
+    data = data.drop_front(kMagicSize + kDigestSize);
+    valid = digest == Digest(data);
+  }
+  if (valid) {
+    Reader reader(data);
+    uint64_t num_params = 0;
+    valid = reader.ReadU64(&entry->arena_size) && reader.ReadU64(&num_params);
+    entry->parameters.clear();
+    for (uint64_t i = 0; valid && i < num_params; ++i) {
+      std::string param;
+      valid = reader.ReadString(&param);
+      entry->parameters.emplace_back(std::move(param));
+    }
+    uint64_t num_objects = 0;
+    valid = valid && reader.ReadU64(&num_objects);
+    entry->objects.clear();
+    for (uint64_t i = 0; valid && i < num_objects; ++i) {
+      std::string object;
+      valid = reader.ReadString(&object);
+      entry->objects.emplace_back(std::move(object));
+    }
+    valid = valid && reader.empty();
+  }
+  boost::system::error_code ec;
+  if (!valid) {
+    LOG(WARNING) << "Discarding corrupt CPU code cache entry " << path;
+    fs::remove(path, ec);
+    return false;
+  }
+  // Refresh the modification time, which serves as the entry's LRU timestamp.
+  fs::last_write_time(path, std::time(nullptr), ec);
+  IVLOG(1, "CPU code cache hit: " << key);
+  return true;
+}
+
+void CodeCache::Store(const std::string& key, const Entry& entry) {
+  std::string payload;
+  WriteU64(&payload, entry.arena_size);
+  WriteU64(&payload, entry.parameters.size());
+  for (const auto& param : entry.parameters) {
+    WriteString(&payload, param);
+  }
+  WriteU64(&payload, entry.objects.size());
+  for (const auto& object : entry.objects) {
+    WriteString(&payload, object);
+  }
+  std::string contents = kMagic;
+  contents += Digest(payload);
+  contents += payload;
+
+  // Write into a uniquely named temporary file in the cache directory, then
+  // atomically rename it into place.
+  auto path = EntryPath(key);
+  auto tmp_path = dir_ / fs::unique_path(key + ".%%%%-%%%%-%%%%.tmp");
+  boost::system::error_code ec;
+  try {
+    WriteFile(tmp_path, contents, true);
+    fs::rename(tmp_path, path);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Unable to write CPU code cache entry " << path << ": " << ex.what();
+    fs::remove(tmp_path, ec);
+    return;
+  }
+  IVLOG(1, "CPU code cache store: " << key << ", " << contents.size() << " bytes");
+  Evict();
+}
+
+void CodeCache::Evict() {
+  std::vector<std::pair<std::time_t, fs::path>> entries;
+  uint64_t total = 0;
+  boost::system::error_code ec;
+  for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+    const auto& path = it->path();
+    if (path.extension() != kEntryExtension) {
+      continue;
+    }
+    auto size = fs::file_size(path, ec);
+    auto mtime = fs::last_write_time(path, ec);
+    if (ec) {
+      // The entry may have been removed by a concurrent process.
+      ec.clear();
+      continue;
+    }
+    total += size;
+    entries.emplace_back(mtime, path);
+  }
+  if (total <= max_bytes_) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end());
+  for (const auto& item : entries) {
+    if (total <= max_bytes_) {
+      break;
+    }
+    auto size = fs::file_size(item.second, ec);
+    if (!ec && fs::remove(item.second, ec)) {
+      IVLOG(1, "CPU code cache evict: " << item.second);
+      total -= std::min(total, static_cast<uint64_t>(size));
+    }
+    ec.clear();
+  }
+}
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,60 @@
+// Copyright 2019, Intel Corp.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/config.h"
+#include "tile/targets/cpu/target.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// A persistent, content-addressed store of compiled CPU programs, allowing
+// a process to skip LLVM optimization and code generation for a program that
+// some earlier process has already compiled.
+//
+// Entries are written to a temporary file and then renamed into place, so
+// readers never observe a partially written entry; each entry also carries
+// a digest of its contents, and entries which fail verification are removed.
+// When the total size of the cache exceeds its limit, the least recently
+// used entries are evicted.
+class CodeCache {
+ public:
+  struct Entry {
+    std::vector<std::string> objects;  // Relocatable object code for the program
+    uint64_t arena_size = 0;
+    std::vector<std::string> parameters;
+  };
+
+  CodeCache(const boost::filesystem::path& dir, uint64_t max_bytes);
+
+  // Returns true if programs compiled with this config may be cached.
+  // Programs which reference process-specific state (external handlers) or
+  // which are instrumented for profiling are never cached.
+  static bool IsCacheable(const Config& config);
+
+  // Computes the cache key for a program compiled with a config for a target.
+  static std::string MakeKey(const stripe::Block& program, const Config& config, const Target& target);
+
+  bool Load(const std::string& key, Entry* entry);
+  void Store(const std::string& key, const Entry& entry);
+
+ private:
+  boost::filesystem::path EntryPath(const std::string& key) const;
+  void Evict();
+
+  boost::filesystem::path dir_;
+  uint64_t max_bytes_;
+};
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -2,30 +2,44 @@
 
 #include "tile/targets/cpu/compiler.h"
 
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Target/TargetMachine.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 
 #include <algorithm>
 #include <deque>
 #include <memory>
+#include <set>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <half.hpp>
 
 #include "base/util/lookup.h"
+#include "tbb/tbb.h"
 #include "tile/stripe/stripe.h"
 #include "tile/targets/cpu/executable.h"
 #include "tile/targets/cpu/link_names.h"
+#include "tile/targets/cpu/specials.h"
+#include "tile/targets/cpu/vecmath.h"
 
 namespace vertexai {
 namespace tile {
@@ -39,6 +53,97 @@ class Error : public std::runtime_error {
   using std::runtime_error::runtime_error;
 };
 
+// The vector math variants which the target is able to call.
+static std::vector<llvm::VecDesc> VectorMathDescs(const Target& target) {
+  std::vector<llvm::VecDesc> descs;
+  if (llvm::Triple(target.triple).getArch() != llvm::Triple::x86_64) {
+    return descs;
+  }
+  auto attrs = target.attrs();
+  std::set<std::string> features(attrs.begin(), attrs.end());
+  for (const auto& func : VecMathFunctions()) {
+    for (const auto& variant : func.variants) {
+      bool supported = std::all_of(variant.features.begin(), variant.features.end(),
+                                   [&](const std::string& feature) { return features.count("+" + feature); });
+      if (supported) {
+        descs.push_back({func.name, variant.name, variant.width});
+      }
+    }
+  }
+  return descs;
+}
+
+// Whether the shape's elements are packed contiguously in row-major order.
+static bool IsDenseRowMajor(const TensorShape& shape) {
+  int64_t stride = 1;
+  for (size_t i = shape.dims.size(); i-- > 0;) {
+    const auto& dim = shape.dims[i];
+    if (dim.size > 1 && dim.stride != stride) {
+      return false;
+    }
+    stride *= dim.size;
+  }
+  return true;
+}
+
+// Whether the runtime's gather and scatter can read indices of this type.
+static bool IsRuntimeIndexType(DataType type) {
+  return (is_int(type) || is_uint(type)) && byte_width(type) <= sizeof(uint64_t);
+}
+
+static std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(const Target& target, bool jit) {
+  std::string errorMessage;
+  auto llvm_target = llvm::TargetRegistry::lookupTarget(target.triple, errorMessage);
+  if (!llvm_target) {
+    throw std::runtime_error("Failed to look up target " + target.triple + ": " + errorMessage);
+  }
+  // Code generated for the JIT uses the same code model as the code MCJIT
+  // generates itself, so that it can be loaded anywhere in the address space.
+  return std::unique_ptr<llvm::TargetMachine>(llvm_target->createTargetMachine(
+      target.triple, target.cpu, target.features, {}, {}, llvm::None, llvm::CodeGenOpt::Default, jit));
+}
+
+// Adds the module optimization pipeline to a pass manager.
+static void AddOptimizationPasses(llvm::legacy::PassManager* pm,  //
+                                  llvm::TargetMachine* machine,   //
+                                  const Target& target,           //
+                                  const Config& config) {
+  llvm::PassManagerBuilder pmb;
+  pmb.OptLevel = 3;
+  pmb.SizeLevel = 0;
+  pmb.SLPVectorize = true;
+  pmb.LoopVectorize = true;
+  pmb.MergeFunctions = true;
+  // Describe the vector math library's SIMD variants, so that the vectorizers
+  // can widen calls to its scalar functions. The builder takes ownership of
+  // the library info.
+  auto tlii = new llvm::TargetLibraryInfoImpl(llvm::Triple(target.triple));
+  if (config.vector_math) {
+    tlii->addVectorizableFunctions(VectorMathDescs(target));
+  }
+  pmb.LibraryInfo = tlii;
+  // Without target information the vectorizers see no vector registers and
+  // their cost model falls back to scalar code.
+  pm->add(llvm::createTargetTransformInfoWrapperPass(machine->getTargetIRAnalysis()));
+  pmb.populateModulePassManager(*pm);
+}
+
+// The functions defined in the module which a function calls, directly or by
+// passing them to a runtime function such as ParallelFor.
+static std::vector<llvm::Function*> DefinedCallees(llvm::Function* caller) {
+  std::vector<llvm::Function*> result;
+  std::set<llvm::Function*> seen;
+  for (auto& inst : llvm::instructions(caller)) {
+    for (auto& operand : inst.operands()) {
+      auto callee = llvm::dyn_cast<llvm::Function>(operand);
+      if (callee && callee != caller && !callee->isDeclaration() && seen.insert(callee).second) {
+        result.push_back(callee);
+      }
+    }
+  }
+  return result;
+}
+
 Compiler::Compiler(llvm::LLVMContext* context, const Config& config)
     : context_(*context), builder_{context_}, config_{config}, arenaSize_(0) {
   static std::once_flag init_once;
@@ -57,30 +162,28 @@ ProgramModule Compiler::CompileProgram(const stripe::Block& program) {
   ret.module = std::make_unique<llvm::Module>("stripe", context_);
   module_ = ret.module.get();
 
-  auto targetTriple = llvm::sys::getProcessTriple();
-  std::string errorMessage;
-  auto target = llvm::TargetRegistry::lookupTarget(targetTriple, errorMessage);
-  std::unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(targetTriple, "generic", "", {}, {}));
+  // Generate code for the configured processor, which defaults to the host,
+  // so that the vectorizers can make use of its full instruction set.
+  ret.target = GetTarget(config_);
+  auto machine = CreateTargetMachine(ret.target, false);
   module_->setDataLayout(machine->createDataLayout());
-  module_->setTargetTriple(targetTriple);
+  module_->setTargetTriple(ret.target.triple);
 
-  GenerateArena(program);
+  arenaSize_ = MeasureArena(program);
   llvm::Function* main = CompileBlock(program);
   ret.externals = external_funcptrs_;
+  ret.arena_size = arenaSize_;
   // Generate a stub function we can invoke from the outside, passing buffers
   // as an array of generic pointers.
   GenerateInvoker(program, main);
-  // Improve the simple-minded IR we've just generated by running module-level
-  // optimization passes; among many other things, this will streamline our
-  // loops to eliminate most branches and inline most block function calls.
-  llvm::PassManagerBuilder pmb;
-  pmb.OptLevel = 3;
-  pmb.SizeLevel = 0;
-  pmb.SLPVectorize = true;
-  pmb.LoopVectorize = true;
-  pmb.MergeFunctions = true;
-  llvm::legacy::PassManager modopt;
-  pmb.populateModulePassManager(modopt);
+  // Tag every function with the target so that per-function subtarget queries
+  // (and any later re-optimization of this module) agree with the machine.
+  for (auto& func : *module_) {
+    if (!func.isDeclaration()) {
+      func.addFnAttr("target-cpu", ret.target.cpu);
+      func.addFnAttr("target-features", ret.target.features);
+    }
+  }
   if (config_.print_llvm_ir_simple) {
     llvm::errs() << "LLVM IR, unoptimized: ================\n";
     module_->print(llvm::errs(), nullptr);
@@ -88,14 +191,47 @@ ProgramModule Compiler::CompileProgram(const stripe::Block& program) {
   if (llvm::verifyModule(*module_, &llvm::errs())) {
     throw std::runtime_error("Byte");
   }
-  modopt.run(*module_);
-  if (config_.print_llvm_ir_optimized) {
-    llvm::errs() << "LLVM IR, after optimization: ================\n";
-    module_->print(llvm::errs(), nullptr);
+  // Programs whose kernels can be divided among threads are optimized and
+  // compiled to object code in parallel. Printing the optimized program and
+  // reading the profile counters both need the program as a single module.
+  // The kernels are the blocks which the program's main blocks call.
+  std::set<llvm::Function*> roots{main};
+  std::set<llvm::Function*> kernels;
+  for (auto block : DefinedCallees(main)) {
+    roots.insert(block);
+    for (auto kernel : DefinedCallees(block)) {
+      roots.insert(kernel);
+      kernels.insert(kernel);
+    }
   }
-  if (config_.print_assembly) {
-    llvm::errs() << "Assembly code: ================\n";
-    PrintOutputAssembly(machine.get());
+  auto threads = config_.compile_threads ? config_.compile_threads : std::thread::hardware_concurrency();
+  auto partitions = std::min<size_t>(threads, kernels.size());
+  bool parallel = partitions > 1 && !config_.profile_block_execution && !config_.profile_loop_body &&
+                  !config_.print_llvm_ir_optimized && !config_.print_assembly;
+  if (parallel) {
+    // Make each kernel's nested blocks private to it, so that the partitions
+    // keep them together and may optimize them freely.
+    for (auto& func : *module_) {
+      if (!func.isDeclaration() && !roots.count(&func) && func.getName() != invoker_name_) {
+        func.setLinkage(llvm::GlobalValue::InternalLinkage);
+      }
+    }
+    ret.objects = CompileInParallel(ret.target, partitions);
+  } else {
+    // Improve the simple-minded IR we've just generated by running module-level
+    // optimization passes; among many other things, this will streamline our
+    // loops to eliminate most branches and inline most block function calls.
+    llvm::legacy::PassManager modopt;
+    AddOptimizationPasses(&modopt, machine.get(), ret.target, config_);
+    modopt.run(*module_);
+    if (config_.print_llvm_ir_optimized) {
+      llvm::errs() << "LLVM IR, after optimization: ================\n";
+      module_->print(llvm::errs(), nullptr);
+    }
+    if (config_.print_assembly) {
+      llvm::errs() << "Assembly code: ================\n";
+      PrintOutputAssembly(machine.get());
+    }
   }
   // Wrap the finished module and the parameter names into a ProgramModule.
   for (auto& ref : program.refs) {
@@ -108,6 +244,43 @@ ProgramModule Compiler::CompileProgram(const stripe::Block& program) {
   return ret;
 }
 
+std::vector<std::string> Compiler::CompileInParallel(const Target& target, size_t partitions) {
+  // Divide the program into modules which keep each kernel together with its
+  // nested blocks. An LLVMContext may only be used by one thread at a time, so
+  // the partitions travel to their threads as bitcode, each to be read into a
+  // context of its own. The original module is left as it was.
+  std::vector<llvm::SmallVector<char, 0>> bitcode;
+  llvm::SplitModule(
+      llvm::CloneModule(*module_), partitions,
+      [&bitcode](std::unique_ptr<llvm::Module> part) {
+        bitcode.emplace_back();
+        llvm::raw_svector_ostream os(bitcode.back());
+        llvm::WriteBitcodeToFile(*part, os);
+      },
+      true);  // PreserveLocals
+  IVLOG(1, "Compiling " << bitcode.size() << " program partitions in parallel");
+  std::vector<std::string> objects(bitcode.size());
+  tbb::parallel_for(size_t(0), bitcode.size(), [&](size_t i) {
+    llvm::LLVMContext context;
+    llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode[i].data(), bitcode[i].size()), "partition");
+    auto part = llvm::parseBitcodeFile(buffer, context);
+    if (!part) {
+      throw std::runtime_error("Failed to read program partition: " + llvm::toString(part.takeError()));
+    }
+    auto machine = CreateTargetMachine(target, true);
+    llvm::legacy::PassManager pm;
+    AddOptimizationPasses(&pm, machine.get(), target, config_);
+    llvm::SmallVector<char, 0> object;
+    llvm::raw_svector_ostream os(object);
+    if (machine->addPassesToEmitFile(pm, os, nullptr, llvm::CGFT_ObjectFile)) {
+      throw std::runtime_error("The target is unable to emit object code");
+    }
+    pm.run(**part);
+    objects[i].assign(object.begin(), object.end());
+  });
+  return objects;
+}
+
 Compiler::Compiler(llvm::LLVMContext* context, llvm::Module* module, const Config& config)
     : context_(*context), builder_{context_}, module_(module), config_{config}, arenaSize_(0) {
   // This private constructor sets up a nested instance which will
@@ -121,13 +294,16 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   // buffer parameters it expects. From C, we will prepare a vector of void*,
   // containing the parameter buffer data pointers; the wrapper will extract
   // each data pointer, then pass each one as a parameter when it calls the
-  // program's top-level block function.
+  // program's top-level block function. The second parameter is the arena
+  // for this invocation, which the caller provides so that concurrent
+  // invocations of the same program never share temporary storage.
   assert(!program.has_tag("cpu_thread"));
   // LLVM doesn't have the notion of a void pointer, so we'll pretend all of
   // these buffers are arrays of int8, then bitcast later.
   llvm::Type* arrayptr = builder_.getInt8PtrTy()->getPointerTo();
   llvm::Type* voidtype = builder_.getVoidTy();
-  auto invoker_type = llvm::FunctionType::get(voidtype, {arrayptr}, false);
+  llvm::Type* arenatype = builder_.getInt8PtrTy();
+  auto invoker_type = llvm::FunctionType::get(voidtype, {arrayptr, arenatype}, false);
   auto linkage = llvm::Function::ExternalLinkage;
   auto invoker = llvm::Function::Create(invoker_type, linkage, invoker_name_, module_);
   auto block = llvm::BasicBlock::Create(context_, "block", invoker);
@@ -135,22 +311,15 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   // We'll look up the kernel by name and implicitly bitcast it so we can call
   // it using our int32-pointers in place of whatever it actually expects;
   // LLVM will tolerate this mismatch when we use getOrInsertFunction.
-  auto ai = invoker->arg_begin();
-  llvm::Value* argvec = &(*ai);
+  llvm::Value* argvec = invoker->getArg(0);
+  llvm::Value* arena = invoker->getArg(1);
+  arena->setName("arena");
   // The body of the invoker will compute the element pointer for each
   // argument value in order, then load the value.
   std::vector<llvm::Value*> args;
   std::vector<llvm::Value*> allocs;
   {
-    if (arenaSize_) {
-      IVLOG(1, "Arena size: " << arenaSize_);
-      // allocate the arena on the heap. This way static initialization order is never an issue.
-      auto buffer = Malloc(arenaSize_);
-      auto arena_gval = module_->getNamedGlobal(arena_name_);
-      auto arenatype = llvm::ArrayType::get(builder_.getInt8Ty(), 1)->getPointerTo();
-      builder_.CreateStore(builder_.CreateBitCast(buffer, arenatype), arena_gval);
-      allocs.push_back(buffer);
-    }
+    IVLOG(1, "Arena size: " << arenaSize_);
     unsigned i = 0;
     for (auto& ref : program.refs) {
       if (ref.has_tag("user")) {
@@ -178,6 +347,8 @@ void Compiler::GenerateInvoker(const stripe::Block& program, llvm::Function* mai
   for (unsigned i = 0; i < program.idxs.size(); ++i) {
     args.push_back(IndexConst(0));
   }
+  // Finally, the arena, from which nested blocks carve out placed buffers.
+  args.push_back(arena);
   // Having built the argument list, we'll call the actual kernel using the
   // parameter signature it expects.
   builder_.CreateCall(main, args, "");
@@ -211,14 +382,6 @@ uint64_t Compiler::MeasureArena(const stripe::Block& block) {
   return extent;
 }
 
-void Compiler::GenerateArena(const stripe::Block& block) {
-  arenaSize_ = MeasureArena(block);
-  auto arenatype = llvm::ArrayType::get(builder_.getInt8Ty(), 1)->getPointerTo();
-  module_->getOrInsertGlobal(arena_name_, arenatype);
-  auto gval = module_->getNamedGlobal(arena_name_);
-  gval->setInitializer(llvm::Constant::getNullValue(arenatype));
-}
-
 llvm::Function* Compiler::CompileXSMMBlock(const stripe::Block& block, const XSMMDispatch xsmmDispatch,
                                            const XSMMCallData& xsmmCallData) {
   // Validate incoming params.
@@ -257,12 +420,15 @@ llvm::Function* Compiler::CompileXSMMBlock(const stripe::Block& block, const XSM
       ai->setName(param_name);
       assert(nullptr == buffers_[param_name].base);
       buffers_[param_name].base = &(*ai);
-    } else {
+    } else if (idx < block.refs.size() + block.idxs.size()) {
       idx -= block.refs.size();
       std::string param_name = block.idxs[idx].name;
       ai->setName(param_name);
       assert(nullptr == indexes_[param_name].init);
       indexes_[param_name].init = &(*ai);
+    } else {
+      ai->setName("arena");
+      arena_ = &(*ai);
     }
   }
   auto i32t = builder_.getInt32Ty();
@@ -521,6 +687,8 @@ llvm::Function* Compiler::CompileThreadedBlock(const stripe::Block& block) {
     std::string refName = it->into();
     buffers_[refName].base = builder_.CreateBitCast(refPtr, buftype);
   }
+  // The arena pointer follows the refinements in the same array.
+  arena_ = builder_.CreateLoad(builder_.CreateConstGEP1_32(refsArray, block.refs.size()), "arena");
   // Second parameter points to an array of index init values.
   llvm::Value* initsArray = function->getArg(1);
   for (unsigned i = 0; i < block.idxs.size(); ++i) {
@@ -533,16 +701,13 @@ llvm::Function* Compiler::CompileThreadedBlock(const stripe::Block& block) {
   }
   // Third parameter is the composite index range begin.
   // Fourth parameter is the composite index range end.
-  // We will use these to replace the init & limit values for index 0.
-
-  // Construct the joint index loop
-  Loop joint_loop;
-  llvm::Value* joint_idx = builder_.CreateAlloca(IndexType());
-  CreateLoop(&joint_loop, "joint_idx");
-  EnterLoop(&joint_loop, joint_idx, function->getArg(2), function->getArg(3));
-
-  // Extract into specific index values
-  llvm::Value* cur = builder_.CreateLoad(joint_idx);
+  // The composite index enumerates the block's iteration space with the first
+  // index varying fastest. Decompose the range begin into individual index
+  // values once per chunk; the chunk is then walked as rows of the first
+  // index, carrying into the outer indexes between rows.
+  llvm::Value* remaining = builder_.CreateAlloca(IndexType(), nullptr, "remaining");
+  builder_.CreateStore(builder_.CreateSub(function->getArg(3), function->getArg(2)), remaining);
+  llvm::Value* cur = function->getArg(2);
   for (auto& idx : block.idxs) {
     auto low_part = builder_.CreateURem(cur, IndexConst(idx.range));
     auto with_init = builder_.CreateAdd(low_part, indexes_[idx.name].init);
@@ -550,11 +715,58 @@ llvm::Function* Compiler::CompileThreadedBlock(const stripe::Block& block) {
     builder_.CreateStore(with_init, indexes_[idx.name].variable);
   }
 
-  // check the constraints against the current index values and decide whether
-  // to execute the block body for this iteration
+  // Constraints which do not depend on the row index are checked once per row.
+  const auto& row_idx = block.idxs[0];
+  std::vector<const stripe::Affine*> row_constraints;
+  std::vector<const stripe::Affine*> inner_constraints;
+  for (const auto& constraint : block.constraints) {
+    if (constraint.getMap().count(row_idx.name)) {
+      inner_constraints.push_back(&constraint);
+    } else {
+      row_constraints.push_back(&constraint);
+    }
+  }
+
+  auto rows_test = llvm::BasicBlock::Create(context_, "test_rows", function);
+  auto rows_body = llvm::BasicBlock::Create(context_, "body_rows", function);
+  auto rows_next = llvm::BasicBlock::Create(context_, "next_row", function);
+  auto rows_done = llvm::BasicBlock::Create(context_, "done_rows", function);
+  builder_.CreateBr(rows_test);
+  builder_.SetInsertPoint(rows_test);
+  llvm::Value* more = builder_.CreateICmpUGT(builder_.CreateLoad(remaining), IndexConst(0));
+  builder_.CreateCondBr(more, rows_body, rows_done);
+  builder_.SetInsertPoint(rows_body);
+
+  // Clamp this row to the end of the first index's range and of the chunk.
+  llvm::Value* row_var = indexes_[row_idx.name].variable;
+  llvm::Value* row_init = indexes_[row_idx.name].init;
+  llvm::Value* row_begin = builder_.CreateLoad(row_var);
+  llvm::Value* row_avail = builder_.CreateSub(builder_.CreateAdd(row_init, IndexConst(row_idx.range)), row_begin);
+  llvm::Value* row_remaining = builder_.CreateLoad(remaining);
+  llvm::Value* row_count = builder_.CreateSelect(builder_.CreateICmpULT(row_avail, row_remaining),  //
+                                                 row_avail, row_remaining);
+  builder_.CreateStore(builder_.CreateSub(row_remaining, row_count), remaining);
+  llvm::Value* row_end = builder_.CreateAdd(row_begin, row_count);
+
+  llvm::Value* row_go = builder_.getTrue();
+  for (auto constraint : row_constraints) {
+    llvm::Value* gateval = Eval(*constraint);
+    llvm::Value* check = builder_.CreateICmpSGE(gateval, IndexConst(0));
+    row_go = builder_.CreateAnd(check, row_go);
+  }
+  auto row_loop_bb = llvm::BasicBlock::Create(context_, "row", function);
+  builder_.CreateCondBr(row_go, row_loop_bb, rows_next);
+  builder_.SetInsertPoint(row_loop_bb);
+
+  Loop row_loop;
+  CreateLoop(&row_loop, row_idx.name);
+  EnterLoop(&row_loop, row_var, row_begin, row_end);
+
+  // check the remaining constraints against the current index values and
+  // decide whether to execute the block body for this iteration
   llvm::Value* go = builder_.getTrue();
-  for (auto& constraint : block.constraints) {
-    llvm::Value* gateval = Eval(constraint);
+  for (auto constraint : inner_constraints) {
+    llvm::Value* gateval = Eval(*constraint);
     llvm::Value* check = builder_.CreateICmpSGE(gateval, IndexConst(0));
     go = builder_.CreateAnd(check, go);
   }
@@ -565,7 +777,6 @@ llvm::Function* Compiler::CompileThreadedBlock(const stripe::Block& block) {
 
   // process each statement in the block body, generating code to modify the
   // parameter buffer contents
-  std::shared_ptr<stripe::Block> pBlock = std::make_shared<stripe::Block>(block);
   for (const auto& stmt : block.stmts) {
     stmt->Accept(this);
   }
@@ -574,9 +785,30 @@ llvm::Function* Compiler::CompileThreadedBlock(const stripe::Block& block) {
   builder_.CreateBr(block_done);
   builder_.SetInsertPoint(block_done);
 
-  // increment each index, from innermost to outermost, then jump back to test
-  LeaveLoop(&joint_loop, joint_idx);
-
+  LeaveLoop(&row_loop, row_var);
+  builder_.CreateBr(rows_next);
+
+  // Move to the start of the next row, carrying into the outer indexes.
+  builder_.SetInsertPoint(rows_next);
+  builder_.CreateStore(row_init, row_var);
+  for (size_t i = 1; i < block.idxs.size(); ++i) {
+    const auto& idx = block.idxs[i];
+    llvm::Value* variable = indexes_[idx.name].variable;
+    llvm::Value* init = indexes_[idx.name].init;
+    llvm::Value* next = builder_.CreateAdd(builder_.CreateLoad(variable), IndexConst(1));
+    llvm::Value* wrap = builder_.CreateICmpEQ(next, builder_.CreateAdd(init, IndexConst(idx.range)));
+    auto carry = llvm::BasicBlock::Create(context_, "carry_" + idx.name, function);
+    auto no_carry = llvm::BasicBlock::Create(context_, "step_" + idx.name, function);
+    builder_.CreateCondBr(wrap, carry, no_carry);
+    builder_.SetInsertPoint(no_carry);
+    builder_.CreateStore(next, variable);
+    builder_.CreateBr(rows_test);
+    builder_.SetInsertPoint(carry);
+    builder_.CreateStore(init, variable);
+  }
+  builder_.CreateBr(rows_test);
+
+  builder_.SetInsertPoint(rows_done);
   builder_.CreateRetVoid();
   return function;
 }
@@ -618,6 +850,7 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
   // This block will be invoked through a direct function call.
   // First, a parameter for each refinement, containing the base address.
   // Then, a parameter for each index, containing the initial value.
+  // Last, the arena pointer for the current invocation.
   for (auto ai = function->arg_begin(); ai != function->arg_end(); ++ai) {
     unsigned idx = ai->getArgNo();
     if (idx < block.refs.size()) {
@@ -627,12 +860,15 @@ llvm::Function* Compiler::CompileBlock(const stripe::Block& block) {
       ai->setName(param_name);
       assert(nullptr == buffers_[param_name].base);
       buffers_[param_name].base = &(*ai);
-    } else {
+    } else if (idx < block.refs.size() + block.idxs.size()) {
       idx -= block.refs.size();
       std::string param_name = block.idxs[idx].name;
       ai->setName(param_name);
       assert(nullptr == indexes_[param_name].init);
       indexes_[param_name].init = &(*ai);
+    } else {
+      ai->setName("arena");
+      arena_ = &(*ai);
     }
   }
 
@@ -925,10 +1161,8 @@ void Compiler::Visit(const stripe::Block& block) {
     // name, it represents a local allocation.
     if (ref.dir == stripe::RefDir::None && ref.from.empty()) {
       if (ref.has_tag("placed")) {
-        auto arena = module_->getNamedGlobal(arena_name_);
-        auto baseArenaAddress = builder_.CreateLoad(arena);
         std::vector<llvm::Value*> idxList{IndexConst(ref.offset)};
-        buffer = builder_.CreateGEP(baseArenaAddress, idxList);
+        buffer = builder_.CreateGEP(arena_, idxList);
       } else {
         // Allocate new storage for the buffer.
         buffer = Malloc(ref.interior_shape.byte_size());
@@ -956,9 +1190,10 @@ void Compiler::Visit(const stripe::Block& block) {
   // Assemble the argument list and invoke the function.
   if (getCompileFor(block) == THREADED_BLOCK) {
     assert(!block.has_tag("xsmm"));
-    // Combine the bufs into an array; pass it as the first parameter.
+    // Combine the bufs into an array, followed by the arena pointer; pass it
+    // as the first parameter.
     auto int8PtrType = builder_.getInt8Ty()->getPointerTo();
-    auto int8PtrArrayType = llvm::ArrayType::get(int8PtrType, refs.size());
+    auto int8PtrArrayType = llvm::ArrayType::get(int8PtrType, refs.size() + 1);
     llvm::Value* bufsArg = builder_.CreateAlloca(int8PtrArrayType);
     bufsArg = builder_.CreateBitCast(bufsArg, int8PtrType->getPointerTo());
     for (size_t i = 0; i < refs.size(); ++i) {
@@ -966,6 +1201,7 @@ void Compiler::Visit(const stripe::Block& block) {
       llvm::Value* elementPtr = builder_.CreateConstGEP1_32(bufsArg, i);
       builder_.CreateStore(castRef, elementPtr);
     }
+    builder_.CreateStore(arena_, builder_.CreateConstGEP1_32(bufsArg, refs.size()));
     // Combine the idx inits into an array; pass it as the second parameter.
     auto indexArrayType = llvm::ArrayType::get(IndexType(), idxs.size());
     llvm::Value* initsArg = builder_.CreateAlloca(indexArrayType);
@@ -987,10 +1223,12 @@ void Compiler::Visit(const stripe::Block& block) {
       builder_.CreateCall(function, {bufsArg, initsArg, zero, zero});
     }
   } else {
-    // Argument list consists of the refinements, followed by the index inits.
+    // Argument list consists of the refinements, followed by the index inits,
+    // followed by the arena.
     std::vector<llvm::Value*> args;
     args.insert(args.end(), refs.begin(), refs.end());
     args.insert(args.end(), idxs.begin(), idxs.end());
+    args.push_back(arena_);
     // Invoke the function. It does not return a value.
     builder_.CreateCall(function, args, "");
   }
@@ -1512,12 +1750,26 @@ void Compiler::Zero(const stripe::Special& zero) {
   assert(1 == zero.outputs.size());
   Buffer dst = buffers_[zero.outputs[0]];
   auto size = dst.refinement->interior_shape.byte_size();
+  if (size >= rt::kParallelCopyBytes) {
+    llvm::Type* ptrtype = builder_.getInt8PtrTy();
+    auto func = RuntimeFunction("ParallelZero", {ptrtype, IndexType()});
+    builder_.CreateCall(func, {builder_.CreateBitCast(dst.base, ptrtype), IndexConst(size)}, "");
+    return;
+  }
   builder_.CreateMemSet(dst.base, builder_.getInt8(0), size, llvm::MaybeAlign(0));
 }
 
 void Compiler::Copy(const stripe::Special& copy) {
-  // present in stripe.proto but not defined in the specification
-  throw Error("Special operation COPY is not yet specified");
+  // present in stripe.proto but not defined in the specification; we support
+  // the unambiguous case, where the source and destination have one layout.
+  assert(1 == copy.inputs.size());
+  Buffer src = buffers_[copy.inputs[0]];
+  assert(1 == copy.outputs.size());
+  Buffer dst = buffers_[copy.outputs[0]];
+  if (!(src.refinement->interior_shape == dst.refinement->interior_shape)) {
+    throw Error("Special operation COPY requires matching source and destination shapes");
+  }
+  MemCopy(dst, src, dst.refinement->interior_shape.byte_size());
 }
 
 void Compiler::Reshape(const stripe::Special& reshape) {
@@ -1525,8 +1777,19 @@ void Compiler::Reshape(const stripe::Special& reshape) {
   Buffer src = buffers_[reshape.inputs[0]];
   assert(1 == reshape.outputs.size());
   Buffer dst = buffers_[reshape.outputs[0]];
-  auto size = IndexConst(dst.refinement->interior_shape.byte_size());
-  builder_.CreateMemCpy(dst.base, llvm::MaybeAlign(0), src.base, llvm::MaybeAlign(0), size);
+  MemCopy(dst, src, dst.refinement->interior_shape.byte_size());
+}
+
+void Compiler::MemCopy(const Buffer& dst, const Buffer& src, size_t size) {
+  if (size >= rt::kParallelCopyBytes) {
+    llvm::Type* ptrtype = builder_.getInt8PtrTy();
+    auto func = RuntimeFunction("ParallelCopy", {ptrtype, ptrtype, IndexType()});
+    std::vector<llvm::Value*> args{builder_.CreateBitCast(dst.base, ptrtype), builder_.CreateBitCast(src.base, ptrtype),
+                                   IndexConst(size)};
+    builder_.CreateCall(func, args, "");
+    return;
+  }
+  builder_.CreateMemCpy(dst.base, llvm::MaybeAlign(0), src.base, llvm::MaybeAlign(0), IndexConst(size));
 }
 
 void Compiler::PrngStep(const stripe::Special& prng_step) {
@@ -1731,6 +1994,10 @@ void Compiler::Scatter(const stripe::Special& scatter) {
   auto& output_shape = output.refinement->interior_shape;
   assert(output_shape == buffers_[scatter.inputs[2]].refinement->interior_shape);
 
+  if (ScatterRows(data, indices, output)) {
+    return;
+  }
+
   // Build a loop nest over each dimension of the data.
   size_t data_ndims = data_shape.dims.size();
   std::vector<llvm::Value*> limits(data_ndims);
@@ -1773,12 +2040,12 @@ void Compiler::Scatter(const stripe::Special& scatter) {
   llvm::Value* indirect_element = builder_.CreateGEP(indices.base, indirect_idx);
   llvm::Value* indirect_val = builder_.CreateLoad(indirect_element);
 
-  // Clamp the index value to the output range; that is, the size of the first
-  // output dimension.
+  // Clamp the index value to the output range; that is, the last row of the
+  // first output dimension.
   bool ind_signed = !is_uint(indices_shape.type);
   auto cast_op = llvm::CastInst::getCastOpcode(indirect_val, ind_signed, IndexType(), false);
   indirect_val = builder_.CreateCast(cast_op, indirect_val, IndexType());
-  llvm::Value* ind_limit = IndexConst(output_shape.dims[0].size);
+  llvm::Value* ind_limit = IndexConst(output_shape.dims[0].size - 1);
   llvm::Value* must_clamp = builder_.CreateICmpUGT(indirect_val, ind_limit);
   indirect_val = builder_.CreateSelect(must_clamp, ind_limit, indirect_val);
 
@@ -1822,6 +2089,10 @@ void Compiler::Gather(const stripe::Special& gather) {
   assert(1 == gather.outputs.size());
   Buffer dest = buffers_[gather.outputs[0]];
   auto& dest_shape = dest.refinement->interior_shape;
+  if (GatherRows(data, indices, dest)) {
+    return;
+  }
+
   // Build a loop nest for each dimension of "indices".
   // Look up the index value, which must be an integer.
   // Clamp the index value to the range of dimension 0 of "data".
@@ -1870,12 +2141,12 @@ void Compiler::Gather(const stripe::Special& gather) {
   llvm::Value* indirect_val = builder_.CreateLoad(indirect_element);
 
   // Clamp the indirect val, for safety. Convert to unsigned integer, thereby
-  // throwing away negative values, then compare against the destination's
-  // zero'th-dimension size.
+  // throwing away negative values, then clamp to the last row of the data's
+  // zero'th dimension.
   bool ind_signed = !is_uint(indices_shape.type);
   auto cast_op = llvm::CastInst::getCastOpcode(indirect_val, ind_signed, IndexType(), false);
   indirect_val = builder_.CreateCast(cast_op, indirect_val, IndexType());
-  llvm::Value* ind_limit = IndexConst(data_shape.dims[0].size);
+  llvm::Value* ind_limit = IndexConst(data_shape.dims[0].size - 1);
   llvm::Value* must_clamp = builder_.CreateICmpUGT(indirect_val, ind_limit);
   indirect_val = builder_.CreateSelect(must_clamp, ind_limit, indirect_val);
 
@@ -1906,6 +2177,99 @@ void Compiler::Gather(const stripe::Special& gather) {
   }
 }
 
+bool Compiler::GatherRows(const Buffer& data, const Buffer& indices, const Buffer& dest) {
+  // When every tensor is packed, each index selects a contiguous row of
+  // "data" to be copied to the next row of "dest", and the runtime can copy
+  // the rows in parallel.
+  auto& data_shape = data.refinement->interior_shape;
+  auto& indices_shape = indices.refinement->interior_shape;
+  auto& dest_shape = dest.refinement->interior_shape;
+  if (!IsDenseRowMajor(data_shape) || !IsDenseRowMajor(indices_shape) || !IsDenseRowMajor(dest_shape) ||
+      !IsRuntimeIndexType(indices_shape.type) || data_shape.type != dest_shape.type || data_shape.dims.empty() ||
+      !data_shape.dims[0].size) {
+    return false;
+  }
+  size_t row_bytes = byte_width(data_shape.type);
+  for (size_t i = 1; i < data_shape.dims.size(); ++i) {
+    row_bytes *= data_shape.dims[i].size;
+  }
+  llvm::Type* ptrtype = builder_.getInt8PtrTy();
+  auto func = RuntimeFunction("GatherRows", {ptrtype, ptrtype, ptrtype, IndexType(), IndexType(), IndexType(),
+                                             IndexType(), IndexType()});
+  std::vector<llvm::Value*> args{
+      builder_.CreateBitCast(dest.base, ptrtype),       //
+      builder_.CreateBitCast(data.base, ptrtype),       //
+      builder_.CreateBitCast(indices.base, ptrtype),    //
+      IndexConst(indices_shape.sizes_product()),        //
+      IndexConst(byte_width(indices_shape.type)),       //
+      IndexConst(is_uint(indices_shape.type) ? 0 : 1),  //
+      IndexConst(row_bytes),                            //
+      IndexConst(data_shape.dims[0].size),              //
+  };
+  builder_.CreateCall(func, args, "");
+  return true;
+}
+
+bool Compiler::ScatterRows(const Buffer& data, const Buffer& indices, const Buffer& output) {
+  // When every tensor is packed, each index selects a contiguous row of
+  // "output" to which the next row of "data" is added.  The runtime divides
+  // the output rows among its threads, which keeps the sums deterministic.
+  auto& data_shape = data.refinement->interior_shape;
+  auto& indices_shape = indices.refinement->interior_shape;
+  auto& output_shape = output.refinement->interior_shape;
+  if (!IsDenseRowMajor(data_shape) || !IsDenseRowMajor(indices_shape) || !IsDenseRowMajor(output_shape) ||
+      !IsRuntimeIndexType(indices_shape.type) || data_shape.type != output_shape.type || output_shape.dims.empty() ||
+      !output_shape.dims[0].size || indices_shape.dims.size() > data_shape.dims.size()) {
+    return false;
+  }
+  const char* funcname;
+  switch (data_shape.type) {
+    case DataType::FLOAT32:
+      funcname = "ScatterAddRowsF32";
+      break;
+    case DataType::FLOAT64:
+      funcname = "ScatterAddRowsF64";
+      break;
+    case DataType::INT32:
+    case DataType::UINT32:
+      funcname = "ScatterAddRowsI32";
+      break;
+    case DataType::INT64:
+    case DataType::UINT64:
+      funcname = "ScatterAddRowsI64";
+      break;
+    default:
+      return false;
+  }
+  size_t row_elems = 1;
+  for (size_t i = indices_shape.dims.size(); i < data_shape.dims.size(); ++i) {
+    row_elems *= data_shape.dims[i].size;
+  }
+  size_t output_row_elems = 1;
+  for (size_t i = 1; i < output_shape.dims.size(); ++i) {
+    output_row_elems *= output_shape.dims[i].size;
+  }
+  if (row_elems != output_row_elems) {
+    return false;
+  }
+  llvm::Type* eltptrtype = CType(data_shape.type)->getPointerTo();
+  llvm::Type* ptrtype = builder_.getInt8PtrTy();
+  auto func = RuntimeFunction(funcname, {eltptrtype, eltptrtype, ptrtype, IndexType(), IndexType(), IndexType(),
+                                         IndexType(), IndexType()});
+  std::vector<llvm::Value*> args{
+      builder_.CreateBitCast(output.base, eltptrtype),  //
+      builder_.CreateBitCast(data.base, eltptrtype),    //
+      builder_.CreateBitCast(indices.base, ptrtype),    //
+      IndexConst(indices_shape.sizes_product()),        //
+      IndexConst(byte_width(indices_shape.type)),       //
+      IndexConst(is_uint(indices_shape.type) ? 0 : 1),  //
+      IndexConst(row_elems),                            //
+      IndexConst(output_shape.dims[0].size),            //
+  };
+  builder_.CreateCall(func, args, "");
+  return true;
+}
+
 void Compiler::CreateLoop(Loop* loop, std::string name) {
   llvm::Function* func = builder_.GetInsertBlock()->getParent();
   loop->init = llvm::BasicBlock::Create(context_, "init_" + name, func);
@@ -2054,6 +2418,15 @@ void Compiler::CallIntrinsicFunc(const stripe::Intrinsic& stmt, const char* name
   // and half-precision float inputs, f64 for ints and doubles
   bool use_f32 = (stmt.type == DataType::FLOAT16 || stmt.type == DataType::FLOAT32);
   const char* name = use_f32 ? name_f32 : name_f64;
+  // Prefer the vector math library, whose functions the vectorizers can widen;
+  // they must be marked as pure for a loop calling them to vectorize.
+  const VecMathFunction* vecmath = nullptr;
+  if (use_f32 && config_.vector_math) {
+    vecmath = FindVecMathFunction(name_f32);
+    if (vecmath) {
+      name = vecmath->name;
+    }
+  }
   llvm::Type* ctype = use_f32 ? builder_.getFloatTy() : builder_.getDoubleTy();
   std::vector<llvm::Type*> argtypes;
   argtypes.emplace_back(ctype);
@@ -2062,6 +2435,11 @@ void Compiler::CallIntrinsicFunc(const stripe::Intrinsic& stmt, const char* name
   }
   auto functype = llvm::FunctionType::get(ctype, argtypes, false);
   auto func = module_->getOrInsertFunction(name, functype).getCallee();
+  if (vecmath) {
+    auto decl = llvm::cast<llvm::Function>(func);
+    decl->setDoesNotAccessMemory();
+    decl->setDoesNotThrow();
+  }
   llvm::Value* ret = builder_.CreateCall(func, argvals, "");
   OutputType(ret, stmt);
 }
@@ -2090,9 +2468,12 @@ llvm::FunctionType* Compiler::BlockType(const stripe::Block& block) {
     for (size_t i = 0; i < block.idxs.size(); ++i) {
       param_types.push_back(IndexType());
     }
+    // The final parameter is the arena for the current invocation.
+    param_types.push_back(builder_.getInt8PtrTy());
   } else {
     // This block function will be executed via ParallelFor.
-    // First parameter is a pointer to an array of refinement base addresses.
+    // First parameter is a pointer to an array of refinement base addresses,
+    // followed by the arena pointer for the current invocation.
     // Since all block functions must have the same type signature, we will
     // define this as int8_t** instead and bitcast whenever we use it.
     auto int8PtrType = builder_.getInt8Ty()->getPointerTo();
@@ -2206,6 +2587,12 @@ void Compiler::Free(llvm::Value* buffer) {
   builder_.CreateCall(func, {buffer}, "");
 }
 
+llvm::Value* Compiler::RuntimeFunction(const char* funcname, const std::vector<llvm::Type*>& argtypes) {
+  llvm::Type* rettype = llvm::Type::getVoidTy(context_);
+  auto functype = llvm::FunctionType::get(rettype, argtypes, false);
+  return module_->getOrInsertFunction(funcname, functype).getCallee();
+}
+
 llvm::Value* Compiler::PrngStepFunction(void) {
   llvm::Type* floatPtrType = builder_.getFloatTy()->getPointerTo();
   llvm::Type* int32ptrType = builder_.getInt32Ty()->getPointerTo();
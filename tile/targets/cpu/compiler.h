@@ -12,6 +12,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tile/stripe/stripe.h"
 #include "tile/targets/cpu/config.h"
@@ -62,8 +63,10 @@ class Compiler : private stripe::ConstStmtVisitor {
  protected:
   explicit Compiler(llvm::LLVMContext* context, llvm::Module* module, const Config& config);
   void GenerateInvoker(const stripe::Block& program, llvm::Function* main);
+  // Optimizes the module and generates object code for it on the TBB thread
+  // pool, divided into at most the given number of partitions.
+  std::vector<std::string> CompileInParallel(const Target& target, size_t partitions);
   uint64_t MeasureArena(const stripe::Block& block);
-  void GenerateArena(const stripe::Block& block);
   llvm::Function* CompileXSMMBlock(const stripe::Block& block, const XSMMDispatch xsmmDispatch,
                                    const XSMMCallData& xsmmCallData);
   llvm::Function* CompileThreadedBlock(const stripe::Block& block);
@@ -176,6 +179,8 @@ class Compiler : private stripe::ConstStmtVisitor {
   llvm::Value* Malloc(size_t size);
   void Free(llvm::Value* buffer);
   llvm::Value* PrngStepFunction();
+  // Declares one of the void functions the runtime provides (see specials.h).
+  llvm::Value* RuntimeFunction(const char* funcname, const std::vector<llvm::Type*>& argtypes);
   llvm::Value* ReadCycleCounter();
   void ProfileBlockEnter(const stripe::Block& block);
   void ProfileBlockLeave(const stripe::Block& block);
@@ -187,6 +192,11 @@ class Compiler : private stripe::ConstStmtVisitor {
   void EmitRunTimeLogEntry(const std::string& str, const std::string& extra, llvm::Value* value = nullptr);
   void PrintOutputAssembly(llvm::TargetMachine* machine);
   void AggInit(const Buffer& dest, llvm::Value* init_val);
+  void MemCopy(const Buffer& dst, const Buffer& src, size_t size);
+  // Hand packed gathers and scatters to the runtime; false if the tensors
+  // don't qualify and a loop nest must be generated instead.
+  bool GatherRows(const Buffer& data, const Buffer& indices, const Buffer& dest);
+  bool ScatterRows(const Buffer& data, const Buffer& indices, const Buffer& output);
   void ParallelFor(llvm::Value* refs, llvm::Value* idxs, size_t range, llvm::Function* func);
   CompileFor getCompileFor(const stripe::Block& block);
 
@@ -204,6 +214,9 @@ class Compiler : private stripe::ConstStmtVisitor {
   std::map<std::string, Buffer> buffers_;
   std::map<std::string, Index> indexes_;
   uint64_t arenaSize_ = 0;
+  // The arena for the current invocation, as seen by the function being
+  // compiled; placed refinements are addressed relative to it.
+  llvm::Value* arena_ = nullptr;
 };
 
 }  // namespace cpu
@@ -26,6 +26,22 @@ struct Config {
   bool print_llvm_ir_simple = VLOG_IS_ON(3);
   bool print_llvm_ir_optimized = VLOG_IS_ON(4);
   bool print_assembly = VLOG_IS_ON(4);
+  // The CPU name and LLVM feature string (e.g. "+avx2,+fma") to generate code
+  // for. When target_cpu is empty, the host processor is detected and used;
+  // set these to cross-target or to pin the generated code for reproducibility.
+  std::string target_cpu;
+  std::string target_features;
+  // When set, compiled programs are stored in (and loaded from) a persistent
+  // object code cache in this directory, bounded to cache_max_bytes.
+  std::string cache_dir;
+  uint64_t cache_max_bytes = 1ull << 30;
+  // When set, fp32 transcendentals call the bundled vector math library
+  // (see vecmath.h) rather than libm, so that loops over them can vectorize.
+  bool vector_math = true;
+  // The number of threads which optimize and generate code for the program's
+  // kernels, each working on a separate module; zero uses every hardware
+  // thread, and one compiles the whole program as a single module.
+  unsigned compile_threads = 0;
   std::map<std::string, External> externals;
 };
 
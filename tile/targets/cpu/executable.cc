@@ -5,9 +5,11 @@
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Object/ObjectFile.h>
 #include <llvm/Support/DynamicLibrary.h>
 #include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
@@ -16,8 +18,12 @@
 #include <algorithm>
 #include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include <boost/align/aligned_alloc.hpp>
 #include <half.hpp>
 
 #include "base/util/env.h"
@@ -25,6 +31,8 @@
 #include "tbb/tbb.h"
 #include "tile/stripe/stripe.h"
 #include "tile/targets/cpu/link_names.h"
+#include "tile/targets/cpu/specials.h"
+#include "tile/targets/cpu/vecmath.h"
 
 #if defined(_WIN32)
 // As of 2019-08-01, libxsmm doesn't compile on Windows if UNICODE is defined, since it passes
@@ -41,6 +49,10 @@ namespace tile {
 namespace targets {
 namespace cpu {
 
+// Arenas are aligned to a cache line, which also satisfies the alignment
+// requirements of any vector type the generated code may use.
+constexpr size_t kArenaAlignment = 64;
+
 class Runtime : public llvm::LegacyJITSymbolResolver {
  public:
   explicit Runtime(const std::map<std::string, void*> externals) : externals_(externals) {}
@@ -51,23 +63,123 @@ class Runtime : public llvm::LegacyJITSymbolResolver {
   std::map<std::string, void*> externals_;
 };
 
-Executable::Executable(const ProgramModule& module) : parameters_(module.parameters) {
+// Captures the object code MCJIT generates for a module, so that it can be
+// saved and reloaded later without recompiling.
+class ObjectRecorder : public llvm::ObjectCache {
+ public:
+  explicit ObjectRecorder(std::vector<std::string>* objects) : objects_(objects) {}
+  void notifyObjectCompiled(const llvm::Module*, llvm::MemoryBufferRef obj) override {
+    objects_->emplace_back(obj.getBufferStart(), obj.getBufferSize());
+  }
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module*) override { return nullptr; }
+
+ private:
+  std::vector<std::string>* objects_;
+};
+
+namespace {
+
+// libxsmm's target architecture is a process-wide setting which it reads while
+// dispatching kernels, so changing it under running programs is a race. It is
+// set once, by the first executable; programs in one process share a target
+// unless it is pinned differently per config.
+void SetXSMMArch(const std::string& arch) {
+  static std::once_flag once;
+  static std::string current;
+  std::call_once(once, [&] {
+    current = arch;
+    libxsmm_set_target_arch(arch.c_str());
+  });
+  if (arch != current) {
+    LOG(WARNING) << "libxsmm already targets " << current << "; not switching to " << arch;
+  }
+}
+
+}  // namespace
+
+ArenaPool::~ArenaPool() {
+  for (auto arena : free_) {
+    boost::alignment::aligned_free(arena);
+  }
+}
+
+void* ArenaPool::Acquire() {
+  if (!size_) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock{mu_};
+    if (free_.size()) {
+      auto arena = free_.back();
+      free_.pop_back();
+      return arena;
+    }
+  }
+  auto arena = boost::alignment::aligned_alloc(kArenaAlignment, size_);
+  if (!arena) {
+    throw std::bad_alloc();
+  }
+  return arena;
+}
+
+void ArenaPool::Release(void* arena) {
+  if (arena) {
+    std::lock_guard<std::mutex> lock{mu_};
+    free_.push_back(arena);
+  }
+}
+
+Executable::Executable(const ProgramModule& module, std::vector<std::string>* objects)
+    : parameters_(module.parameters), arenas_(module.arena_size) {
   std::string errStr;
   std::unique_ptr<llvm::LegacyJITSymbolResolver> rez(new Runtime(module.externals));
   assert(module.module);
-  std::unique_ptr<llvm::Module> clone(llvm::CloneModule(*module.module));
+  std::unique_ptr<llvm::Module> clone;
+  if (module.objects.empty()) {
+    clone = llvm::CloneModule(*module.module);
+  } else {
+    // The engine needs a module, but the code comes from the objects.
+    clone = std::make_unique<llvm::Module>("stripe", module.module->getContext());
+    clone->setTargetTriple(module.module->getTargetTriple());
+  }
   auto ee = llvm::EngineBuilder(std::move(clone))
                 .setErrorStr(&errStr)
                 .setEngineKind(llvm::EngineKind::JIT)
                 .setVerifyModules(true)
                 .setSymbolResolver(std::move(rez))
+                .setMCPU(module.target.cpu)
+                .setMAttrs(module.target.attrs())
                 .create();
   if (ee) {
     if (env::Get("VTUNE_PROFILE") == "1") {
       ee->RegisterJITEventListener(llvm::JITEventListener::createIntelJITEventListener());
     }
-    ee->finalizeObject();
     engine_.reset(ee);
+    // The objects are linked to each other as they are loaded.
+    for (const auto& object : module.objects) {
+      auto buffer = llvm::MemoryBuffer::getMemBufferCopy(object, "stripe");
+      auto obj = llvm::object::ObjectFile::createObjectFile(buffer->getMemBufferRef());
+      if (!obj) {
+        throw std::runtime_error("Failed to load object code: " + llvm::toString(obj.takeError()));
+      }
+      ee->addObjectFile(llvm::object::OwningBinary<llvm::object::ObjectFile>(std::move(*obj), std::move(buffer)));
+    }
+    ObjectRecorder recorder(objects);
+    if (objects) {
+      *objects = module.objects;
+      ee->setObjectCache(&recorder);
+    }
+    ee->finalizeObject();
+    ee->setObjectCache(nullptr);
+    // Resolve the entrypoint once; looking it up by name takes the engine's
+    // lock and a symbol table search, which is too costly to do per call.
+    entrypoint_ = reinterpret_cast<void (*)(void* const*, void*)>(ee->getFunctionAddress(invoker_name_));
+    if (!entrypoint_) {
+      throw std::runtime_error("Failed to resolve the program entrypoint");
+    }
+    // Make libxsmm generate its kernels for the same instruction set as the
+    // rest of the program.
+    SetXSMMArch(GetXSMMArch(module.target));
   } else {
     throw std::runtime_error("Failed to create ExecutionEngine: " + errStr);
   }
@@ -78,14 +190,21 @@ void Executable::Run(const std::map<std::string, void*>& buffers) {
   for (size_t i = 0; i < args.size(); ++i) {
     args[i] = safe_at(buffers, parameters_[i]);
   }
-  void* argvec = args.data();
-  uint64_t entrypoint = engine_->getFunctionAddress(invoker_name_);
-  // To get the raw execution time for generated code.
-  auto start = std::chrono::high_resolution_clock::now();
-  ((void (*)(void*))entrypoint)(argvec);
-  auto stop = std::chrono::high_resolution_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
-  IVLOG(1, "Total program execution duration: " << diff)
+  Invoke(args.data());
+}
+
+void Executable::Invoke(void* const* args) {
+  ArenaPool::Lease arena{&arenas_};
+  if (VLOG_IS_ON(1)) {
+    // To get the raw execution time for generated code.
+    auto start = std::chrono::high_resolution_clock::now();
+    entrypoint_(args, arena.get());
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto diff = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    IVLOG(1, "Total program execution duration: " << diff)
+  } else {
+    entrypoint_(args, arena.get());
+  }
 }
 
 void Executable::SetPerfAttrs(stripe::Block* block) {
@@ -170,6 +289,13 @@ llvm::JITSymbol Runtime::findSymbol(const std::string& name) {
       {"_RunTimeLogEntry", symInfo(rt::RunTimeLogEntry)},  // For debugging
       {"_XSMMRTCaller", symInfo(rt::XSMMRTCaller)},
       {"_ParallelFor", symInfo(rt::ParallelFor)},
+      {"_GatherRows", symInfo(rt::GatherRows)},
+      {"_ParallelCopy", symInfo(rt::ParallelCopy)},
+      {"_ParallelZero", symInfo(rt::ParallelZero)},
+      {"_ScatterAddRowsF32", symInfo(rt::ScatterAddRowsF32)},
+      {"_ScatterAddRowsF64", symInfo(rt::ScatterAddRowsF64)},
+      {"_ScatterAddRowsI32", symInfo(rt::ScatterAddRowsI32)},
+      {"_ScatterAddRowsI64", symInfo(rt::ScatterAddRowsI64)},
       {"libxsmm_dmmdispatch", symInfo(libxsmm_dmmdispatch)},
       {"libxsmm_smmdispatch", symInfo(libxsmm_smmdispatch)},
       {"libxsmm_wimmdispatch", symInfo(libxsmm_wimmdispatch)},
@@ -177,11 +303,32 @@ llvm::JITSymbol Runtime::findSymbol(const std::string& name) {
       {"RunTimeLogEntry", symInfo(rt::RunTimeLogEntry)},  // For debugging
       {"XSMMRTCaller", symInfo(rt::XSMMRTCaller)},
       {"ParallelFor", symInfo(rt::ParallelFor)},
+      {"GatherRows", symInfo(rt::GatherRows)},
+      {"ParallelCopy", symInfo(rt::ParallelCopy)},
+      {"ParallelZero", symInfo(rt::ParallelZero)},
+      {"ScatterAddRowsF32", symInfo(rt::ScatterAddRowsF32)},
+      {"ScatterAddRowsF64", symInfo(rt::ScatterAddRowsF64)},
+      {"ScatterAddRowsI32", symInfo(rt::ScatterAddRowsI32)},
+      {"ScatterAddRowsI64", symInfo(rt::ScatterAddRowsI64)},
   };
   auto loc_rt = symbols.find(name);
   if (loc_rt != symbols.end()) {
     return loc_rt->second;
   }
+  static std::map<std::string, llvm::JITEvaluatedSymbol> vecmath_symbols = []() {
+    std::map<std::string, llvm::JITEvaluatedSymbol> ret;
+    for (const auto& func : VecMathFunctions()) {
+      ret.emplace(func.name, symInfo(func.ptr));
+      for (const auto& variant : func.variants) {
+        ret.emplace(variant.name, symInfo(variant.ptr));
+      }
+    }
+    return ret;
+  }();
+  auto loc_vecmath = vecmath_symbols.find(name.size() > 1 && name[0] == '_' ? name.substr(1) : name);
+  if (loc_vecmath != vecmath_symbols.end()) {
+    return loc_vecmath->second;
+  }
   auto loc_extern = externals_.find(name);
   if (loc_extern != externals_.end()) {
     return symInfo(loc_extern->second);
@@ -6,6 +6,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,16 +18,58 @@ namespace tile {
 namespace targets {
 namespace cpu {
 
+// A pool of program arenas. Each invocation takes exclusive use of one arena
+// for its placed temporaries, returning it to the pool when it completes, so
+// that concurrent invocations never share memory.
+class ArenaPool {
+ public:
+  // Holds an arena for the duration of an invocation, returning it to the
+  // pool even if the invocation throws.
+  class Lease {
+   public:
+    explicit Lease(ArenaPool* pool) : pool_{pool}, arena_{pool->Acquire()} {}
+    ~Lease() { pool_->Release(arena_); }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    void* get() const { return arena_; }
+
+   private:
+    ArenaPool* pool_;
+    void* arena_;
+  };
+
+  explicit ArenaPool(uint64_t size) : size_(size) {}
+  ~ArenaPool();
+
+  void* Acquire();
+  void Release(void* arena);
+
+ private:
+  uint64_t size_;
+  std::mutex mu_;
+  std::vector<void*> free_;
+};
+
 class Executable {
  public:
-  explicit Executable(const ProgramModule& module);
+  // Creates an executable for the module. If objects is not null, it receives
+  // a copy of the object code which makes up the program.
+  explicit Executable(const ProgramModule& module, std::vector<std::string>* objects = nullptr);
   void Run(const std::map<std::string, void*>& buffers);
+  // Runs the program with buffers supplied positionally, in parameters()
+  // order. Performs no name lookups and, once the arena pool is warm, no
+  // allocations.
+  void Invoke(void* const* args);
+  const std::vector<std::string>& parameters() const { return parameters_; }
   void Save(const std::string& filename);
   void SetPerfAttrs(stripe::Block* block);
 
  private:
   std::unique_ptr<llvm::ExecutionEngine> engine_;
+  void (*entrypoint_)(void* const*, void*) = nullptr;
   std::vector<std::string> parameters_;
+  ArenaPool arenas_;
 };
 
 }  // namespace cpu
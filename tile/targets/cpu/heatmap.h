@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <iostream>
 #include <map>
 #include <tuple>
 
@@ -11,4 +14,39 @@ extern uint64_t kHeatmapSize;
 extern uint16_t kHeatmapKeys[][3];
 extern float kHeatmapValues[];
 
+// Maps a matrix multiplication's (M, N, K) to its measured GFLOPS.
+using HeatmapKey = std::tuple<unsigned, unsigned, unsigned>;
+using Heatmap = std::map<HeatmapKey, double>;
+
+// The heatmap compiled into this library.
+Heatmap BuiltinHeatmap();
+
+// Reads and writes heatmaps as CSV, with an "M,N,K,GFLOPS" header.
+Heatmap ReadHeatmap(std::istream& is);
+void WriteHeatmap(std::ostream& os, const Heatmap& heatmap);
+
+// The heatmap for the current host, loaded once.  If PLAIDML_CPU_HEATMAP names
+// a readable file, it is used; if the file does not exist and
+// PLAIDML_CPU_HEATMAP_CALIBRATE is set, the host is calibrated and the result
+// is written there.  Otherwise, the builtin heatmap is used.
+const Heatmap& HostHeatmap();
+
+struct CalibrationOptions {
+  // Each of M, N, and K is swept over [min_size, max_size] by step.
+  unsigned min_size = 2;
+  unsigned max_size = 100;
+  unsigned step = 2;
+  // The minimum time spent timing each kernel.
+  double min_seconds = 0.005;
+};
+
+// Measures the GFLOPS of an fp32 libxsmm kernel for (m, n, k) on this host;
+// returns 0 if libxsmm cannot generate the kernel.
+double MeasureThroughput(unsigned m, unsigned n, unsigned k, double min_seconds);
+
+// Measures the whole (M, N, K) search space on this host.  If given, progress
+// is invoked after each measurement.
+Heatmap CalibrateHeatmap(const CalibrationOptions& options,
+                         const std::function<void(const HeatmapKey&, double)>& progress = nullptr);
+
 }  // namespace vertexai::tile::targets::cpu
@@ -0,0 +1,148 @@
+// Copyright 2020, Intel Corporation
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "base/util/env.h"
+#include "base/util/logging.h"
+#include "tile/targets/cpu/heatmap.h"
+
+#include "libxsmm.h"  // NOLINT
+
+namespace vertexai::tile::targets::cpu {
+
+Heatmap BuiltinHeatmap() {
+  Heatmap heatmap;
+  for (unsigned i = 0; i < kHeatmapSize; ++i) {
+    heatmap.emplace(std::make_tuple(kHeatmapKeys[i][0], kHeatmapKeys[i][1], kHeatmapKeys[i][2]), kHeatmapValues[i]);
+  }
+  return heatmap;
+}
+
+Heatmap ReadHeatmap(std::istream& is) {
+  Heatmap heatmap;
+  std::string line;
+  if (!std::getline(is, line) || line.compare(0, 12, "M,N,K,GFLOPS") != 0) {
+    throw std::runtime_error("Heatmap is missing its M,N,K,GFLOPS header");
+  }
+  while (std::getline(is, line)) {
+    if (line.empty() || line == "\r") {
+      continue;
+    }
+    std::istringstream row(line);
+    unsigned m, n, k;
+    double gflops;
+    char c1, c2, c3;
+    if (!(row >> m >> c1 >> n >> c2 >> k >> c3 >> gflops) || c1 != ',' || c2 != ',' || c3 != ',') {
+      throw std::runtime_error("Malformed heatmap row: " + line);
+    }
+    heatmap[std::make_tuple(m, n, k)] = gflops;
+  }
+  return heatmap;
+}
+
+void WriteHeatmap(std::ostream& os, const Heatmap& heatmap) {
+  os << "M,N,K,GFLOPS\n";
+  for (const auto& kvp : heatmap) {
+    os << std::get<0>(kvp.first) << ',' << std::get<1>(kvp.first) << ',' << std::get<2>(kvp.first) << ','
+       << kvp.second << '\n';
+  }
+}
+
+namespace {
+
+Heatmap LoadHostHeatmap() {
+  auto path = env::Get("PLAIDML_CPU_HEATMAP");
+  if (path.empty()) {
+    return BuiltinHeatmap();
+  }
+  std::ifstream ifs(path);
+  if (ifs) {
+    try {
+      auto heatmap = ReadHeatmap(ifs);
+      IVLOG(1, "Loaded " << heatmap.size() << " heatmap entries from " << path);
+      return heatmap;
+    } catch (const std::exception& ex) {
+      LOG(WARNING) << "Unable to load heatmap from " << path << ": " << ex.what() << "; using the builtin heatmap";
+      return BuiltinHeatmap();
+    }
+  }
+  if (env::Get("PLAIDML_CPU_HEATMAP_CALIBRATE").empty()) {
+    LOG(WARNING) << "Heatmap " << path << " does not exist; using the builtin heatmap";
+    return BuiltinHeatmap();
+  }
+  LOG(INFO) << "Calibrating the CPU heatmap into " << path << "; this may take several minutes";
+  auto heatmap = CalibrateHeatmap(CalibrationOptions{});
+  std::ofstream ofs(path);
+  WriteHeatmap(ofs, heatmap);
+  if (!ofs) {
+    LOG(WARNING) << "Unable to write heatmap to " << path;
+  }
+  return heatmap;
+}
+
+}  // namespace
+
+const Heatmap& HostHeatmap() {
+  static Heatmap heatmap = LoadHostHeatmap();
+  return heatmap;
+}
+
+double MeasureThroughput(unsigned m, unsigned n, unsigned k, double min_seconds) {
+  // libxsmm is column-major: C(m, n) += A(m, k) * B(k, n).
+  libxsmm_blasint lda = m;
+  libxsmm_blasint ldb = k;
+  libxsmm_blasint ldc = m;
+  float alpha = 1.0f;
+  float beta = 1.0f;
+  auto kernel = libxsmm_smmdispatch(m, n, k, &lda, &ldb, &ldc, &alpha, &beta, nullptr, nullptr);
+  if (!kernel) {
+    return 0;
+  }
+  std::vector<float> a(m * k, 1.0f);
+  std::vector<float> b(k * n, 1.0f);
+  std::vector<float> c(m * n, 0.0f);
+  kernel(a.data(), b.data(), c.data());  // Warm up the caches.
+  using clock = std::chrono::steady_clock;
+  size_t iterations = 0;
+  std::chrono::duration<double> elapsed{0};
+  for (size_t batch = 16; elapsed.count() < min_seconds; batch *= 2) {
+    auto start = clock::now();
+    for (size_t i = 0; i < batch; i++) {
+      kernel(a.data(), b.data(), c.data());
+    }
+    elapsed += clock::now() - start;
+    iterations += batch;
+  }
+  return 2.0 * m * n * k * iterations / elapsed.count() / 1e9;
+}
+
+Heatmap CalibrateHeatmap(const CalibrationOptions& options,
+                         const std::function<void(const HeatmapKey&, double)>& progress) {
+  if (!options.step || options.min_size > options.max_size) {
+    throw std::runtime_error("Invalid heatmap calibration range");
+  }
+  libxsmm_init();
+  Heatmap heatmap;
+  for (unsigned m = options.min_size; m <= options.max_size; m += options.step) {
+    for (unsigned n = options.min_size; n <= options.max_size; n += options.step) {
+      for (unsigned k = options.min_size; k <= options.max_size; k += options.step) {
+        auto key = std::make_tuple(m, n, k);
+        double gflops = MeasureThroughput(m, n, k, options.min_seconds);
+        if (gflops > 0) {
+          heatmap.emplace(key, gflops);
+        }
+        if (progress) {
+          progress(key, gflops);
+        }
+      }
+    }
+  }
+  return heatmap;
+}
+
+}  // namespace vertexai::tile::targets::cpu
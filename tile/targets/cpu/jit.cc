@@ -21,6 +21,7 @@
 
 #include "base/util/lookup.h"
 #include "tile/stripe/stripe.h"
+#include "tile/targets/cpu/cache.h"
 #include "tile/targets/cpu/compiler.h"
 #include "tile/targets/cpu/executable.h"
 #include "tile/targets/cpu/link_names.h"
@@ -34,17 +35,53 @@ struct Native::Impl {
   llvm::LLVMContext context;
   ProgramModule module;
   std::unique_ptr<Executable> executable;
+  bool from_cache = false;
 
   void compile(const stripe::Block& program, const Config& config) {
+    from_cache = false;
+    if (config.cache_dir.empty() || !CodeCache::IsCacheable(config)) {
+      Compiler compiler(&context, config);
+      module = compiler.CompileProgram(program);
+      assert(module.module);
+      executable.reset(new Executable(module));
+      return;
+    }
+    CodeCache cache(config.cache_dir, config.cache_max_bytes);
+    auto target = GetTarget(config);
+    auto key = CodeCache::MakeKey(program, config, target);
+    CodeCache::Entry entry;
+    if (cache.Load(key, &entry)) {
+      // The executable will load the cached object code into an otherwise
+      // empty module.
+      module.module = std::make_unique<llvm::Module>("stripe", context);
+      module.module->setTargetTriple(target.triple);
+      module.parameters = std::move(entry.parameters);
+      module.target = target;
+      module.arena_size = entry.arena_size;
+      module.objects = std::move(entry.objects);
+      executable.reset(new Executable(module));
+      from_cache = true;
+      return;
+    }
     Compiler compiler(&context, config);
     module = compiler.CompileProgram(program);
     assert(module.module);
-    executable.reset(new Executable(module));
+    executable.reset(new Executable(module, &entry.objects));
+    entry.arena_size = module.arena_size;
+    entry.parameters = module.parameters;
+    cache.Store(key, entry);
   }
 
   void run(const std::map<std::string, void*>& buffers) { executable->Run(buffers); }
 
+  void invoke(void* const* args) { executable->Invoke(args); }
+
   void save(const std::string& filename) {
+    // Programs compiled in parallel keep their module as it was before
+    // optimization; only programs loaded from the code cache have none.
+    if (module.module->empty() && !module.objects.empty()) {
+      throw std::runtime_error("Unable to save bitcode for a program loaded from the code cache");
+    }
     std::error_code ec;
     llvm::ToolOutputFile result(filename, ec, llvm::sys::fs::F_None);
     WriteBitcodeToFile(*module.module, result.os());
@@ -58,6 +95,9 @@ Native::Native() : m_impl(new Native::Impl) {}
 Native::~Native() {}
 void Native::compile(const stripe::Block& program, const Config& config) { m_impl->compile(program, config); }
 void Native::run(const std::map<std::string, void*>& buffers) { m_impl->run(buffers); }
+const std::vector<std::string>& Native::parameters() const { return m_impl->executable->parameters(); }
+void Native::invoke(void* const* args) { m_impl->invoke(args); }
+bool Native::from_cache() const { return m_impl->from_cache; }
 void Native::save(const std::string& filename) { m_impl->save(filename); }
 void Native::set_perf_attrs(stripe::Block* program) { m_impl->set_perf_attrs(program); }
 
@@ -25,6 +25,14 @@ class Native {
 
   void compile(const stripe::Block& program, const Config& config);
   void run(const std::map<std::string, void*>& buffers);
+  // The names of the program's buffer parameters, in slot order.
+  const std::vector<std::string>& parameters() const;
+  // Runs the program with buffers bound positionally: args[i] is the buffer
+  // for parameters()[i]. This is the low-overhead path for callers which
+  // bind their buffers once and invoke the program repeatedly.
+  void invoke(void* const* args);
+  // Whether the last compile() loaded the program from the code cache.
+  bool from_cache() const;
   void save(const std::string& filename);
   void set_perf_attrs(stripe::Block* program);
 };
@@ -8,7 +8,6 @@ namespace targets {
 namespace cpu {
 
 const char invoker_name_[] = "__invoke_";
-const char arena_name_[] = "__arena";
 const char profile_count_name_[] = "__profile_count_";
 const char profile_ticks_name_[] = "__profile_ticks_";
 const char profile_loop_body_name_[] = "__profile_loop_body_";
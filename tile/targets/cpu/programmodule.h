@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+#include "tile/targets/cpu/target.h"
+
 namespace vertexai {
 namespace tile {
 namespace targets {
@@ -18,6 +20,13 @@ struct ProgramModule {
   std::unique_ptr<llvm::Module> module;
   std::vector<std::string> parameters;
   std::map<std::string, void*> externals;
+  Target target;
+  uint64_t arena_size = 0;
+  // Precompiled object code for the program, in one or more relocatable
+  // objects which are linked together when the program is loaded. When this
+  // is present, the object code is loaded in place of the module, which is
+  // either an empty placeholder or the program as it was before optimization.
+  std::vector<std::string> objects;
 };
 
 }  // namespace cpu
@@ -0,0 +1,188 @@
+// Copyright 2020, Intel Corporation
+
+#include "tile/targets/cpu/specials.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "tbb/tbb.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace rt {
+
+namespace {
+
+// The smallest piece of work worth handing to another thread.
+constexpr size_t kGrainBytes = 64 * 1024;
+
+size_t GrainRows(size_t row_bytes) { return std::max<size_t>(1, kGrainBytes / std::max<size_t>(1, row_bytes)); }
+
+uint64_t LoadIndex(const void* indices, size_t i, size_t width, bool is_signed) {
+  switch (width) {
+    case 1:
+      return is_signed ? static_cast<uint64_t>(static_cast<const int8_t*>(indices)[i])
+                       : static_cast<const uint8_t*>(indices)[i];
+    case 2:
+      return is_signed ? static_cast<uint64_t>(static_cast<const int16_t*>(indices)[i])
+                       : static_cast<const uint16_t*>(indices)[i];
+    case 4:
+      return is_signed ? static_cast<uint64_t>(static_cast<const int32_t*>(indices)[i])
+                       : static_cast<const uint32_t*>(indices)[i];
+    default:
+      return static_cast<const uint64_t*>(indices)[i];
+  }
+}
+
+size_t RowIndex(const void* indices, size_t i, size_t width, bool is_signed, size_t rows) {
+  return static_cast<size_t>(std::min<uint64_t>(LoadIndex(indices, i, width, is_signed), rows - 1));
+}
+
+// Copies a row whose size is known at compile time.
+template <size_t N>
+void CopyRow(char* dest, const char* src) {
+  std::memcpy(dest, src, N);
+}
+
+// Integer sums wrap, as they do in the generated code.
+template <typename T>
+T Add(T lhs, T rhs) {
+  if constexpr (std::is_integral<T>::value) {
+    using U = typename std::make_unsigned<T>::type;
+    return static_cast<T>(static_cast<U>(lhs) + static_cast<U>(rhs));
+  } else {
+    return lhs + rhs;
+  }
+}
+
+template <typename T>
+void ScatterAddRows(T* dest, const T* data, const void* indices, size_t count, size_t index_width, bool index_signed,
+                    size_t row_elems, size_t rows) {
+  if (!count || !rows) {
+    return;
+  }
+  auto add_row = [=](size_t to, size_t from) {
+    T* out = dest + to * row_elems;
+    const T* in = data + from * row_elems;
+    for (size_t j = 0; j < row_elems; ++j) {
+      out[j] = Add(out[j], in[j]);
+    }
+  };
+  size_t grain = GrainRows(row_elems * sizeof(T));
+  if (count <= grain) {
+    for (size_t i = 0; i < count; ++i) {
+      add_row(RowIndex(indices, i, index_width, index_signed, rows), i);
+    }
+    return;
+  }
+
+  // Bucket the source rows by destination row, keeping them in their
+  // original order, so that each destination row can be summed independently.
+  std::vector<size_t> targets(count);
+  std::vector<size_t> offsets(rows + 1);
+  for (size_t i = 0; i < count; ++i) {
+    targets[i] = RowIndex(indices, i, index_width, index_signed, rows);
+    ++offsets[targets[i] + 1];
+  }
+  for (size_t r = 0; r < rows; ++r) {
+    offsets[r + 1] += offsets[r];
+  }
+  std::vector<size_t> order(count);
+  std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < count; ++i) {
+    order[cursors[targets[i]]++] = i;
+  }
+
+  // Balance the destination rows by the number of contributions they receive.
+  size_t row_grain = std::max<size_t>(1, rows * grain / count);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, rows, row_grain), [&](const tbb::blocked_range<size_t>& r) {
+    for (size_t row = r.begin(); row != r.end(); ++row) {
+      for (size_t k = offsets[row]; k < offsets[row + 1]; ++k) {
+        add_row(row, order[k]);
+      }
+    }
+  });
+}
+
+}  // namespace
+
+void ParallelZero(void* dest, size_t bytes) {
+  char* out = static_cast<char*>(dest);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, bytes, kGrainBytes), [=](const tbb::blocked_range<size_t>& r) {
+    std::memset(out + r.begin(), 0, r.size());
+  });
+}
+
+void ParallelCopy(void* dest, const void* src, size_t bytes) {
+  char* out = static_cast<char*>(dest);
+  const char* in = static_cast<const char*>(src);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, bytes, kGrainBytes), [=](const tbb::blocked_range<size_t>& r) {
+    std::memcpy(out + r.begin(), in + r.begin(), r.size());
+  });
+}
+
+void GatherRows(void* dest, const void* data, const void* indices, size_t count, size_t index_width,
+                size_t index_signed, size_t row_bytes, size_t rows) {
+  if (!count || !rows) {
+    return;
+  }
+  char* out = static_cast<char*>(dest);
+  const char* table = static_cast<const char*>(data);
+  auto gather = [=](const tbb::blocked_range<size_t>& r) {
+    for (size_t i = r.begin(); i != r.end(); ++i) {
+      size_t row = RowIndex(indices, i, index_width, index_signed != 0, rows);
+      char* to = out + i * row_bytes;
+      const char* from = table + row * row_bytes;
+      switch (row_bytes) {
+        case 4:
+          CopyRow<4>(to, from);
+          break;
+        case 8:
+          CopyRow<8>(to, from);
+          break;
+        case 16:
+          CopyRow<16>(to, from);
+          break;
+        default:
+          std::memcpy(to, from, row_bytes);
+          break;
+      }
+    }
+  };
+  size_t grain = GrainRows(row_bytes);
+  if (count <= grain) {
+    gather(tbb::blocked_range<size_t>(0, count));
+  } else {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, grain), gather);
+  }
+}
+
+void ScatterAddRowsF32(float* dest, const float* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows) {
+  ScatterAddRows(dest, data, indices, count, index_width, index_signed != 0, row_elems, rows);
+}
+
+void ScatterAddRowsF64(double* dest, const double* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows) {
+  ScatterAddRows(dest, data, indices, count, index_width, index_signed != 0, row_elems, rows);
+}
+
+void ScatterAddRowsI32(int32_t* dest, const int32_t* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows) {
+  ScatterAddRows(dest, data, indices, count, index_width, index_signed != 0, row_elems, rows);
+}
+
+void ScatterAddRowsI64(int64_t* dest, const int64_t* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows) {
+  ScatterAddRows(dest, data, indices, count, index_width, index_signed != 0, row_elems, rows);
+}
+
+}  // namespace rt
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,52 @@
+// Copyright 2020, Intel Corporation
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace rt {
+
+// Runtime implementations of the data movement specials.  The compiler calls
+// these in place of its generated loop nests when the tensors involved are
+// densely packed in row-major order; each of them divides its work across the
+// TBB thread pool once there is enough of it to be worth sharing.
+
+// Zero and copy regions of at least this many bytes are handed to the runtime.
+constexpr size_t kParallelCopyBytes = 1 << 20;
+
+void ParallelZero(void* dest, size_t bytes);
+void ParallelCopy(void* dest, const void* src, size_t bytes);
+
+// For each of the `count` entries of `indices`, copies the `row_bytes` bytes
+// of the selected row of `data` (a table of `rows` rows) into the next row of
+// `dest`.  Indices are integers `index_width` bytes wide, sign-extended when
+// `index_signed` is nonzero; like the generated code, the runtime treats them
+// as unsigned and clamps them to the last row of the table.
+void GatherRows(void* dest, const void* data, const void* indices, size_t count, size_t index_width,
+                size_t index_signed, size_t row_bytes, size_t rows);
+
+// For each of the `count` entries of `indices`, adds the next row of `data`
+// (of `row_elems` elements) into the selected row of `dest` (a table of `rows`
+// rows), with the same index handling as GatherRows.  The work is divided by
+// destination row, and each row receives its contributions in the order they
+// appear in `indices`, so the results are identical to a sequential scatter
+// regardless of the number of threads.
+void ScatterAddRowsF32(float* dest, const float* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows);
+void ScatterAddRowsF64(double* dest, const double* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows);
+void ScatterAddRowsI32(int32_t* dest, const int32_t* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows);
+void ScatterAddRowsI64(int64_t* dest, const int64_t* data, const void* indices, size_t count, size_t index_width,
+                       size_t index_signed, size_t row_elems, size_t rows);
+
+}  // namespace rt
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
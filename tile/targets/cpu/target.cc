@@ -0,0 +1,106 @@
+// Copyright 2019, Intel Corp.
+
+#include "tile/targets/cpu/target.h"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Host.h>
+
+#include <sstream>
+
+#include "base/util/logging.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+namespace {
+
+std::string HostFeatures() {
+  llvm::StringMap<bool> features;
+  if (!llvm::sys::getHostCPUFeatures(features)) {
+    return "";
+  }
+  std::ostringstream ss;
+  bool first = true;
+  for (const auto& kvp : features) {
+    if (!first) {
+      ss << ',';
+    }
+    ss << (kvp.second ? '+' : '-') << kvp.first().str();
+    first = false;
+  }
+  return ss.str();
+}
+
+bool HasFeature(const Target& target, const std::string& name) {
+  for (const auto& attr : target.attrs()) {
+    if (attr == "+" + name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+std::vector<std::string> Target::attrs() const {
+  std::vector<std::string> ret;
+  std::istringstream ss(features);
+  std::string attr;
+  while (std::getline(ss, attr, ',')) {
+    if (!attr.empty()) {
+      ret.push_back(attr);
+    }
+  }
+  return ret;
+}
+
+Target GetTarget(const Config& config) {
+  Target ret;
+  ret.triple = llvm::sys::getProcessTriple();
+  if (config.target_cpu.empty()) {
+    ret.cpu = llvm::sys::getHostCPUName().str();
+    // A hand-picked feature list only makes sense alongside an explicit CPU;
+    // when targeting the host, take the feature set the host reports.
+    ret.features = config.target_features.empty() ? HostFeatures() : config.target_features;
+  } else {
+    ret.cpu = config.target_cpu;
+    ret.features = config.target_features;
+  }
+  IVLOG(2, "CPU target: " << ret.triple << " cpu: " << ret.cpu << " features: " << ret.features);
+  return ret;
+}
+
+std::string GetXSMMArch(const Target& target) {
+  if (target.cpu == "generic") {
+    return "generic";
+  }
+  if (HasFeature(target, "avx512f")) {
+    if (HasFeature(target, "avx512bf16")) {
+      return "cpx";
+    }
+    if (HasFeature(target, "avx512vnni")) {
+      return "clx";
+    }
+    if (HasFeature(target, "avx512bw")) {
+      return "skx";
+    }
+    return "knl";
+  }
+  if (HasFeature(target, "avx2")) {
+    return "hsw";
+  }
+  if (HasFeature(target, "avx")) {
+    return "snb";
+  }
+  if (HasFeature(target, "sse4.2")) {
+    return "wsm";
+  }
+  return "generic";
+}
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,37 @@
+// Copyright 2019, Intel Corp.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tile/targets/cpu/config.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// Describes the machine the JIT generates code for.
+struct Target {
+  std::string triple;
+  std::string cpu;
+  std::string features;
+
+  // Returns the feature string split into individual "+feature"/"-feature"
+  // attributes, in the form the ExecutionEngine expects.
+  std::vector<std::string> attrs() const;
+};
+
+// Resolves the code generation target for a config. Any target field the
+// config leaves empty is filled in by detecting the host processor.
+Target GetTarget(const Config& config);
+
+// Returns the libxsmm architecture name (as accepted by
+// libxsmm_set_target_arch) best matching the target's feature set.
+std::string GetXSMMArch(const Target& target);
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
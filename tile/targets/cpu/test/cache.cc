@@ -0,0 +1,125 @@
+// Copyright 2019, Intel Corp.
+
+#include <gmock/gmock.h>
+
+#include <boost/filesystem.hpp>
+
+#include "base/util/file.h"
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/cache.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace fs = boost::filesystem;
+
+using ::testing::ContainerEq;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+namespace {
+
+std::shared_ptr<stripe::Program> MakeAddProgram() {
+  lang::RunInfo runinfo;
+  runinfo.program_name = "add";
+  runinfo.code = "function (A, B) -> (C) { C = A + B; }";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {4}));
+  runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {4}));
+  runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {4}));
+  return GenerateStripe(runinfo);
+}
+
+std::vector<fs::path> CacheEntries(const fs::path& dir) {
+  std::vector<fs::path> ret;
+  for (fs::directory_iterator it(dir), end; it != end; ++it) {
+    ret.push_back(it->path());
+  }
+  return ret;
+}
+
+class CodeCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = fs::temp_directory_path() / fs::unique_path("plaidml-cpu-cache-%%%%-%%%%");
+    config_.cache_dir = dir_.string();
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  std::vector<float> Run() {
+    auto program = MakeAddProgram();
+    std::vector<float> a{1, 2, 3, 4};
+    std::vector<float> b{10, 20, 30, 40};
+    std::vector<float> c(4);
+    Native native;
+    native.compile(*program->entry, config_);
+    native.run({{"A", a.data()}, {"B", b.data()}, {"C", c.data()}});
+    from_cache_ = native.from_cache();
+    return c;
+  }
+
+  fs::path dir_;
+  Config config_;
+  bool from_cache_ = false;
+};
+
+}  // namespace
+
+TEST_F(CodeCacheTest, ReusesObjectCode) {
+  std::vector<float> expected{11, 22, 33, 44};
+  EXPECT_THAT(Run(), ContainerEq(expected));
+  EXPECT_THAT(from_cache_, Eq(false));
+  auto entries = CacheEntries(dir_);
+  ASSERT_THAT(entries, SizeIs(1));
+  // A second compilation must be served from the cache and behave the same.
+  auto mtime = fs::last_write_time(entries[0]);
+  EXPECT_THAT(Run(), ContainerEq(expected));
+  EXPECT_THAT(from_cache_, Eq(true));
+  EXPECT_THAT(CacheEntries(dir_), SizeIs(1));
+  EXPECT_EQ(fs::last_write_time(entries[0]), mtime);
+}
+
+TEST_F(CodeCacheTest, DiscardsCorruptEntries) {
+  std::vector<float> expected{11, 22, 33, 44};
+  EXPECT_THAT(Run(), ContainerEq(expected));
+  auto entries = CacheEntries(dir_);
+  ASSERT_THAT(entries, SizeIs(1));
+  auto contents = ReadFile(entries[0], true);
+  contents[contents.size() / 2] ^= 0xff;
+  WriteFile(entries[0], contents, true);
+  // The corrupt entry is detected, the program is recompiled, and the entry
+  // is replaced.
+  EXPECT_THAT(Run(), ContainerEq(expected));
+  EXPECT_THAT(from_cache_, Eq(false));
+  EXPECT_THAT(CacheEntries(dir_), SizeIs(1));
+  EXPECT_THAT(ReadFile(entries[0], true) == contents, Eq(false));
+}
+
+TEST_F(CodeCacheTest, EvictsBySize) {
+  config_.cache_max_bytes = 0;
+  std::vector<float> expected{11, 22, 33, 44};
+  EXPECT_THAT(Run(), ContainerEq(expected));
+  EXPECT_THAT(CacheEntries(dir_), IsEmpty());
+}
+
+TEST(CodeCache, KeyDependsOnTarget) {
+  auto program = MakeAddProgram();
+  Config config;
+  Target target = GetTarget(config);
+  auto key = CodeCache::MakeKey(*program->entry, config, target);
+  EXPECT_THAT(CodeCache::MakeKey(*program->entry, config, target), Eq(key));
+  target.features += ",-avx2";
+  EXPECT_THAT(CodeCache::MakeKey(*program->entry, config, target) == key, Eq(false));
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
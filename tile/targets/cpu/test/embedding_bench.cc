@@ -0,0 +1,72 @@
+// Copyright 2020, Intel Corporation
+
+// Measures an embedding lookup, a gather of rows from a table, which the
+// generated code hands to the runtime's parallel row copies.  Arguments are
+// the embedding width and the number of rows looked up.
+//
+// Run with: bazel run //tile/targets/cpu/test:bench -- --benchmark_filter=Embedding
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace bench {
+
+namespace {
+
+const size_t kTableRows = 100000;
+
+void EmbeddingArgs(benchmark::internal::Benchmark* b) {
+  for (int width : {16, 64, 256}) {
+    for (int batch : {256, 4096, 65536}) {
+      b->Args({width, batch});
+    }
+  }
+}
+
+}  // namespace
+
+void EmbeddingGather(benchmark::State& state) {  // NOLINT[runtime/references]
+  size_t width = state.range(0);
+  size_t batch = state.range(1);
+  lang::RunInfo runinfo;
+  runinfo.program_name = "embedding";
+  runinfo.code = "function (E, I) -> (O) { O = gather(E, I); }";
+  runinfo.input_shapes.emplace("E", SimpleShape(DataType::FLOAT32, {kTableRows, width}));
+  runinfo.input_shapes.emplace("I", SimpleShape(DataType::INT32, {batch}));
+  runinfo.output_shapes.emplace("O", SimpleShape(DataType::FLOAT32, {batch, width}));
+  auto program = GenerateStripe(runinfo);
+  Native native;
+  native.compile(*program->entry, Config{});
+
+  std::vector<float> table(kTableRows * width, 1.0f);
+  std::vector<int32_t> indices(batch);
+  for (size_t i = 0; i < batch; ++i) {
+    indices[i] = (i * 7919) % kTableRows;
+  }
+  std::vector<float> output(batch * width);
+  std::map<std::string, void*> buffers{{"E", table.data()}, {"I", indices.data()}, {"O", output.data()}};
+
+  for (auto _ : state) {
+    native.run(buffers);
+  }
+  state.SetBytesProcessed(state.iterations() * batch * width * sizeof(float));
+}
+
+BENCHMARK(EmbeddingGather)->Apply(EmbeddingArgs)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}  // namespace bench
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
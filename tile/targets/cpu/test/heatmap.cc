@@ -0,0 +1,54 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <sstream>
+
+#include "tile/targets/cpu/heatmap.h"
+
+using ::testing::Eq;
+using ::testing::Gt;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+TEST(Heatmap, RoundTrip) {
+  Heatmap heatmap;
+  heatmap[std::make_tuple(2u, 4u, 6u)] = 1.5;
+  heatmap[std::make_tuple(16u, 16u, 16u)] = 42.25;
+  std::stringstream ss;
+  WriteHeatmap(ss, heatmap);
+  EXPECT_THAT(ReadHeatmap(ss), Eq(heatmap));
+}
+
+TEST(Heatmap, RejectsMissingHeader) {
+  std::stringstream ss("2,4,6,1.5\n");
+  EXPECT_THROW(ReadHeatmap(ss), std::runtime_error);
+}
+
+TEST(Heatmap, Builtin) {  //
+  EXPECT_THAT(BuiltinHeatmap().size(), Eq(kHeatmapSize));
+}
+
+TEST(Heatmap, Calibrate) {
+  CalibrationOptions options;
+  options.min_size = 4;
+  options.max_size = 8;
+  options.step = 4;
+  options.min_seconds = 0.0001;
+  size_t measured = 0;
+  auto heatmap = CalibrateHeatmap(options, [&](const HeatmapKey& key, double gflops) { measured++; });
+  EXPECT_THAT(measured, Eq(8));
+  for (const auto& kvp : heatmap) {
+    EXPECT_THAT(kvp.second, Gt(0));
+  }
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
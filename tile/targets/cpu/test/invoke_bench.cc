@@ -0,0 +1,76 @@
+// Copyright 2019, Intel Corp.
+
+// Measures the host-side overhead of invoking a trivial JIT'd program, by
+// name through Native::run and positionally through Native::invoke.
+//
+// Run with: bazel run //tile/targets/cpu/test:bench -- --benchmark_filter=Invoke
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace bench {
+
+namespace {
+
+class Trivial {
+ public:
+  Trivial() : a_(1), b_(1), c_(1) {
+    lang::RunInfo runinfo;
+    runinfo.program_name = "trivial";
+    runinfo.code = "function (A, B) -> (C) { C = A + B; }";
+    runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {1}));
+    runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {1}));
+    runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {1}));
+    auto program = GenerateStripe(runinfo);
+    native_.compile(*program->entry, Config{});
+    buffers_ = {{"A", a_.data()}, {"B", b_.data()}, {"C", c_.data()}};
+    for (const auto& name : native_.parameters()) {
+      args_.push_back(buffers_.at(name));
+    }
+  }
+
+  Native native_;
+  std::vector<float> a_;
+  std::vector<float> b_;
+  std::vector<float> c_;
+  std::map<std::string, void*> buffers_;
+  std::vector<void*> args_;
+};
+
+}  // namespace
+
+void InvokeByName(benchmark::State& state) {  // NOLINT[runtime/references]
+  Trivial trivial;
+  for (auto _ : state) {
+    trivial.native_.run(trivial.buffers_);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void InvokePositional(benchmark::State& state) {  // NOLINT[runtime/references]
+  Trivial trivial;
+  for (auto _ : state) {
+    trivial.native_.invoke(trivial.args_.data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(InvokeByName)->Unit(benchmark::kNanosecond);
+BENCHMARK(InvokePositional)->Unit(benchmark::kNanosecond);
+
+}  // namespace bench
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
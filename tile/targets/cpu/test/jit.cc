@@ -3,12 +3,16 @@
 #include <gmock/gmock.h>
 #include <google/protobuf/text_format.h>
 
+#include <thread>
+
 #include "tile/codegen/tile.h"
 #include "tile/lang/gen_stripe.h"
 #include "tile/lang/runinfo.h"
 #include "tile/stripe/stripe.h"
 #include "tile/stripe/stripe.pb.h"
+#include "tile/targets/cpu/executable.h"
 #include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/vecmath.h"
 
 namespace gp = google::protobuf;
 
@@ -1107,6 +1111,277 @@ TEST(Jit, JitSpecialZero) {
   EXPECT_THAT(b1[3], Eq(0));
 }
 
+TEST(Jit, JitThreadedConstraints) {
+  // A cpu_thread block is split into chunks which may begin and end mid-row;
+  // the constraint on j alone is checked per row, the constraint on i per
+  // element.
+  stripe::proto::Block input_proto;
+  gp::TextFormat::ParseFromString(R"(
+    loc {}
+    refs [
+      {
+        key: "B"
+        value {
+          loc {}
+          attrs: { key: "user" value: {} }
+          dir: 2
+          interior_shape { type: FLOAT32 dims: {size:9 stride:7} dims: {size:7 stride:1} }
+          access { }
+          access { }
+        }
+      }
+    ]
+    stmts { block {
+      idxs { name: "i" range: 7 }
+      idxs { name: "j" range: 9 }
+      constraints { terms {key:"i" value:1} terms {key:"j" value:-1} }
+      constraints { offset: -2 terms {key:"j" value:1} }
+      refs [
+        {
+          key: "B"
+          value {
+            dir: 2
+            from: "B"
+            interior_shape { type: FLOAT32 dims: {size:1 stride:7} dims: {size:1 stride:1} }
+            access { terms {key:"j" value:1} }
+            access { terms {key:"i" value:1} }
+          }
+        }
+      ]
+      stmts { constant { name:"$one" fconst: 1 } }
+      stmts { store { from:"$one" into:"B"} }
+    } }
+  )",
+                                  &input_proto);
+  std::shared_ptr<stripe::Block> block{stripe::FromProto(input_proto)};
+  block->SubBlock(0)->set_tag("cpu_thread");
+
+  std::vector<float> B(9 * 7, 0);
+  std::vector<float> expected(9 * 7, 0);
+  for (int j = 0; j < 9; ++j) {
+    for (int i = 0; i < 7; ++i) {
+      if (i >= j && j >= 2) {
+        expected[j * 7 + i] = 1;
+      }
+    }
+  }
+
+  std::map<std::string, void*> buffers{{"B", B.data()}};
+  JitExecute(*block, buffers);
+
+  EXPECT_THAT(B, ContainerEq(expected));
+}
+
+TEST(Jit, JitConcurrentRuns) {
+  // Each invocation stages its input through a placed arena buffer before
+  // writing the output; concurrent invocations of one executable must each
+  // get their own arena.
+  stripe::proto::Block input_proto;
+  gp::TextFormat::ParseFromString(R"(
+    loc {}
+    refs [
+      {
+        key: "A"
+        value {
+          loc {}
+          attrs: { key: "user" value: {} }
+          dir: 1
+          interior_shape { type: FLOAT32 dims: {size:256 stride:1} }
+          access { }
+        }
+      },
+      {
+        key: "B"
+        value {
+          loc {}
+          attrs: { key: "user" value: {} }
+          dir: 2
+          interior_shape { type: FLOAT32 dims: {size:256 stride:1} }
+          access { }
+        }
+      }
+    ]
+    stmts { block {
+      refs [
+        {
+          key: "A"
+          value {
+            dir: 1
+            from: "A"
+            interior_shape { type: FLOAT32 dims: {size:256 stride:1} }
+            access { }
+          }
+        },
+        {
+          key: "B"
+          value {
+            dir: 2
+            from: "B"
+            interior_shape { type: FLOAT32 dims: {size:256 stride:1} }
+            access { }
+          }
+        },
+        {
+          key: "T"
+          value {
+            dir: 0
+            offset: 64
+            interior_shape { type: FLOAT32 dims: {size:256 stride:1} }
+            access { }
+            attrs { key: "placed" value {} }
+          }
+        }
+      ]
+      stmts { block {
+        idxs { name: "i" range: 256 }
+        refs [
+          {
+            key: "A"
+            value {
+              dir: 1
+              from: "A"
+              interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+              access { terms {key:"i" value:1} }
+            }
+          },
+          {
+            key: "T"
+            value {
+              dir: 2
+              from: "T"
+              interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+              access { terms {key:"i" value:1} }
+            }
+          }
+        ]
+        stmts { load { from:"A" into:"$a" } }
+        stmts { store { from:"$a" into:"T"} }
+      } }
+      stmts { block {
+        idxs { name: "i" range: 256 }
+        refs [
+          {
+            key: "T"
+            value {
+              dir: 1
+              from: "T"
+              interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+              access { terms {key:"i" value:1} }
+            }
+          },
+          {
+            key: "B"
+            value {
+              dir: 2
+              from: "B"
+              interior_shape { type: FLOAT32 dims: {size:1 stride:1} }
+              access { terms {key:"i" value:1} }
+            }
+          }
+        ]
+        stmts { load { from:"T" into:"$t" } }
+        stmts { store { from:"$t" into:"B"} }
+      } }
+    } }
+  )",
+                                  &input_proto);
+  std::shared_ptr<stripe::Block> block{stripe::FromProto(input_proto)};
+
+  Native native;
+  native.compile(*block, Config{});
+
+  const size_t kThreads = 32;
+  const size_t kIterations = 100;
+  std::vector<size_t> failures(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&native, &failures, t, kIterations]() {
+      std::vector<float> a(256, static_cast<float>(t + 1));
+      std::vector<float> b(256);
+      for (size_t iter = 0; iter < kIterations; ++iter) {
+        std::fill(b.begin(), b.end(), 0);
+        native.run({{"A", a.data()}, {"B", b.data()}});
+        if (b != a) {
+          failures[t]++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(failures, ContainerEq(std::vector<size_t>(kThreads)));
+}
+
+TEST(Jit, JitParallelKernels) {
+  // Kernels compiled into separate objects on separate threads must link up
+  // and compute the same results as a program compiled as a single module.
+  const size_t kSize = 64;
+  lang::RunInfo runinfo;
+  runinfo.program_name = "kernels";
+  runinfo.code = R"(
+    function (A[M, K], B[K, N]) -> (C, D, E) {
+      C[m, n : M, N] = +(A[m, k] * B[k, n]);
+      D = exp(A) + B;
+      E = C * D - A;
+    }
+  )";
+  for (const auto& name : {"A", "B"}) {
+    runinfo.input_shapes.emplace(name, SimpleShape(DataType::FLOAT32, {kSize, kSize}));
+  }
+  for (const auto& name : {"C", "D", "E"}) {
+    runinfo.output_shapes.emplace(name, SimpleShape(DataType::FLOAT32, {kSize, kSize}));
+  }
+  auto program = GenerateStripe(runinfo);
+
+  std::vector<float> A(kSize * kSize);
+  std::vector<float> B(kSize * kSize);
+  for (size_t i = 0; i < A.size(); ++i) {
+    A[i] = static_cast<float>(i % 7) / 7;
+    B[i] = static_cast<float>(i % 5) / 5;
+  }
+  auto run = [&](unsigned threads) {
+    std::vector<std::vector<float>> outputs(3, std::vector<float>(kSize * kSize));
+    std::map<std::string, void*> buffers{
+        {"A", A.data()},
+        {"B", B.data()},
+        {"C", outputs[0].data()},
+        {"D", outputs[1].data()},
+        {"E", outputs[2].data()},
+    };
+    Config config;
+    config.compile_threads = threads;
+    JitExecute(*program->entry, config, buffers);
+    return outputs;
+  };
+  auto serial = run(1);
+  for (size_t i = 0; i < A.size(); ++i) {
+    EXPECT_FLOAT_EQ(serial[1][i], vecmath::Exp(A[i]) + B[i]);
+  }
+  // Compile the parallel path repeatedly, so that each thread's optimizer is
+  // built and torn down several times over.
+  for (int round = 0; round < 3; ++round) {
+    auto parallel = run(4);
+    for (size_t i = 0; i < serial.size(); ++i) {
+      EXPECT_THAT(parallel[i], ContainerEq(serial[i]));
+    }
+  }
+}
+
+TEST(Jit, ArenaLeaseReleasesOnThrow) {
+  ArenaPool pool{256};
+  void* arena = nullptr;
+  try {
+    ArenaPool::Lease lease{&pool};
+    arena = lease.get();
+    throw std::runtime_error("invocation failed");
+  } catch (const std::runtime_error&) {
+  }
+  // The arena went back to the pool, so the next invocation reuses it.
+  ArenaPool::Lease lease{&pool};
+  EXPECT_THAT(lease.get(), Eq(arena));
+}
+
 }  // namespace test
 }  // namespace cpu
 }  // namespace targets
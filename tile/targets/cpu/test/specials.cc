@@ -0,0 +1,121 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/specials.h"
+
+using ::testing::ContainerEq;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+TEST(Specials, GatherRowsClampsIndices) {
+  std::vector<float> data{
+      0, 1, 2,  //
+      3, 4, 5,  //
+      6, 7, 8,  //
+  };
+  std::vector<int32_t> indices{2, 0, 7, -1};
+  std::vector<float> dest(indices.size() * 3);
+  rt::GatherRows(dest.data(), data.data(), indices.data(), indices.size(), sizeof(int32_t), 1, 3 * sizeof(float), 3);
+  std::vector<float> expected{
+      6, 7, 8,  //
+      0, 1, 2,  //
+      6, 7, 8,  //
+      6, 7, 8,  //
+  };
+  EXPECT_THAT(dest, ContainerEq(expected));
+}
+
+TEST(Specials, ScatterAddRowsIsSequential) {
+  // Enough rows to be divided among threads, with many collisions, so that
+  // any reordering of the float sums would be visible.
+  const size_t kCount = 1 << 16;
+  const size_t kRows = 97;
+  const size_t kRowElems = 8;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int64_t> pick(0, kRows - 1);
+  std::uniform_real_distribution<float> value(-1000, 1000);
+  std::vector<int64_t> indices(kCount);
+  for (auto& idx : indices) {
+    idx = pick(rng);
+  }
+  std::vector<float> data(kCount * kRowElems);
+  for (auto& v : data) {
+    v = value(rng);
+  }
+
+  std::vector<float> expected(kRows * kRowElems);
+  for (size_t i = 0; i < kCount; ++i) {
+    for (size_t j = 0; j < kRowElems; ++j) {
+      expected[indices[i] * kRowElems + j] += data[i * kRowElems + j];
+    }
+  }
+  std::vector<float> output(kRows * kRowElems);
+  rt::ScatterAddRowsF32(output.data(), data.data(), indices.data(), kCount, sizeof(int64_t), 1, kRowElems, kRows);
+  EXPECT_THAT(output, ContainerEq(expected));
+}
+
+TEST(Specials, ParallelZeroAndCopy) {
+  std::vector<uint8_t> src(3 * rt::kParallelCopyBytes + 5);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<uint8_t>(i * 7 + 1);
+  }
+  std::vector<uint8_t> dest(src.size());
+  rt::ParallelCopy(dest.data(), src.data(), src.size());
+  EXPECT_THAT(dest, ContainerEq(src));
+  rt::ParallelZero(dest.data(), dest.size());
+  EXPECT_THAT(dest, ContainerEq(std::vector<uint8_t>(src.size())));
+}
+
+TEST(Specials, JitEmbeddingGather) {
+  // A gather of rows from a packed table uses the runtime's row copies.
+  const size_t kRows = 1000;
+  const size_t kWidth = 64;
+  const size_t kBatch = 4096;
+  lang::RunInfo runinfo;
+  runinfo.program_name = "embedding";
+  runinfo.code = "function (E, I) -> (O) { O = gather(E, I); }";
+  runinfo.input_shapes.emplace("E", SimpleShape(DataType::FLOAT32, {kRows, kWidth}));
+  runinfo.input_shapes.emplace("I", SimpleShape(DataType::INT32, {kBatch}));
+  runinfo.output_shapes.emplace("O", SimpleShape(DataType::FLOAT32, {kBatch, kWidth}));
+  auto program = GenerateStripe(runinfo);
+
+  std::vector<float> table(kRows * kWidth);
+  for (size_t i = 0; i < table.size(); ++i) {
+    table[i] = static_cast<float>(i);
+  }
+  std::vector<int32_t> indices(kBatch);
+  for (size_t i = 0; i < kBatch; ++i) {
+    indices[i] = (i * 7919) % kRows;
+  }
+  std::vector<float> output(kBatch * kWidth);
+  std::map<std::string, void*> buffers{{"E", table.data()}, {"I", indices.data()}, {"O", output.data()}};
+  JitExecute(*program->entry, buffers);
+
+  std::vector<float> expected(kBatch * kWidth);
+  for (size_t i = 0; i < kBatch; ++i) {
+    for (size_t j = 0; j < kWidth; ++j) {
+      expected[i * kWidth + j] = table[indices[i] * kWidth + j];
+    }
+  }
+  EXPECT_THAT(output, ContainerEq(expected));
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
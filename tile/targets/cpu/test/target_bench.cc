@@ -0,0 +1,105 @@
+// Copyright 2019, Intel Corp.
+
+// Compares generated code quality when targeting a baseline "generic" x86-64
+// processor against targeting the host processor's full feature set.
+//
+// Run with: bazel run //tile/targets/cpu/test:bench -- --benchmark_filter=Target
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace bench {
+
+namespace {
+
+enum class Network {
+  Conv,
+  MatMul,
+  Eltwise,
+};
+
+lang::RunInfo MakeRunInfo(Network network) {
+  lang::RunInfo runinfo;
+  switch (network) {
+    case Network::Conv:
+      runinfo.program_name = "conv";
+      runinfo.code = R"(
+        function (I[N, X, Y, CI], K[KX, KY, CI, CO]) -> (O) {
+          O[n, x, y, co : N, X - 2, Y - 2, CO] = +(I[n, x + kx, y + ky, ci] * K[kx, ky, ci, co]);
+        })";
+      runinfo.input_shapes.emplace("I", SimpleShape(DataType::FLOAT32, {1, 58, 58, 64}));
+      runinfo.input_shapes.emplace("K", SimpleShape(DataType::FLOAT32, {3, 3, 64, 64}));
+      runinfo.output_shapes.emplace("O", SimpleShape(DataType::FLOAT32, {1, 56, 56, 64}));
+      break;
+    case Network::MatMul:
+      runinfo.program_name = "matmul";
+      runinfo.code = "function (A[M, K], B[K, N]) -> (C) { C[m, n : M, N] = +(A[m, k] * B[k, n]); }";
+      runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {256, 256}));
+      runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {256, 256}));
+      runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {256, 256}));
+      break;
+    case Network::Eltwise:
+      runinfo.program_name = "eltwise";
+      runinfo.code = "function (A, B) -> (C) { C = A * B + A; }";
+      runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {1024, 1024}));
+      runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {1024, 1024}));
+      runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {1024, 1024}));
+      break;
+  }
+  return runinfo;
+}
+
+void RunNetwork(benchmark::State& state, Network network) {  // NOLINT[runtime/references]
+  auto runinfo = MakeRunInfo(network);
+  auto program = GenerateStripe(runinfo);
+  Config config;
+  if (state.range(0) == 0) {
+    config.target_cpu = "generic";
+  }
+  Native native;
+  native.compile(*program->entry, config);
+
+  std::map<std::string, std::vector<char>> storage;
+  std::map<std::string, void*> buffers;
+  for (const auto& shapes : {runinfo.input_shapes, runinfo.output_shapes}) {
+    for (const auto& kvp : shapes) {
+      auto& buf = storage[kvp.first];
+      buf.resize(kvp.second.byte_size());
+      buffers[kvp.first] = buf.data();
+    }
+  }
+
+  for (auto _ : state) {
+    native.run(buffers);
+  }
+  state.SetLabel(state.range(0) == 0 ? "generic" : "host");
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+void TargetConv(benchmark::State& state) { RunNetwork(state, Network::Conv); }        // NOLINT[runtime/references]
+void TargetMatMul(benchmark::State& state) { RunNetwork(state, Network::MatMul); }    // NOLINT[runtime/references]
+void TargetEltwise(benchmark::State& state) { RunNetwork(state, Network::Eltwise); }  // NOLINT[runtime/references]
+
+BENCHMARK(TargetConv)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(TargetMatMul)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(TargetEltwise)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace bench
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,90 @@
+// Copyright 2019, Intel Corp.
+
+// Measures blocks lowered for parallel execution via the cpu_thread tag, where
+// the loop structure of each chunk dominates the cost of cheap kernel bodies.
+//
+// Run with: bazel run //tile/targets/cpu/test:bench -- --benchmark_filter=Threaded
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace bench {
+
+namespace {
+
+void TagThreaded(stripe::Block* block) {
+  for (const auto& stmt : block->stmts) {
+    auto inner = stripe::Block::Downcast(stmt);
+    if (inner) {
+      inner->set_tag("cpu_thread");
+    }
+  }
+}
+
+void RunThreaded(benchmark::State& state, const lang::RunInfo& runinfo) {  // NOLINT[runtime/references]
+  auto program = GenerateStripe(runinfo);
+  TagThreaded(program->entry->SubBlock(0).get());
+  Native native;
+  native.compile(*program->entry, Config{});
+
+  std::map<std::string, std::vector<char>> storage;
+  std::map<std::string, void*> buffers;
+  for (const auto& shapes : {runinfo.input_shapes, runinfo.output_shapes}) {
+    for (const auto& kvp : shapes) {
+      auto& buf = storage[kvp.first];
+      buf.resize(kvp.second.byte_size());
+      buffers[kvp.first] = buf.data();
+    }
+  }
+
+  for (auto _ : state) {
+    native.run(buffers);
+  }
+  state.SetItemsProcessed(state.iterations() * runinfo.output_shapes.begin()->second.elem_size());
+}
+
+}  // namespace
+
+void ThreadedEltwise(benchmark::State& state) {  // NOLINT[runtime/references]
+  lang::RunInfo runinfo;
+  runinfo.program_name = "eltwise";
+  runinfo.code = "function (A, B) -> (C) { C = A * B + A; }";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {64, 64, 256}));
+  runinfo.input_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {64, 64, 256}));
+  runinfo.output_shapes.emplace("C", SimpleShape(DataType::FLOAT32, {64, 64, 256}));
+  RunThreaded(state, runinfo);
+}
+
+void ThreadedConstrained(benchmark::State& state) {  // NOLINT[runtime/references]
+  // The output index mapping produces constraints on the outer indexes.
+  lang::RunInfo runinfo;
+  runinfo.program_name = "pad";
+  runinfo.code = R"(
+    function (I[N, X, Y]) -> (O) {
+      O[n, x + 1, y + 1 : N, X + 2, Y + 2] = =(I[n, x, y]);
+    })";
+  runinfo.input_shapes.emplace("I", SimpleShape(DataType::FLOAT32, {64, 254, 254}));
+  runinfo.output_shapes.emplace("O", SimpleShape(DataType::FLOAT32, {64, 256, 256}));
+  RunThreaded(state, runinfo);
+}
+
+BENCHMARK(ThreadedEltwise)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(ThreadedConstrained)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace bench
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,160 @@
+// Copyright 2020, Intel Corporation
+
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/vecmath.h"
+
+using ::testing::Eq;
+using ::testing::Le;
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace test {
+
+namespace {
+
+// The error of got in units in the last place of the correctly rounded
+// result, using double precision libm as the reference.
+double UlpError(float got, double ref) {
+  float rounded = static_cast<float>(ref);
+  if (std::isnan(rounded)) {
+    return std::isnan(got) ? 0 : std::numeric_limits<double>::infinity();
+  }
+  if (std::isinf(rounded) || std::isinf(got)) {
+    return got == rounded ? 0 : std::numeric_limits<double>::infinity();
+  }
+  int exp;
+  std::frexp(rounded == 0 ? std::numeric_limits<float>::denorm_min() : rounded, &exp);
+  double ulp = std::ldexp(1.0, std::max(exp - 24, -149));
+  return std::fabs(got - ref) / ulp;
+}
+
+// Checks every stride'th float bit pattern in [lo, hi].
+template <typename F, typename R>
+double MaxUlpError(F func, R ref, float lo, float hi, uint32_t stride = 4099) {
+  double max_err = 0;
+  for (uint64_t bits = 0; bits <= std::numeric_limits<uint32_t>::max(); bits += stride) {
+    uint32_t u = bits;
+    float x;
+    std::memcpy(&x, &u, sizeof(x));
+    if (x >= lo && x <= hi) {
+      max_err = std::max(max_err, UlpError(func(x), ref(static_cast<double>(x))));
+    }
+  }
+  return max_err;
+}
+
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+}  // namespace
+
+TEST(VecMath, ExpAccuracy) {
+  EXPECT_THAT(MaxUlpError(vecmath::Exp, [](double x) { return std::exp(x); }, -kInf, kInf), Le(1.0));
+  EXPECT_THAT(vecmath::Exp(-kInf), Eq(0.0f));
+  EXPECT_THAT(vecmath::Exp(kInf), Eq(kInf));
+  EXPECT_TRUE(std::isnan(vecmath::Exp(std::nanf(""))));
+}
+
+TEST(VecMath, LogAccuracy) {
+  EXPECT_THAT(MaxUlpError(vecmath::Log, [](double x) { return std::log(x); }, 0, kInf), Le(1.0));
+  EXPECT_THAT(vecmath::Log(0), Eq(-kInf));
+  EXPECT_THAT(vecmath::Log(kInf), Eq(kInf));
+  EXPECT_TRUE(std::isnan(vecmath::Log(-1)));
+}
+
+TEST(VecMath, TanhAccuracy) {
+  EXPECT_THAT(MaxUlpError(vecmath::Tanh, [](double x) { return std::tanh(x); }, -kInf, kInf), Le(2.0));
+  EXPECT_THAT(vecmath::Tanh(kInf), Eq(1.0f));
+  EXPECT_THAT(vecmath::Tanh(-kInf), Eq(-1.0f));
+}
+
+TEST(VecMath, SinCosAccuracy) {
+  EXPECT_THAT(MaxUlpError(vecmath::Sin, [](double x) { return std::sin(x); }, -8192, 8192), Le(2.5));
+  EXPECT_THAT(MaxUlpError(vecmath::Cos, [](double x) { return std::cos(x); }, -8192, 8192), Le(2.5));
+  // Beyond the reduction's range, libm is used.
+  EXPECT_THAT(vecmath::Sin(1e6f), Eq(std::sin(1e6f)));
+  EXPECT_TRUE(std::isnan(vecmath::Cos(kInf)));
+}
+
+// Runs each function over a buffer through the JIT, where the loop is
+// vectorized with the SIMD variants, and checks that every element matches
+// the scalar implementation exactly.
+TEST(VecMath, JitMatchesScalar) {
+  const std::map<std::string, float (*)(float)> funcs{
+      {"exp", vecmath::Exp}, {"log", vecmath::Log}, {"tanh", vecmath::Tanh},
+      {"sin", vecmath::Sin}, {"cos", vecmath::Cos},
+  };
+  const size_t kSize = 1031;  // Not a multiple of any vector width
+  std::vector<float> input(kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    input[i] = (static_cast<float>(i) - kSize / 2) * 0.037f;
+  }
+  for (const auto& kvp : funcs) {
+    lang::RunInfo runinfo;
+    runinfo.program_name = kvp.first;
+    runinfo.code = "function (A) -> (B) { B = " + kvp.first + "(A); }";
+    runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {kSize}));
+    runinfo.output_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {kSize}));
+    auto program = GenerateStripe(runinfo);
+    std::vector<float> output(kSize);
+    JitExecute(*program->entry, {{"A", input.data()}, {"B", output.data()}});
+    for (size_t i = 0; i < kSize; i++) {
+      float expected = kvp.second(input[i]);
+      if (std::isnan(expected)) {
+        EXPECT_TRUE(std::isnan(output[i])) << kvp.first << "(" << input[i] << ")";
+      } else {
+        EXPECT_THAT(output[i], Eq(expected)) << kvp.first << "(" << input[i] << ")";
+      }
+    }
+  }
+}
+
+// Compiles a program through Compiler::CompileProgram as a single module, with
+// and without the vector math library, several times over in one process; the
+// optimizer's library info must be released exactly once per compile.
+TEST(VecMath, JitCompileProgram) {
+  const size_t kSize = 67;
+  std::vector<float> input(kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    input[i] = static_cast<float>(i) * 0.25f - 8;
+  }
+  lang::RunInfo runinfo;
+  runinfo.program_name = "exp";
+  runinfo.code = "function (A) -> (B) { B = exp(A) + A; }";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {kSize}));
+  runinfo.output_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {kSize}));
+  auto program = GenerateStripe(runinfo);
+  for (int round = 0; round < 3; round++) {
+    for (bool vector_math : {true, false}) {
+      Config config;
+      config.vector_math = vector_math;
+      config.compile_threads = 1;
+      std::vector<float> output(kSize);
+      Native native;
+      native.compile(*program->entry, config);
+      native.run({{"A", input.data()}, {"B", output.data()}});
+      for (size_t i = 0; i < kSize; i++) {
+        float expected = vector_math ? vecmath::Exp(input[i]) + input[i] : std::exp(input[i]) + input[i];
+        EXPECT_THAT(UlpError(output[i], expected), Le(1)) << "vector_math=" << vector_math << " x=" << input[i];
+      }
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
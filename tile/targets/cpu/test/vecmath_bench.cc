@@ -0,0 +1,102 @@
+// Copyright 2020, Intel Corporation
+
+// Compares the throughput of eltwise transcendentals compiled against libm
+// with those compiled against the bundled vector math library, along with the
+// scalar functions themselves.
+//
+// Run with: bazel run //tile/targets/cpu/test:bench -- --benchmark_filter=VecMath
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "tile/lang/gen_stripe.h"
+#include "tile/lang/runinfo.h"
+#include "tile/targets/cpu/jit.h"
+#include "tile/targets/cpu/vecmath.h"
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+namespace bench {
+
+namespace {
+
+const size_t kSize = 1 << 20;
+
+const char* kFunctions[] = {"exp", "log", "tanh", "sin", "cos"};
+
+std::vector<float> MakeInput() {
+  std::vector<float> input(kSize);
+  for (size_t i = 0; i < kSize; i++) {
+    // Positive, so that log stays finite.
+    input[i] = 0.001f + (i % 4096) * 0.002f;
+  }
+  return input;
+}
+
+// Runs B = func(A) through the JIT; state.range(0) picks the function and
+// state.range(1) enables the vector math library.
+void VecMathEltwise(benchmark::State& state) {  // NOLINT[runtime/references]
+  std::string func = kFunctions[state.range(0)];
+  lang::RunInfo runinfo;
+  runinfo.program_name = func;
+  runinfo.code = "function (A) -> (B) { B = " + func + "(A); }";
+  runinfo.input_shapes.emplace("A", SimpleShape(DataType::FLOAT32, {kSize}));
+  runinfo.output_shapes.emplace("B", SimpleShape(DataType::FLOAT32, {kSize}));
+  auto program = GenerateStripe(runinfo);
+  Config config;
+  config.vector_math = state.range(1);
+  Native native;
+  native.compile(*program->entry, config);
+
+  auto input = MakeInput();
+  std::vector<float> output(kSize);
+  std::map<std::string, void*> buffers{{"A", input.data()}, {"B", output.data()}};
+  for (auto _ : state) {
+    native.run(buffers);
+  }
+  state.SetLabel(func + (state.range(1) ? "/vecmath" : "/libm"));
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+template <float (*Func)(float)>
+void VecMathScalar(benchmark::State& state) {  // NOLINT[runtime/references]
+  auto input = MakeInput();
+  std::vector<float> output(kSize);
+  for (auto _ : state) {
+    for (size_t i = 0; i < kSize; i++) {
+      output[i] = Func(input[i]);
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kSize);
+}
+
+float LibmExp(float x) { return std::exp(x); }
+float LibmTanh(float x) { return std::tanh(x); }
+
+void EltwiseArgs(benchmark::internal::Benchmark* b) {
+  for (int func = 0; func < static_cast<int>(sizeof(kFunctions) / sizeof(kFunctions[0])); func++) {
+    b->Args({func, 0});
+    b->Args({func, 1});
+  }
+}
+
+}  // namespace
+
+BENCHMARK(VecMathEltwise)->Apply(EltwiseArgs);
+BENCHMARK_TEMPLATE(VecMathScalar, LibmExp);
+BENCHMARK_TEMPLATE(VecMathScalar, vecmath::Exp);
+BENCHMARK_TEMPLATE(VecMathScalar, LibmTanh);
+BENCHMARK_TEMPLATE(VecMathScalar, vecmath::Tanh);
+
+}  // namespace bench
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
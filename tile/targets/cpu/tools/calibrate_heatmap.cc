@@ -0,0 +1,65 @@
+// Copyright 2020, Intel Corporation
+
+// Measures the libxsmm (M, N, K) heatmap used by AutoStencil on the current
+// host, and writes it as CSV.  Point PLAIDML_CPU_HEATMAP at the output to use
+// it in place of the builtin heatmap.
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+
+#include "base/util/logging.h"
+#include "tile/targets/cpu/heatmap.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[]) {
+  using vertexai::tile::targets::cpu::CalibrateHeatmap;
+  using vertexai::tile::targets::cpu::CalibrationOptions;
+  using vertexai::tile::targets::cpu::HeatmapKey;
+  using vertexai::tile::targets::cpu::WriteHeatmap;
+
+  try {
+    START_EASYLOGGINGPP(argc, argv);
+    CalibrationOptions options;
+    po::options_description opts{"Allowed options"};
+    opts.add_options()                                                                                     //
+        ("help,h", "produce help message")                                                                 //
+        ("output,o", po::value<std::string>()->required(), "output CSV file path")                         //
+        ("min", po::value<unsigned>(&options.min_size)->default_value(options.min_size), "smallest size")  //
+        ("max", po::value<unsigned>(&options.max_size)->default_value(options.max_size), "largest size")   //
+        ("step", po::value<unsigned>(&options.step)->default_value(options.step), "size increment")        //
+        ("seconds", po::value<double>(&options.min_seconds)->default_value(options.min_seconds),
+         "minimum time to spend measuring each kernel")  //
+        ("verbose,v", "report each measurement");
+    po::variables_map args;
+    po::store(po::parse_command_line(argc, argv, opts), args);
+    if (args.count("help")) {
+      std::cout << opts << std::endl;
+      return 0;
+    }
+    po::notify(args);
+
+    bool verbose = args.count("verbose");
+    auto heatmap = CalibrateHeatmap(options, [verbose](const HeatmapKey& key, double gflops) {
+      if (verbose) {
+        std::cerr << std::get<0>(key) << "," << std::get<1>(key) << "," << std::get<2>(key) << ": " << gflops
+                  << " GFLOPS" << std::endl;
+      }
+    });
+
+    auto path = args["output"].as<std::string>();
+    std::ofstream ofs(path);
+    WriteHeatmap(ofs, heatmap);
+    if (!ofs) {
+      std::cerr << "Unable to write " << path << std::endl;
+      return -1;
+    }
+    std::cout << "Wrote " << heatmap.size() << " entries to " << path << std::endl;
+    return 0;
+  } catch (const std::exception& ex) {
+    std::cerr << "Caught unhandled exception: " << ex.what() << std::endl;
+    return -1;
+  }
+}
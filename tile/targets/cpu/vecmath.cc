@@ -0,0 +1,346 @@
+// Copyright 2020, Intel Corporation
+
+#include "tile/targets/cpu/vecmath.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VECMATH_X86 1
+#endif
+
+#if defined(__GNUC__)
+#define VECMATH_INLINE inline __attribute__((always_inline))
+// The wide vector helpers are only ever inlined into functions compiled for
+// the matching instruction set, so their nominal ABI does not matter.
+#if defined(__clang__)
+#pragma clang diagnostic ignored "-Wunknown-warning-option"
+#endif
+#pragma GCC diagnostic ignored "-Wpsabi"
+#else
+#define VECMATH_INLINE inline
+#endif
+
+// Every variant must round identically, so multiplies and adds are never fused.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+namespace {
+
+// The implementations below are written once, against a lane type V which is
+// either float or a GCC/Clang vector of floats; Traits<V>::I is the matching
+// integer type.  Comparisons are turned into all-ones/all-zeros lane masks by
+// ToMask, and Select blends by mask, so that the same code serves every width.
+template <typename V>
+struct Traits;
+
+template <>
+struct Traits<float> {
+  using I = int32_t;
+  static constexpr unsigned kWidth = 1;
+};
+
+VECMATH_INLINE int32_t ToMask(bool b) { return -static_cast<int32_t>(b); }
+
+#ifdef VECMATH_X86
+
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int32_t v4si __attribute__((vector_size(16)));
+typedef float v8sf __attribute__((vector_size(32)));
+typedef int32_t v8si __attribute__((vector_size(32)));
+typedef float v16sf __attribute__((vector_size(64)));
+typedef int32_t v16si __attribute__((vector_size(64)));
+
+template <>
+struct Traits<v4sf> {
+  using I = v4si;
+  static constexpr unsigned kWidth = 4;
+};
+
+template <>
+struct Traits<v8sf> {
+  using I = v8si;
+  static constexpr unsigned kWidth = 8;
+};
+
+template <>
+struct Traits<v16sf> {
+  using I = v16si;
+  static constexpr unsigned kWidth = 16;
+};
+
+VECMATH_INLINE v4si ToMask(v4si m) { return m; }
+VECMATH_INLINE v8si ToMask(v8si m) { return m; }
+VECMATH_INLINE v16si ToMask(v16si m) { return m; }
+
+#endif  // VECMATH_X86
+
+template <typename To, typename From>
+VECMATH_INLINE To Bitcast(const From& from) {
+  static_assert(sizeof(To) == sizeof(From), "Bitcast requires equal sizes");
+  To to;
+  std::memcpy(&to, &from, sizeof(to));
+  return to;
+}
+
+template <typename V>
+VECMATH_INLINE V Splat(float f) {
+  return V{} + f;
+}
+
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V Select(I mask, V a, V b) {
+  return Bitcast<V>((mask & Bitcast<I>(a)) | (~mask & Bitcast<I>(b)));
+}
+
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V Abs(V x) {
+  return Bitcast<V>(Bitcast<I>(x) & 0x7fffffff);
+}
+
+// 1.5 * 2^23: adding and subtracting this rounds to the nearest integer (for
+// |x| < 2^22), leaving the integer in the low mantissa bits.
+constexpr float kRoundMagic = 12582912.0f;
+constexpr int32_t kRoundMagicBits = 0x4B400000;
+
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V RoundToInt(V x, I* n) {
+  V t = x + kRoundMagic;
+  *n = Bitcast<I>(t) - kRoundMagicBits;
+  return t - kRoundMagic;
+}
+
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V IntToFloat(I n) {
+  return Bitcast<V>(n + kRoundMagicBits) - kRoundMagic;
+}
+
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V Pow2(I n) {
+  // 2^n for a normal exponent.
+  return Bitcast<V>((n + 127) << 23);
+}
+
+// Lanes for which fallback is set are recomputed with libm.
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V Fallback(I fallback, V x, V y, float (*func)(float)) {
+  int32_t lanes[Traits<V>::kWidth];
+  std::memcpy(lanes, &fallback, sizeof(lanes));
+  bool any = false;
+  for (unsigned i = 0; i < Traits<V>::kWidth; i++) {
+    any |= lanes[i] != 0;
+  }
+  if (!any) {
+    return y;
+  }
+  float xs[Traits<V>::kWidth];
+  float ys[Traits<V>::kWidth];
+  std::memcpy(xs, &x, sizeof(xs));
+  std::memcpy(ys, &y, sizeof(ys));
+  for (unsigned i = 0; i < Traits<V>::kWidth; i++) {
+    if (lanes[i]) {
+      ys[i] = func(xs[i]);
+    }
+  }
+  std::memcpy(&y, ys, sizeof(ys));
+  return y;
+}
+
+// e^x: Cody-Waite reduction by ln(2) to |r| <= ln(2)/2, then the Cephes
+// minimax polynomial.  The result is scaled by 2^n in two steps so that
+// subnormal results are rounded rather than flushed.
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V ExpImpl(V x) {
+  constexpr float kMax = 88.72283935546875f;
+  constexpr float kMin = -103.97208404541015625f;
+  V xc = Select(ToMask(x < kMax), x, Splat<V>(kMax));
+  xc = Select(ToMask(xc > kMin), xc, Splat<V>(kMin));
+  I n;
+  V fn = RoundToInt(xc * 1.44269504088896341f, &n);
+  V r = xc - fn * 0.693359375f;
+  r = r - fn * -2.12194440e-4f;
+  V z = r * r;
+  V p = Splat<V>(1.9875691500e-4f);
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  V y = p * z + r + 1.0f;
+  I n1 = n >> 1;
+  y = y * Pow2<V>(n1) * Pow2<V>(n - n1);
+  y = Select(ToMask(x > kMax), Splat<V>(std::numeric_limits<float>::infinity()), y);
+  y = Select(ToMask(x < kMin), Splat<V>(0.0f), y);
+  return Select(ToMask(x != x), x, y);
+}
+
+// log(x): the fdlibm reduction to m * 2^k with m in [sqrt(2)/2, sqrt(2)),
+// then log(m) = f - f^2/2 + s * (f^2/2 + R(s^2)) where f = m - 1 and
+// s = f / (2 + f).
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V LogImpl(V x) {
+  I subnormal = ToMask(x < 1.17549435e-38f);
+  V xs = Select(subnormal, x * 8388608.0f, x);
+  I ix = Bitcast<I>(xs);
+  I k = (ix >> 23) - 127 - (subnormal & 23);
+  ix = ix & 0x007fffff;
+  I i = (ix + 0x4afb20) & 0x800000;
+  V m = Bitcast<V>(ix | (i ^ 0x3f800000));
+  k = k + (i >> 23);
+  V f = m - 1.0f;
+  V s = f / (f + 2.0f);
+  V dk = IntToFloat<V>(k);
+  V z = s * s;
+  V w = z * z;
+  V t1 = w * (w * 2.4279078841e-01f + 4.0000972152e-01f);
+  V t2 = z * (w * 2.8498786688e-01f + 6.6666662693e-01f);
+  V R = t2 + t1;
+  V hfsq = f * f * 0.5f;
+  V y = dk * 6.9313812256e-01f - ((hfsq - (s * (hfsq + R) + dk * 9.0580006145e-06f)) - f);
+  y = Select(ToMask(x == std::numeric_limits<float>::infinity()), x, y);
+  y = Select(ToMask(x == 0.0f), Splat<V>(-std::numeric_limits<float>::infinity()), y);
+  return Select(ToMask(x < 0.0f) | ToMask(x != x), Splat<V>(std::numeric_limits<float>::quiet_NaN()), y);
+}
+
+// tanh(x): the Cephes odd polynomial for |x| < 0.625, and 1 - 2 / (e^2|x| + 1)
+// (with the sign of x) beyond.
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V TanhImpl(V x) {
+  V ax = Abs(x);
+  V z = x * x;
+  V p = Splat<V>(-5.70498872745e-3f);
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  V small = p * z * x + x;
+  V e = ExpImpl(ax + ax);
+  V large = 1.0f - 2.0f / (e + 1.0f);
+  large = Bitcast<V>(Bitcast<I>(large) | (Bitcast<I>(x) & std::numeric_limits<int32_t>::min()));
+  return Select(ToMask(ax < 0.625f), small, large);
+}
+
+// sin and cos: reduction by pi/2 to |r| <= pi/4, then the Cephes polynomials;
+// the quadrant picks the polynomial and sign.  pi/2 is split into 11-bit
+// pieces (the last one full width), so that each q * piece is exact for
+// |q| < 2^13; this keeps the reduction accurate near multiples of pi/2 for
+// |x| <= 8192.  Larger or non-finite inputs use libm.
+template <typename V, typename I = typename Traits<V>::I>
+VECMATH_INLINE V SinCosImpl(V x, int32_t quadrant_offset) {
+  I q;
+  V fq = RoundToInt(Select(ToMask(Abs(x) <= 8192.0f), x, Splat<V>(0.0f)) * 0.636619772367581343f, &q);
+  V r = x - fq * 0x1.92p+0f;
+  r = r - fq * 0x1.fb4p-12f;
+  r = r - fq * 0x1.444p-24f;
+  r = r - fq * 0x1.68cp-39f;
+  r = r - fq * 0x1.1a6264p-54f;
+  q = q + quadrant_offset;
+  V z = r * r;
+  V s = Splat<V>(-1.9515295891e-4f);
+  s = s * z + 8.3321608736e-3f;
+  s = s * z - 1.6666654611e-1f;
+  s = s * z * r + r;
+  V c = Splat<V>(2.443315711809948e-5f);
+  c = c * z - 1.388731625493765e-3f;
+  c = c * z + 4.166664568298827e-2f;
+  c = c * z * z - z * 0.5f + 1.0f;
+  V y = Select(ToMask((q & 1) != 0), c, s);
+  return Bitcast<V>(Bitcast<I>(y) ^ (ToMask((q & 2) != 0) & std::numeric_limits<int32_t>::min()));
+}
+
+template <typename V>
+VECMATH_INLINE V SinImpl(V x) {
+  return Fallback(~ToMask(Abs(x) <= 8192.0f), x, SinCosImpl(x, 0), [](float v) { return std::sin(v); });
+}
+
+template <typename V>
+VECMATH_INLINE V CosImpl(V x) {
+  return Fallback(~ToMask(Abs(x) <= 8192.0f), x, SinCosImpl(x, 1), [](float v) { return std::cos(v); });
+}
+
+float ExpF(float x) { return ExpImpl(x); }
+float LogF(float x) { return LogImpl(x); }
+float TanhF(float x) { return TanhImpl(x); }
+float SinF(float x) { return SinImpl(x); }
+float CosF(float x) { return CosImpl(x); }
+
+#ifdef VECMATH_X86
+
+// Each SIMD variant is compiled for the instruction set its width needs; the
+// JIT only references a variant when its target has those features.
+#define VECMATH_VARIANTS(NAME, IMPL)                                                        \
+  v4sf NAME##_v4(v4sf x) { return IMPL(x); }                                                \
+  __attribute__((target("avx2,fma"))) v8sf NAME##_v8(v8sf x) { return IMPL(x); }           \
+  __attribute__((target("avx512f"))) v16sf NAME##_v16(v16sf x) { return IMPL(x); }
+
+VECMATH_VARIANTS(ExpF, ExpImpl)
+VECMATH_VARIANTS(LogF, LogImpl)
+VECMATH_VARIANTS(TanhF, TanhImpl)
+VECMATH_VARIANTS(SinF, SinImpl)
+VECMATH_VARIANTS(CosF, CosImpl)
+
+#undef VECMATH_VARIANTS
+
+#define VECMATH_FUNCTION(LIBM, NAME, FUNC)                                   \
+  VecMathFunction{LIBM,                                                      \
+                  NAME,                                                      \
+                  reinterpret_cast<void*>(FUNC),                             \
+                  {                                                          \
+                      {4, NAME "_v4", reinterpret_cast<void*>(FUNC##_v4), {}}, \
+                      {8, NAME "_v8", reinterpret_cast<void*>(FUNC##_v8), {"avx2", "fma"}}, \
+                      {16, NAME "_v16", reinterpret_cast<void*>(FUNC##_v16), {"avx512f"}}, \
+                  }}
+
+#else  // VECMATH_X86
+
+#define VECMATH_FUNCTION(LIBM, NAME, FUNC) \
+  VecMathFunction { LIBM, NAME, reinterpret_cast<void*>(FUNC), {} }
+
+#endif  // VECMATH_X86
+
+}  // namespace
+
+const std::vector<VecMathFunction>& VecMathFunctions() {
+  static std::vector<VecMathFunction> functions{
+      VECMATH_FUNCTION("expf", "plaidml_expf", ExpF),     //
+      VECMATH_FUNCTION("logf", "plaidml_logf", LogF),     //
+      VECMATH_FUNCTION("tanhf", "plaidml_tanhf", TanhF),  //
+      VECMATH_FUNCTION("sinf", "plaidml_sinf", SinF),     //
+      VECMATH_FUNCTION("cosf", "plaidml_cosf", CosF),     //
+  };
+  return functions;
+}
+
+const VecMathFunction* FindVecMathFunction(const std::string& libm_name) {
+  for (const auto& func : VecMathFunctions()) {
+    if (libm_name == func.libm_name) {
+      return &func;
+    }
+  }
+  return nullptr;
+}
+
+namespace vecmath {
+
+float Exp(float x) { return ExpF(x); }
+float Log(float x) { return LogF(x); }
+float Tanh(float x) { return TanhF(x); }
+float Sin(float x) { return SinF(x); }
+float Cos(float x) { return CosF(x); }
+
+}  // namespace vecmath
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai
@@ -0,0 +1,68 @@
+// Copyright 2020, Intel Corporation
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace vertexai {
+namespace tile {
+namespace targets {
+namespace cpu {
+
+// A bundled fp32 math library whose functions come in scalar and SIMD
+// flavors.  The JIT calls the scalar entry points in place of libm and
+// describes the SIMD variants to LLVM, so that loops over transcendentals can
+// be vectorized.  Every variant of a function computes the same result for
+// the same input.
+//
+// Maximum error, in ulps of the correctly rounded result (checked by
+// test/vecmath.cc against double precision libm):
+//   exp    1     (including subnormal results)
+//   log    1
+//   tanh   2
+//   sin    2.5   for |x| <= 8192; libm is used beyond that
+//   cos    2.5   for |x| <= 8192; libm is used beyond that
+// pow and the remaining functions still call libm.
+
+struct VecMathVariant {
+  // The number of lanes
+  unsigned width;
+  // The symbol the JIT references, and its implementation
+  const char* name;
+  void* ptr;
+  // The target features (LLVM names) the caller must have to use this variant
+  std::vector<std::string> features;
+};
+
+struct VecMathFunction {
+  // The libm function this replaces
+  const char* libm_name;
+  // The scalar symbol the JIT references, and its implementation
+  const char* name;
+  void* ptr;
+  // The available SIMD variants, narrowest first
+  std::vector<VecMathVariant> variants;
+};
+
+// All of the library's functions.
+const std::vector<VecMathFunction>& VecMathFunctions();
+
+// Returns the library's replacement for a libm function, or nullptr.
+const VecMathFunction* FindVecMathFunction(const std::string& libm_name);
+
+namespace vecmath {
+
+// The scalar implementations, for direct use.
+float Exp(float x);
+float Log(float x);
+float Tanh(float x);
+float Sin(float x);
+float Cos(float x);
+
+}  // namespace vecmath
+
+}  // namespace cpu
+}  // namespace targets
+}  // namespace tile
+}  // namespace vertexai